@@ -25,9 +25,6 @@
 //
 // *** Priority 4:
 //
-// Think about heap management of CBlobs
-// Think about heap management of SLinkedSegments
-//
 // *** Priority 5 (maybe never do):
 // 
 // Try small and large SMoments structure (small for segment)
@@ -51,6 +48,7 @@
 // Sort blobs according to area  (DONE, ARW 10/7/04)
 // DONE Sort blobs according to area
 // DONE Clean up code
+// DONE Heap management of CBlobs, SLinkedSegments (CBlobArena)
 
 #include <stdlib.h>
 #include <assert.h>
@@ -224,13 +222,17 @@ public:
         return(moments.area);
     }
 
-    // Clear blob data and free segments, if any
+    // Clear blob data and forget segments, if any.  Segments belong to
+    // the assembler's arena.
     void Reset();
     
     void NewRow();
 
     void Add(const SSegment &segment);
 
+    // Append a recorded segment to the end of the segment list
+    void Append(SLinkedSegment *linked);
+
     // This takes futileResister and assimilates it into this blob
     //
     // Takes advantage of the fact that we are always assembling top to
@@ -250,6 +252,47 @@ public:
     void UpdateBoundingBox(int newLeft, int newTop, int newRight);
 };
 
+// A CBlobAssembler gets memory for its blobs (and segments, if recorded) in
+// blocks of this many blobs.  Blocks are allocated as a frame needs them, and
+// the first CBA_KEEP_BLOCKS are kept for later frames.
+#ifndef CBA_ARENA_BLOBS
+#define CBA_ARENA_BLOBS   48
+#endif
+#define CBA_ARENA_SIZE    (CBA_ARENA_BLOBS*sizeof(CBlob))
+#ifndef CBA_KEEP_BLOCKS
+#define CBA_KEEP_BLOCKS   2
+#endif
+
+// Per-frame memory for a CBlobAssembler.  Blobs and segments are bump-allocated
+// from a chain of blocks, blobs freed during the frame are reused, and Reset()
+// frees everything at once.  When a block fills up the next one is used, and
+// it's allocated if it isn't one of the blocks Reset() kept.
+class CBlobArena {
+public:
+    CBlobArena();
+    ~CBlobArena();
+
+    CBlob *NewBlob();
+    void FreeBlob(CBlob *blob);
+    SLinkedSegment *NewSegment(const SSegment &segment);
+
+    // Free all blobs and segments, and any blocks past CBA_KEEP_BLOCKS
+    void Reset();
+
+private:
+    struct Block {
+        Block *next;
+        unsigned char mem[CBA_ARENA_SIZE];
+    };
+
+    void *Alloc(unsigned int size);
+
+    Block *blocks;     // the blocks allocated so far
+    Block *current;    // the block being allocated from, NULL after Reset()
+    unsigned int used; // bytes used in current
+    CBlob *freeBlobs;
+};
+
 // Strategy for using CBlobAssembler:
 //
 // Make one CBlobAssembler for each color channel.
@@ -261,6 +304,9 @@ public:
 // At the end of a frame, call EndFrame() on each assembler
 // Get blobs from finishedBlobs.  Blobs will remain valid until
 //    the next call to Reset(), at which point they will be deleted.
+//    Blobs less than 3 rows tall are deleted as they finish.
+// If the assembler can't get another block for its arena, segments that
+//    would start a new blob are dropped until the next Reset().
 //
 // To get statistics for a blob, do the following:
 //  SMomentStats stats;
@@ -300,23 +346,29 @@ public:
     void Reset();
 
 
-    // Call once for each segment in the color channel
+    // Call once for each segment in the color channel.  Returns -1 if
+    // the segment was dropped because the arena is full.
     int Add(const SSegment &segment);
 
     // Call at end of frame
     // Moves all active blobs to finished list
     void EndFrame();
 
-    int ListLength(const CBlob *b);
+    static int ListLength(const CBlob *b);
     
     // Split a list of blobs into two halves
-    void SplitList(CBlob *all, CBlob *&firstHalf, CBlob *&secondHalf);
+    static void SplitList(CBlob *all, CBlob *&firstHalf, CBlob *&secondHalf);
 
     // Merge maxelts elements from old1 and old2 into newptr
-    void MergeLists(CBlob *&old1, CBlob *&old2, CBlob **&newptr, int maxelts);
+    static void MergeLists(CBlob *&old1, CBlob *&old2, CBlob **&newptr, int maxelts);
 
-    // Sorts finishedBlobs in order of descending area using an in-place
-    // merge sort (time n log n)
+    // Sorts a list of blobs in order of descending area using an in-place
+    // merge sort (time n log n).  Blobs with the same area are ordered
+    // top to bottom, then left to right, so the order doesn't depend on
+    // how the list was built.
+    static void SortList(CBlob *&blobs);
+
+    // Sorts finishedBlobs with SortList()
     void SortFinished();
 
     // Assert that finishedBlobs is in fact sorted.  For testing only.
@@ -351,7 +403,12 @@ protected:
     void RewindCurrent();
     void AdvanceCurrent();
 
+    // Add segment to blob, recording it if CBlob::recordSegments
+    void AddSegment(CBlob *blob, const SSegment &segment);
+
+    CBlobArena m_arena;
     int m_blobCount;
+    int m_dropped;
 };
 
 #endif // _BLOB_H
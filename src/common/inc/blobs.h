@@ -17,11 +17,13 @@
 
 #include <stdint.h>
 #include "blob.h"
+#include "blobunion.h"
 #include "pixytypes.h"
 #include "colorlut.h"
 #include "qqueue.h"
 #include "simplelist.h"
 #include "tracker.h"
+#include "trackassoc.h"
 
 #define MAX_BLOBS             100
 #define MAX_BLOBS_PER_MODEL   20
@@ -38,14 +40,41 @@
 #define BL_BLOB_FILTERING          3
 #define BL_MAX_TRACKING_DIST       65
 #define BL_PERIOD                  16200  // microseconds per frame, assuming 60fps
+#define BL_TRACKING_TRACKERS       128    // trackers matched together, more go in further batches
+
+#define BL_MAX_WINDOWS             4      // see setWindows()
+#define BL_MAX_DECIMATION          8
+
+#define BL_ROW_SEGMENTS            16     // segments addSegment() holds before assembling them
+#define BL_HISTORY_FRAMES          8      // frames of blocks kept for getBlobHistory()
+#ifndef BL_HISTORY_BLOBS
+#define BL_HISTORY_BLOBS           8      // largest blocks kept per frame, the rest are counted as dropped
+#endif
 
 #define TEMP_QVAL_ARRAY_SIZE  0x100
 
+// Host builds can time the stages of blobify() by defining BL_PROFILE and providing
+// blobsProfileMark(), which is called as each stage starts.  On Pixy the marks compile away.
+#define BL_STAGE_RLS               0      // runlength analysis of the Qvals
+#define BL_STAGE_ASSEMBLY          1      // CBlobAssembler
+#define BL_STAGE_COMBINE           2      // combine(), combine2(), compress()
+#define BL_STAGE_CC                3      // processCC()
+#define BL_STAGE_TRACKING          4      // handleBlobTracking(), recordHistory()
+#define BL_STAGES                  5      // (end of blobify())
+
+#ifdef BL_PROFILE
+void blobsProfileMark(uint8_t stage);
+#define BL_PROFILE_MARK(stage)     blobsProfileMark(stage)
+#else
+#define BL_PROFILE_MARK(stage)
+#endif
+
 struct BlobA
 {
     BlobA()
     {
         m_model = m_left = m_right = m_top = m_bottom = 0;
+		m_angle = 0;
 		m_tracker = NULL;
     }
 
@@ -56,6 +85,7 @@ struct BlobA
         m_right = right;
         m_top = top;
         m_bottom = bottom;
+		m_angle = 0;
 		m_tracker = NULL;
     }
 
@@ -68,6 +98,66 @@ struct BlobA
 	Tracker<BlobA> *m_tracker;
 };
 
+// grid of BL_MERGE_CELL x BL_MERGE_CELL pixel cells that BlobMerge keeps the blobs of a frame in.
+// Coordinates past the last row or column go in it.
+#define BL_MERGE_CELL_SHIFT        6
+#define BL_MERGE_CELL              (1<<BL_MERGE_CELL_SHIFT)
+#define BL_MERGE_COLS              5
+#define BL_MERGE_ROWS              4
+#define BL_MERGE_WORDS             ((MAX_BLOBS+31)>>5)
+// below this many blobs, testing every pair is quicker than the grid
+#define BL_MERGE_MIN_BLOBS         8
+
+// Blobs::blobify()'s merging of blobs.  Each cell of the grid has a bit for each blob whose box
+// touches it, so the blobs that a blob could merge with or enclose are found from the few cells
+// around it instead of by testing every pair.  Those blobs are still tested in the same order,
+// one blob against all the ones after it, and a blob is looked up again whenever it grows, so
+// the results are exactly the same as testing every pair.
+class BlobMerge
+{
+public:
+    BlobMerge();
+	void setMergeDist(uint16_t mergeDist);
+
+	// one pass of merging blobs that touch or are within the merge distance of each other,
+	// returns the number of blobs merged away (m_model set to 0)
+    uint16_t combine2(BlobA *blobs, uint16_t numBlobs);
+	// removes blobs that are enclosed by other blobs, returns the number removed
+    uint16_t combine(BlobA *blobs, uint16_t numBlobs);
+
+private:
+	void build(const BlobA *blobs, uint16_t numBlobs);
+	void find(int32_t left, int32_t right, int32_t top, int32_t bottom);
+	bool next(uint16_t *j, uint16_t numBlobs);
+    uint16_t merge(uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, uint16_t *D0,
+               uint16_t *A1, uint16_t *B1, uint16_t *C1, uint16_t *D1);
+
+    uint16_t m_mergeDist;
+	uint32_t m_cells[BL_MERGE_ROWS*BL_MERGE_COLS][BL_MERGE_WORDS];
+	uint32_t m_found[BL_MERGE_WORDS]; // blobs in the cells of the last find()
+	bool m_every; // no grid, find() finds every blob
+};
+
+
+// one frame of blocks in the history ring
+struct BlobHistory
+{
+	uint16_t m_frame;
+	uint16_t m_timestamp; // milliseconds, wraps
+	uint8_t m_numBlobs;
+	uint8_t m_dropped; // blocks past BL_HISTORY_BLOBS, up to 255
+	BlobC m_blobs[BL_HISTORY_BLOBS];
+};
+
+// header of each frame returned by getBlobHistory(), followed by m_numBlobs BlobC's
+struct BlobHistoryHeader
+{
+	uint16_t m_frame;
+	uint8_t m_numBlobs;
+	uint8_t m_dropped;
+	uint16_t m_timestamp;
+};
+
 
 enum ColorCodeMode
 {
@@ -77,6 +167,12 @@ enum ColorCodeMode
     MIXED = 3 // experimental
 };
 
+enum BlobAssembly
+{
+    LINKED_LIST = 0, // a CBlobAssembler for each signature
+    UNION_FIND = 1   // one CBlobUnionFind for all signatures
+};
+
 class Blobs
 {
 public:
@@ -89,6 +185,9 @@ public:
     BlobA *getMaxBlob(uint16_t signature=0, uint16_t *numBlobs=NULL);
 	int getBlobs(uint8_t sigmap, uint8_t n, uint8_t *buf, uint16_t len);
 	SimpleList<Tracker<BlobA> > *getBlobs();
+	int getBlobHistory(uint8_t sigmap, uint8_t n, uint16_t lastFrame, uint8_t *buf, uint16_t len);
+	int getPredictedBlobs(uint8_t sigmap, uint8_t n, uint16_t aheadMs, uint8_t *buf, uint16_t len);
+	void predictBlob(const Tracker<BlobA> &tracker, uint32_t aheadUs, BlobA *blob);
     int runlengthAnalysis();
 	
 	void setMaxBlobs(uint16_t maxBlobs);
@@ -97,7 +196,11 @@ public:
 	void setColorCodeMode(ColorCodeMode ccMode);
     void setBlobFiltering(uint8_t filtering);
 	void setMaxBlobVelocity(uint16_t maxVel);
+	void setBlobPrediction(bool prediction);
 	void setMaxMergeDist(uint16_t maxMergeDist);
+	void setBlobAssembly(BlobAssembly assembly);
+	int setWindows(const RectA *windows, uint8_t numWindows, uint8_t decimation);
+	void getRowWindow(uint16_t *top, uint16_t *bottom, uint8_t *decimation);
 
 	ColorLUT m_clut;
     Qqueue *m_qq;
@@ -106,11 +209,14 @@ public:
 
 private:
     int handleSegment(uint8_t signature, uint16_t row, uint16_t startCol, uint16_t length);
+    int addSegment(uint8_t signature, uint16_t row, uint16_t startCol, uint16_t length);
+	int flushSegments();
+	void windowRow(uint16_t y);
 	void addQval(uint32_t qval);
 	void sendQvals();
 	void endFrame();
-    uint16_t combine(BlobA *blobs, uint16_t numBlobs);
-    uint16_t combine2(BlobA *blobs, uint16_t numBlobs);
+	void resetAssembly();
+	CBlob *finishedBlobs(uint8_t signature);
     uint16_t compress(BlobA *blobs, uint16_t numBlobs);
 	void shift();
 
@@ -124,15 +230,19 @@ private:
     void cleanup2(BlobA *blobs[], int16_t *numBlobs);
     bool analyzeDistances(BlobA *blobs0[], int16_t numBlobs0, BlobA *blobs[], int16_t numBlobs, BlobA **blobA, BlobA **blobB);
     void mergeClumps(uint16_t scount0, uint16_t scount1);
-    uint16_t merge(uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, uint16_t *D0,
-               uint16_t *A1, uint16_t *B1, uint16_t *C1, uint16_t *D1);
 
-	uint32_t compareBlobs(const BlobA &b0, const BlobA &b1);
-	uint16_t handleBlobTracking2();
+	uint32_t compareBlobs(const BlobA &b0, const BlobA &b1, int32_t dx, int32_t dy);
 	void handleBlobTracking();
+	uint16_t assembleBlobs(uint8_t sigmap, BlobC *blobs, uint16_t len);
+	void recordHistory();
 	void reloadBlobs();
 	
     CBlobAssembler m_assembler[CL_NUM_SIGNATURES];
+    CBlobUnionFind m_unionFind;
+	BlobAssembly m_assembly;
+	BlobAssembly m_frameAssembly; // m_assembly when the frame started
+	SSegment m_segments[BL_ROW_SEGMENTS]; // held by addSegment() until the row ends
+	uint8_t m_numSegments;
 
     BlobA *m_blobs;
     uint16_t m_numBlobs;	
@@ -146,7 +256,7 @@ private:
     uint16_t m_blobReadIndex;
 
     uint32_t m_minArea;
-    uint16_t m_mergeDist;
+    BlobMerge m_merge;
     uint16_t m_maxCodedDist;
     ColorCodeMode m_ccMode;
     BlobA *m_maxBlob;
@@ -155,12 +265,30 @@ private:
     uint32_t *m_qvals;
 
 	bool m_sendDetectedPixels;
+
+	RectA m_windows[BL_MAX_WINDOWS];
+	uint8_t m_numWindows; // 0 is the whole frame
+	uint8_t m_decimation;
+	uint16_t m_rowStart[BL_MAX_WINDOWS]; // the columns of the windows on this row, merged
+	uint16_t m_rowEnd[BL_MAX_WINDOWS];
+	uint8_t m_numRowCols;
+	uint16_t m_frameTop; // the rows the M0 did this frame -- row n is m_frameTop + n*m_frameDecimation
+	uint8_t m_frameDecimation;
 	
 	SimpleList<Tracker<BlobA> > m_blobTrackersList;
+	TrackAssociation<BlobA, BL_TRACKING_TRACKERS, MAX_BLOBS> m_trackAssociation;
 	uint8_t m_blobTrackerIndex;
 	uint8_t m_blobFiltering;	
 	uint32_t m_maxTrackingVel2;
+	bool m_prediction; // gate with the trackers' predicted positions
 	uint32_t m_timer;
+
+	BlobHistory *m_history;
+	uint8_t m_historyHead; // oldest frame
+	uint8_t m_historyCount;
+	uint16_t m_historyFrame;
+	uint32_t m_historyTimer;
+	uint16_t m_historyMs;
 };
 
 
@@ -0,0 +1,117 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+#ifndef _BLOBUNION_H
+#define _BLOBUNION_H
+
+#include "blob.h"
+
+// SSegment::model is 3 bits
+#define BU_MODELS          8
+// Components per frame, all models.  When they run out, labels of finished
+// components that won't be reported are used again.
+#ifndef BU_MAX_LABELS
+#define BU_MAX_LABELS      128
+#endif
+// Segments per row, all models.  The M0 sends at most one Qval for every
+// 3 columns, so 64 covers a full row.
+#define BU_MAX_ROW_RUNS    64
+// Rows to wait after looking for labels to use again and finding none
+#define BU_COLLECT_ROWS    16
+
+#define BU_NONE            0xffff
+
+// Connected components by run-length union-find, an alternative to one
+// CBlobAssembler per model.  Segments of all models go through one
+// CBlobUnionFind in the order the RLS produces them (top to bottom, left
+// to right).  Each segment is checked against the previous row's surface
+// of its model and takes the label of the component it touches, joining
+// labels if it touches more than one.
+//
+// The rules are the same as CBlobAssembler with maxRowDelta=1: a segment
+// attaches to a component if it overlaps the span from the component's
+// leftmost to rightmost segment on the row above, and components less
+// than 3 rows tall are dropped.  So the finished blobs have the same
+// bounding boxes and moments, and SortFinished() puts them in the same
+// order.
+//
+// Component data is kept in CBlobs, one per label, so finishedBlobs[model]
+// can be read just like CBlobAssembler::finishedBlobs.  For these,
+// lastBottom.row is the bottom row and lastBottom.model the model.
+//
+// Usage is the same as CBlobAssembler: Reset() at the start of a frame,
+// Add() for each segment, EndFrame() and SortFinished() at the end, then
+// read finishedBlobs until the next Reset().
+
+class CBlobUnionFind {
+public:
+    CBlobUnionFind();
+    ~CBlobUnionFind();
+
+    // Call prior to starting a frame
+    void Reset();
+
+    // Call once for each segment, any model.  Returns -1 if the segment
+    // was dropped because there are no labels or row runs left.
+    int Add(const SSegment &segment);
+
+    // Call at end of frame
+    // Puts each finished component on finishedBlobs[model]
+    void EndFrame();
+
+    // Sorts each finishedBlobs list with CBlobAssembler::SortList()
+    void SortFinished();
+
+    // Blobs by model (1-7)
+    CBlob *finishedBlobs[BU_MODELS];
+
+private:
+    // A span of one component on one row, from its leftmost segment to its
+    // rightmost.  Spans of each model are chained left to right.
+    struct SRun {
+        unsigned short startCol, endCol; // inclusive
+        unsigned short label;
+        unsigned short next;
+    };
+
+    bool Alloc();
+    unsigned short Find(unsigned short label);
+    unsigned short Union(unsigned short root0, unsigned short root1);
+    unsigned short NewLabel(unsigned char model);
+    void Collect();
+    void NewRow(short row);
+
+    // one CBlob and parent per label
+    CBlob *blobs;
+    unsigned short *parent;
+    unsigned short numLabels;
+    CBlob *freeBlobs;
+
+    // spans on the current row
+    SRun *runs;
+    unsigned short numRuns;
+    unsigned short runHead[BU_MODELS], runTail[BU_MODELS];
+
+    // spans on the previous row -- the surface new segments attach to.
+    // hullCursor is the first span of each model that the next segment
+    // could touch.
+    SRun *hulls;
+    unsigned short hullCursor[BU_MODELS];
+
+    short currentRow;
+    short collectRow; // row Collect() can run again
+    int m_dropped;
+};
+
+#endif // _BLOBUNION_H
@@ -30,6 +30,7 @@
 #define CRP_BUFSIZE                     0x80
 #define CRP_BUFPAD                      8
 #define CRP_PROCTABLE_LEN               0x40
+#define CRP_PIPELINE_DEPTH              8 // max number of issued, uncollected calls
 
 #define CRP_START_CODE                  0xaaaa5555
 
@@ -42,6 +43,12 @@
 #define CRP_CALL_INIT                   (CRP_CALL | CRP_INTRINSIC | 0x01)
 #define CRP_CALL_ENUMERATE_INFO         (CRP_CALL | CRP_INTRINSIC | 0x02)
 
+// capabilities, negotiated in CRP_CALL_INIT.  The init response byte carries
+// CRP_INIT_HINTERESTED in bit 0 and the agreed capabilities in the remaining bits.
+#define CRP_INIT_HINTERESTED            0x01
+#define CRP_CAP_PIPELINE                0x02 // responses echo the tag of the call they answer
+#define CRP_CAPS_SUPPORTED              (CRP_CAP_PIPELINE)
+
 #define CRP_ACK                         0x59
 #define CRP_NACK                        0x95
 #define CRP_MAX_HEADER_LEN              64
@@ -161,6 +168,8 @@
 #define callSync(...)                   call(SYNC, __VA_ARGS__, END)
 #define callAsync(...)                  call(ASYNC, __VA_ARGS__, END)
 #define callSyncArray(...)              call(SYNC_RETURN_ARRAY, __VA_ARGS__, END)
+#define callIssue(...)                  issue(__VA_ARGS__, END)
+#define callCollect(...)                collect(__VA_ARGS__, END)
 
 class Chirp;
 
@@ -197,6 +206,17 @@ struct ProcTableEntry
     const ProcTableExtension *extension;
 };
 
+// an issued call that hasn't been collected yet
+struct ChirpPending
+{
+    uint8_t tag;
+    bool outstanding;
+    bool received;     // response arrived before collect() -- it's stashed in buf
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t bufSize;
+};
+
 class Chirp
 {
 public:
@@ -214,6 +234,14 @@ public:
 
     int call(uint8_t service, ChirpProc proc, ...);
     int call(uint8_t service, ChirpProc proc, va_list args);
+    // pipelined calls: issue() sends a call and returns its tag without waiting,
+    // collect() returns the response for a tag.  Several calls can be issued before
+    // collecting.  Without CRP_CAP_PIPELINE, issue() falls back to stop-and-wait.
+    int issue(ChirpProc proc, ...);
+    int issue(ChirpProc proc, va_list args);
+    int collect(uint8_t tag, ...);
+    int collect(uint8_t tag, va_list args);
+    bool pipelined();
     static uint8_t getType(const void *arg);
     int service(bool all=true);
     int assemble(uint8_t type, ...);
@@ -229,6 +257,12 @@ public:
     static int loadArgs(va_list *args, void *recvArgs[]);
     static int getArgList(uint8_t *buf, uint32_t len, uint8_t *argList);
     int useBuffer(uint8_t *buf, uint32_t len);
+    // zero-copy receive (links with LINK_FLAG_ZERO_COPY) -- large responses are parsed in place
+    // in the link's buffer.  The data is valid until the next receive, unless keepLease() is called,
+    // in which case it's valid until the caller hands it back with releaseLease().
+    int setZeroCopy(bool zeroCopy);
+    uint8_t *keepLease();
+    void releaseLease(uint8_t *lease);
 
     static uint16_t calcCrc(uint8_t *buf, uint32_t len);
 
@@ -254,6 +288,9 @@ protected:
     uint16_t m_dataTimeout;
     uint16_t m_idleTimeout;
     uint16_t m_sendTimeout;
+    uint8_t m_caps;
+    uint8_t m_sendTag;
+    uint8_t m_recvTag;
 
 private:
     int sendHeader(uint8_t type, ChirpProc proc);
@@ -266,15 +303,19 @@ private:
     int recvData();
     int recvAck(bool *ack, uint16_t timeout); // false=nack
     int32_t handleEnumerate(char *procName, ChirpProc *callback);
-    int32_t handleInit(uint16_t *blkSize, uint8_t *hintSource);
+    int32_t handleInit(uint16_t *blkSize, uint8_t *hintSource, uint8_t *caps);
     int32_t handleEnumerateInfo(ChirpProc *proc);
     int vassemble(va_list *args);
     void restoreBuffer();
+    void dropLease();
 
     ChirpProc updateTable(const char *procName, ProcPtr procPtr);
     ChirpProc lookupTable(const char *procName);
     int realloc(uint32_t min=0);
     int reallocTable();
+    int recvResponse(uint8_t tag, void *args[]);
+    int stashResponse(ChirpPending *pending);
+    ChirpPending *lookupPending(uint8_t tag);
 
     Link *m_link;
     ProcTableEntry *m_procTable;
@@ -284,6 +325,10 @@ private:
     uint8_t m_retries;
     bool m_call;
     bool m_connected;
+    uint8_t m_nextTag;
+    bool m_zeroCopy;
+    uint8_t *m_lease; // link buffer the last message was received into, NULL if it was copied
+    ChirpPending m_pending[CRP_PIPELINE_DEPTH];
 };
 
 #endif // CHIRP_H
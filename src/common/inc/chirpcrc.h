@@ -0,0 +1,72 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Checksum shared by chirp.cpp (host, M4) and chirp.c (M0).  It isn't a real crc -- it's the
+// 16-bit sum of the bytes plus the length -- but it's what's on the wire and in the parameter
+// records in flash, so every version here must return exactly the same value.
+
+#ifndef CHIRPCRC_H
+#define CHIRPCRC_H
+
+#include <stdint.h>
+
+#define CRC_SLICE_BLOCKS                64 // 8-byte slices per fold, so the 16-bit lanes can't overflow
+
+// compact version -- one byte at a time, smallest code (M0)
+static __inline uint16_t crcCompact(const uint8_t *buf, uint32_t len)
+{
+    uint32_t i;
+    uint16_t crc;
+
+    for (i=0, crc=0; i<len; i++)
+        crc += buf[i];
+    crc += len;
+
+    return crc;
+}
+
+// sliced version -- 8 bytes per iteration.  Each 32-bit word is split into two 16-bit lanes of
+// even and odd bytes, which are summed in parallel.  A lane gains at most 4*0xff per slice, so
+// we fold the lanes into the result every CRC_SLICE_BLOCKS slices, before they can carry.
+static __inline uint16_t crcSliced(const uint8_t *buf, uint32_t len)
+{
+    uint32_t i, n, w0, w1, lanes, sum;
+
+    // bring buf to word alignment so we can read whole words
+    for (i=0, sum=0; i<len && ((uintptr_t)(buf+i)&3); i++)
+        sum += buf[i];
+
+    while (len-i>=8)
+    {
+        n = (len-i)>>3;
+        if (n>CRC_SLICE_BLOCKS)
+            n = CRC_SLICE_BLOCKS;
+        for (lanes=0; n; n--, i+=8)
+        {
+            w0 = *(const uint32_t *)(buf+i);
+            w1 = *(const uint32_t *)(buf+i+4);
+            lanes += (w0&0x00ff00ff) + ((w0>>8)&0x00ff00ff) + (w1&0x00ff00ff) + ((w1>>8)&0x00ff00ff);
+        }
+        sum += (lanes&0xffff) + (lanes>>16);
+    }
+
+    // remainder
+    for (; i<len; i++)
+        sum += buf[i];
+    sum += len;
+
+    return sum;
+}
+
+#endif
@@ -41,6 +41,11 @@ struct RuntimeSignature
     int32_t m_vMin;
     int32_t m_vMax;
     uint32_t m_rgbSat;
+
+    // The bounds above for a pixel of brightness y, without dividing by y (see ColorLUT::inBounds).
+    // A pixel is in if lo*y+loBias <= u<<CL_LUT_ENTRY_SCALE <= hi*y+hiBias, same for v.
+    int32_t m_uLo, m_uHi, m_vLo, m_vHi;
+    int8_t m_uLoBias, m_uHiBias, m_vLoBias, m_vHiBias;
 };
 
 typedef SimpleVector<Point16> Points;
@@ -76,7 +81,7 @@ public:
 	ColorSignature *getSignature(uint8_t signum);
 	int setSignature(uint8_t signum, const ColorSignature &sig);
 
-    int generateLUT();
+    int generateLUT(uint8_t signum=0);
     void clearLUT(uint8_t signum=0);
 	void updateSignature(uint8_t signum);
     void growRegion(const Frame8 &frame, const Point16 &seed, Points *points);
@@ -87,6 +92,16 @@ public:
     void setCCGain(float gain);
     uint32_t getType(uint8_t signum);
 
+    // Same answer as sig.m_uMin<(u<<CL_LUT_ENTRY_SCALE)/y<sig.m_uMax (and likewise for v) for any
+    // y>0, but with multiplies, which are much cheaper than divides on the M4.
+    static inline bool inBounds(const RuntimeSignature &sig, int32_t u, int32_t v, int32_t y)
+    {
+        u <<= CL_LUT_ENTRY_SCALE;
+        v <<= CL_LUT_ENTRY_SCALE;
+        return (int64_t)sig.m_uLo*y+sig.m_uLoBias<=u && u<=(int64_t)sig.m_uHi*y+sig.m_uHiBias &&
+            (int64_t)sig.m_vLo*y+sig.m_vLoBias<=v && v<=(int64_t)sig.m_vHi*y+sig.m_vHiBias;
+    }
+
     // these should be in little access methods, but they're here to speed things up a tad
     ColorSignature m_signatures[CL_NUM_SIGNATURES];
     RuntimeSignature m_runtimeSigs[CL_NUM_SIGNATURES];
@@ -97,6 +112,7 @@ private:
     float testRegion(const RectA &region, const Frame8 &frame, UVPixel *mean, Points *points);
 
     void calcRatios(IterPixel *ip, ColorSignature *sig, float ratios[]);
+    uint8_t matchBin(uint32_t bin, uint8_t first, uint8_t last);
     void iterate(IterPixel *ip, ColorSignature *sig);
     void getMean(const RectA &region ,const Frame8 &frame, UVPixel *mean);
 
@@ -17,7 +17,9 @@
 #include <stdint.h>
 
 #define EQ_LOC        SRAM4_LOC
+#ifndef EQ_SIZE // host builds that queue a whole frame at once need more
 #define EQ_SIZE       0x3c00
+#endif
 
 #define EQ_MEM_SIZE  ((EQ_SIZE-sizeof(struct EqueueFields)+sizeof(uint16_t))/sizeof(uint16_t))
 
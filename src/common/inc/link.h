@@ -20,6 +20,8 @@
 // flags
 #define LINK_FLAG_SHARED_MEM                            0x01
 #define	LINK_FLAG_ERROR_CORRECTED                       0x02
+#define LINK_FLAG_BUFFERED_RECEIVE                      0x04 // receives are queued while we send (calls can be pipelined)
+#define LINK_FLAG_ZERO_COPY                             0x08 // getBuffer()/releaseBuffer() are supported
 
 // result codes
 #define LINK_RESULT_OK                                  0
@@ -32,6 +34,9 @@
 #define LINK_FLAG_INDEX_SHARED_MEMORY_LOCATION          0x01
 #define LINK_FLAG_INDEX_SHARED_MEMORY_SIZE              0x02
 
+// number of writable bytes in front of a buffer returned by getBuffer()
+#define LINK_BUFFER_HEADROOM                            64
+
 
 class Link
 {
@@ -63,10 +68,16 @@ public:
     {
         return m_blockSize;
     }
-    virtual int getBuffer(uint8_t **buf, uint32_t *len)
+    // zero-copy receive -- hand out the next *len received bytes in place instead of copying them.
+    // Fails (without consuming anything) if they didn't arrive in one contiguous block.  The buffer
+    // has LINK_BUFFER_HEADROOM writable bytes in front of it and is valid until releaseBuffer().
+    virtual int getBuffer(uint8_t **buf, uint32_t *len, uint16_t timeoutMs=0)
     {
         return LINK_RESULT_ERROR;
     }
+    virtual void releaseBuffer(uint8_t *buf)
+    {
+    }
 
 protected:
     uint32_t m_flags;
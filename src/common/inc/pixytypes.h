@@ -252,6 +252,14 @@ struct BlobC
 	uint8_t m_age;
 };
 
+// a tracked blob where it's predicted to be, see Blobs::getPredictedBlobs()
+struct BlobP
+{
+	BlobC m_blob; // m_x and m_y are predicted
+	int16_t m_vx; // velocity, pixels per second
+	int16_t m_vy;
+};
+
 
 struct HuePixel
 {
@@ -17,7 +17,9 @@
 #include <stdint.h>
 
 #define QQ_LOC        SRAM4_LOC
+#ifndef QQ_SIZE // host builds that queue a whole frame at once need more
 #define QQ_SIZE       0x3c00
+#endif
 #define QQ_MEM_SIZE  ((QQ_SIZE-sizeof(struct QqueueFields)+sizeof(Qval))/sizeof(Qval))
 
 #ifdef __cplusplus  
@@ -0,0 +1,45 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// The run-length front end of color connected components -- what the M0's lineProcessedRL0A()
+// and lineProcessedRL1A() do for each pair of lines -- written so it can run on the M4 or the
+// host.  The per-column arithmetic is done several columns at a time: 2 with the M4's SIMD
+// instructions, 8 with SSE2, and in plain loops that the compiler can vectorize elsewhere.
+// The Qvals are the same, bit for bit, as the M0's (see host/benchmarks/rls_host.c).
+
+#ifndef _RLSLINE_H
+#define _RLSLINE_H
+
+#include <stdint.h>
+#include "qqueue.h"
+
+// columns (2 pixels each) per line that rlsLine() handles
+#define RLS_LINE_MAX_COLS     320
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// bgLine is a blue/green line of a BA81 frame and grLine the green/red line below it, cols*2
+// pixels each.  lut is the CL_LUT_SIZE byte LUT from ColorLUT::generateLUT().  Writes the Qvals
+// for the pair of lines (not the line begin marker) to qvals, which needs room for cols/3+2,
+// and returns how many there are.
+uint32_t rlsLine(const uint8_t *bgLine, const uint8_t *grLine, const uint8_t *lut, Qval *qvals, uint32_t cols);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -118,8 +118,6 @@ CBlob::CBlob()
 CBlob::~CBlob() 
 {
     DBG_BLOB(leakcheck--);
-    // Free segments, if any
-    Reset();
 }
 
 void 
@@ -134,13 +132,8 @@ CBlob::Reset()
     lastBottom.row = lastBottom.invalid_row;
     nextBottom.row = nextBottom.invalid_row;
 
-    // Delete segments if any
-    SLinkedSegment *tmp;
-    while(firstSegment!=NULL) {
-        tmp = firstSegment;
-        firstSegment = tmp->next;
-        delete tmp;
-    }
+    // Forget segments if any (they're freed with the arena)
+    firstSegment= NULL;
     lastSegmentPtr= &firstSegment;
 }
 
@@ -179,13 +172,14 @@ CBlob::Add(const SSegment &segment)
         assert(test == segmentMoments);
 #endif
     }
-    if (recordSegments) {
-        // Add segment to the _end_ of the linked list
-        *lastSegmentPtr= new (std::nothrow) SLinkedSegment(segment);
-        if (*lastSegmentPtr==NULL)
-            return;
-        lastSegmentPtr= &((*lastSegmentPtr)->next);
-    }
+}
+
+void 
+CBlob::Append(SLinkedSegment *linked) 
+{
+    // Add segment to the _end_ of the linked list
+    *lastSegmentPtr= linked;
+    lastSegmentPtr= &linked->next;
 }
 
 // This takes futileResister and assimilates it into this blob
@@ -232,6 +226,115 @@ CBlob::UpdateBoundingBox(int newLeft, int newTop, int newRight)
     if (newRight > right) right= newRight;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// CBlobArena
+
+CBlobArena::CBlobArena() 
+{
+    blocks= current= NULL;
+    used= 0;
+    freeBlobs= NULL;
+}
+
+CBlobArena::~CBlobArena() 
+{
+    Block *block;
+
+    while (blocks) {
+        block= blocks;
+        blocks= block->next;
+        delete block;
+    }
+}
+
+void *
+CBlobArena::Alloc(unsigned int size) 
+{
+    void *ptr;
+    Block *next;
+
+    // keep everything pointer-aligned
+    size= (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (current==NULL || used + size > CBA_ARENA_SIZE) {
+        // move on to the next block, allocating it if Reset() hasn't kept one
+        next= current ? current->next : blocks;
+        if (next==NULL) {
+            next= new (std::nothrow) Block;
+            if (next==NULL)
+                return NULL;
+            next->next= NULL;
+            if (current)
+                current->next= next;
+            else
+                blocks= next;
+        }
+        current= next;
+        used= 0;
+    }
+    ptr= current->mem + used;
+    used += size;
+    return ptr;
+}
+
+CBlob *
+CBlobArena::NewBlob() 
+{
+    void *ptr;
+
+    if (freeBlobs) {
+        ptr= freeBlobs;
+        freeBlobs= freeBlobs->next;
+    }
+    else if ((ptr= Alloc(sizeof(CBlob)))==NULL)
+        return NULL;
+    return new (ptr) CBlob();
+}
+
+// The blob's segments, if any, stay allocated until Reset()
+void 
+CBlobArena::FreeBlob(CBlob *blob) 
+{
+    blob->~CBlob();
+    blob->next= freeBlobs;
+    freeBlobs= blob;
+}
+
+SLinkedSegment *
+CBlobArena::NewSegment(const SSegment &segment) 
+{
+    void *ptr= Alloc(sizeof(SLinkedSegment));
+    if (ptr==NULL)
+        return NULL;
+    return new (ptr) SLinkedSegment(segment);
+}
+
+// Blobs and segments have trivial destructors, so there's nothing to do but
+// rewind.  The first few blocks are kept for the next frame, the rest go back to
+// the heap so one busy frame doesn't hold on to its memory for good.
+void 
+CBlobArena::Reset() 
+{
+    Block *block, *next;
+    int i;
+
+    block= blocks;
+    for (i= 1; block && i<CBA_KEEP_BLOCKS; i++)
+        block= block->next;
+    if (block) {
+        next= block->next;
+        block->next= NULL;
+        while (next) {
+            block= next;
+            next= block->next;
+            delete block;
+        }
+    }
+
+    current= NULL;
+    used= 0;
+    freeBlobs= NULL;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // CBlobAssembler
 
@@ -242,16 +345,29 @@ CBlobAssembler::CBlobAssembler()
     currentRow=-1;
     maxRowDelta=1;
     m_blobCount=0;
+    m_dropped=0;
 }
 
 CBlobAssembler::~CBlobAssembler() 
 {
     // Flush any active blobs into finished blobs
     EndFrame();
-    // Free any finished blobs
+    // Free any finished blobs (the arena frees its blocks)
     Reset();
 }
 
+void 
+CBlobAssembler::AddSegment(CBlob *blob, const SSegment &segment) 
+{
+    blob->Add(segment);
+    if (CBlob::recordSegments) {
+        SLinkedSegment *linked= m_arena.NewSegment(segment);
+        // if the arena is full the blob just doesn't get this segment's record
+        if (linked)
+            blob->Append(linked);
+    }
+}
+
 // Call once for each segment in the color channel
 int CBlobAssembler::Add(const SSegment &segment) {
     if (segment.row != currentRow) {
@@ -271,7 +387,7 @@ int CBlobAssembler::Add(const SSegment &segment) {
                 break;
             } else {
                 // Found a blob to connect to
-                currentBlob->Add(segment);
+                AddSegment(currentBlob, segment);
                 // Check to see if we attach to multiple blobs
                 while(currentBlob->next &&
                       segment.endCol >= currentBlob->next->lastBottom.startCol) {
@@ -302,7 +418,7 @@ int CBlobAssembler::Add(const SSegment &segment) {
                     //     << ", area " << currentBlob->moments.area << endl;
 
                     // Delete it
-                    delete futileResister;
+                    m_arena.FreeBlob(futileResister);
 
                     BlobNewRow(&currentBlob->next);
                 }
@@ -312,29 +428,40 @@ int CBlobAssembler::Add(const SSegment &segment) {
     }
     
     // Could not attach to previous blob, insert new one before currentBlob
-    CBlob *newBlob= new (std::nothrow) CBlob();
+    CBlob *newBlob= m_arena.NewBlob();
     if (newBlob==NULL)
     {
-        DBG("blobs %d\nheap full", m_blobCount);
+        // Drop the segment.  Blobs we already have keep growing, and the
+        // other assemblers are unaffected.
+        if (m_dropped++==0)
+            DBG("blobs %d\narena full", m_blobCount);
         return -1;
     }
     m_blobCount++;
     newBlob->next= currentBlob;
     *previousBlobPtr= newBlob;
     previousBlobPtr= &newBlob->next;
-    newBlob->Add(segment);
+    AddSegment(newBlob, segment);
     return 0;
 }
 
 // Call at end of frame
 // Moves all active blobs to finished list
 void CBlobAssembler::EndFrame() {
+    short left, top, right, bottom;
+
     while (activeBlobs) {
-        activeBlobs->NewRow();
-        CBlob *tmp= activeBlobs->next;
-        activeBlobs->next= finishedBlobs;
-        finishedBlobs= activeBlobs;
-        activeBlobs= tmp;
+        CBlob *blob= activeBlobs;
+        activeBlobs= blob->next;
+        blob->NewRow();
+        // same height constraint as BlobNewRow
+        blob->getBBox(left, top, right, bottom);
+        if (bottom-top>1) {
+            blob->next= finishedBlobs;
+            finishedBlobs= blob;
+        }
+        else
+            m_arena.FreeBlob(blob);
     }
 }
 
@@ -364,13 +491,22 @@ void CBlobAssembler::SplitList(CBlob *all,
     *nextptr= NULL;
 }
 
+// True if blob a goes before blob b in a sorted list
+static inline bool Before(const CBlob *a, const CBlob *b) {
+    if (a->moments.area != b->moments.area)
+        return a->moments.area > b->moments.area;
+    if (a->top != b->top)
+        return a->top < b->top;
+    return a->left < b->left;
+}
+
 // Merge maxelts elements from old1 and old2 into newptr
 void CBlobAssembler::MergeLists(CBlob *&old1, CBlob *&old2,
                                 CBlob **&newptr, int maxelts) {
     int n1= maxelts, n2= maxelts;
     while (1) {
         if (n1 && old1) {
-            if (n2 && old2 && old2->moments.area > old1->moments.area) {
+            if (n2 && old2 && Before(old2, old1)) {
                 // Choose old2
                 *newptr= old2;
                 newptr= &(*newptr)->next;
@@ -404,20 +540,20 @@ void len_error() {
 }
 #endif
 
-// Sorts finishedBlobs in order of descending area using an in-place
+// Sorts a list of blobs in order of descending area using an in-place
 // merge sort (time n log n)
-void CBlobAssembler::SortFinished() {
-    // Divide finishedBlobs into two lists
+void CBlobAssembler::SortList(CBlob *&blobs) {
+    // Divide blobs into two lists
     CBlob *old1, *old2;
 
-    if(finishedBlobs == NULL) {
+    if(blobs == NULL) {
         return;
     }
 
-    DBG_BLOB(int initial_len= ListLength(finishedBlobs));
-    DBG_BLOB(printf("BSort: Start 0x%x, len=%d\n", finishedBlobs,
+    DBG_BLOB(int initial_len= ListLength(blobs));
+    DBG_BLOB(printf("BSort: Start 0x%x, len=%d\n", blobs,
                initial_len));
-    SplitList(finishedBlobs, old1, old2);
+    SplitList(blobs, old1, old2);
 
     // First merge lists of length 1 into sorted lists of length 2
     // Next, merge sorted lists of length 2 into sorted lists of length 4
@@ -438,14 +574,18 @@ void CBlobAssembler::SortFinished() {
         old1= new1;
         old2= new2;
     }
-    finishedBlobs= old1;
-    DBG_BLOB(AssertFinishedSorted());
-    DBG_BLOB(int final_len= ListLength(finishedBlobs));
-    DBG_BLOB(printf("BSort: DONE  0x%x, len=%d\n", finishedBlobs,
-               ListLength(finishedBlobs)));
+    blobs= old1;
+    DBG_BLOB(int final_len= ListLength(blobs));
+    DBG_BLOB(printf("BSort: DONE  0x%x, len=%d\n", blobs,
+               ListLength(blobs)));
     DBG_BLOB(if (final_len != initial_len) len_error());
 }
 
+void CBlobAssembler::SortFinished() {
+    SortList(finishedBlobs);
+    DBG_BLOB(AssertFinishedSorted());
+}
+
 // Assert that finishedBlobs is in fact sorted.  For testing only.
 void CBlobAssembler::AssertFinishedSorted() {
     if (!finishedBlobs) return;
@@ -463,11 +603,10 @@ void CBlobAssembler::Reset() {
     currentBlob= NULL;
     currentRow=-1;
     m_blobCount=0;
-    while (finishedBlobs) {
-        CBlob *tmp= finishedBlobs->next;
-        delete finishedBlobs;
-        finishedBlobs= tmp;
-    }
+    m_dropped=0;
+    finishedBlobs= NULL;
+    // Free all blobs at once
+    m_arena.Reset();
     DBG_BLOB(printf("after CBlobAssember::Reset, leakcheck=%d\n", CBlob::leakcheck));
 }
 
@@ -515,7 +654,7 @@ CBlobAssembler::BlobNewRow(CBlob **ptr)
                 finishedBlobs= blob;
             }
             else
-                delete blob;
+                m_arena.FreeBlob(blob);
         } else {
             // Blob is valid
             return;
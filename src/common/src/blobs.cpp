@@ -13,6 +13,7 @@
 // end license header
 //
 
+#include <string.h>
 #include "pixy_init.h"
 #include "misc.h"
 #include "cameravals.h"
@@ -25,8 +26,6 @@
 
 Blobs::Blobs(Qqueue *qq, uint8_t *lut) : m_clut(lut)
 {
-    int i;
-
     m_mutex = false;
     m_minArea = MIN_AREA;
     m_maxBlobs = MAX_BLOBS;
@@ -35,10 +34,11 @@ Blobs::Blobs(Qqueue *qq, uint8_t *lut) : m_clut(lut)
 
 	m_qq = qq;
     m_maxCodedDist = MAX_CODED_DIST;
-    m_mergeDist = MAX_MERGE_DIST;
 	m_qvals = NULL;
 
     m_ccMode = DISABLED;
+	m_assembly = m_frameAssembly = LINKED_LIST;
+	m_numSegments = 0;
 
     m_blobs = new (std::nothrow) BlobA[MAX_BLOBS];
     m_numBlobs = 0;
@@ -46,15 +46,27 @@ Blobs::Blobs(Qqueue *qq, uint8_t *lut) : m_clut(lut)
     m_blobReadIndex = 0;
 	m_timer = 0;
 	
+	m_history = new (std::nothrow) BlobHistory[BL_HISTORY_FRAMES];
+	m_historyHead = 0;
+	m_historyCount = 0;
+	m_historyFrame = 0;
+	setTimer(&m_historyTimer);
+	m_historyMs = 0;
+
 	m_sendDetectedPixels = false;
 
+	m_numWindows = 0;
+	m_decimation = 1;
+	m_numRowCols = 0;
+	m_frameTop = 0;
+	m_frameDecimation = 1;
+
 	m_blobTrackerIndex = 0;
 	setBlobFiltering(BL_BLOB_FILTERING);
 	setMaxBlobVelocity(BL_MAX_TRACKING_DIST);
+	m_prediction = true;
 	
-    // reset blob assemblers
-    for (i=0; i<CL_NUM_SIGNATURES; i++)
-        m_assembler[i].Reset();
+    resetAssembly();
 }
 
 void Blobs::reset()
@@ -93,12 +105,19 @@ void Blobs::setColorCodeMode(ColorCodeMode ccMode)
 
 void Blobs::setMaxMergeDist(uint16_t maxMergeDist)
 {
-	m_mergeDist = maxMergeDist;
+	m_merge.setMergeDist(maxMergeDist);
+}
+
+// takes effect with the next frame
+void Blobs::setBlobAssembly(BlobAssembly assembly)
+{
+	m_assembly = assembly;
 }
 
 Blobs::~Blobs()
 {
     delete [] m_blobs;
+    delete [] m_history;
 }
 
 void Blobs::sendQvals()
@@ -117,7 +136,27 @@ void Blobs::addQval(uint32_t qval)
 	}
 }
 
+// only the parts of the segment in the windows, if there are any
 int Blobs::handleSegment(uint8_t signature, uint16_t row, uint16_t startCol, uint16_t length)
+{
+	uint8_t i;
+	uint16_t start, end;
+	int res=0;
+
+	if (m_numWindows==0)
+		return addSegment(signature, row, startCol, length);
+
+	for (i=0; i<m_numRowCols; i++)
+	{
+		start = startCol>m_rowStart[i] ? startCol : m_rowStart[i];
+		end = startCol+length<m_rowEnd[i] ? startCol+length : m_rowEnd[i];
+		if (start<end)
+			res = addSegment(signature, row, start, end-start);
+	}
+	return res;
+}
+
+int Blobs::addSegment(uint8_t signature, uint16_t row, uint16_t startCol, uint16_t length)
 {
 	SSegment s;
 
@@ -133,7 +172,71 @@ int Blobs::handleSegment(uint8_t signature, uint16_t row, uint16_t startCol, uin
     qval |= length<<12;
 
 	addQval(qval);
-    return m_assembler[signature-1].Add(s);
+	m_segments[m_numSegments++] = s;
+	if (m_numSegments==BL_ROW_SEGMENTS)
+		return flushSegments();
+    return 0;
+}
+
+// Assemble the segments addSegment() is holding.  It's called at the end of each row, so the
+// assembly is marked once per row instead of around every segment.
+int Blobs::flushSegments()
+{
+	uint8_t i;
+	int res=0;
+
+	if (m_numSegments==0)
+		return 0;
+	BL_PROFILE_MARK(BL_STAGE_ASSEMBLY);
+	for (i=0; i<m_numSegments; i++)
+	{
+		if (m_frameAssembly==UNION_FIND)
+			res = m_unionFind.Add(m_segments[i]);
+		else
+			res = m_assembler[m_segments[i].model-1].Add(m_segments[i]);
+	}
+	m_numSegments = 0;
+	BL_PROFILE_MARK(BL_STAGE_RLS);
+	return res;
+}
+
+// set m_rowStart and m_rowEnd to the columns of the windows that frame row y is in
+void Blobs::windowRow(uint16_t y)
+{
+	uint8_t i, j, n;
+	uint16_t start, end;
+
+	for (i=0, n=0; i<m_numWindows; i++)
+	{
+		if (y<m_windows[i].m_yOffset || y>=m_windows[i].m_yOffset+m_windows[i].m_height)
+			continue;
+		// a column is 2 pixels
+		start = m_windows[i].m_xOffset>>1;
+		end = (m_windows[i].m_xOffset+m_windows[i].m_width+1)>>1;
+		// sorted by start
+		for (j=n++; j>0 && m_rowStart[j-1]>start; j--)
+		{
+			m_rowStart[j] = m_rowStart[j-1];
+			m_rowEnd[j] = m_rowEnd[j-1];
+		}
+		m_rowStart[j] = start;
+		m_rowEnd[j] = end;
+	}
+	// merge windows that overlap, so no part of a segment is added twice
+	for (i=0, j=0; i<n; i++)
+	{
+		if (j>0 && m_rowStart[i]<=m_rowEnd[j-1])
+		{
+			if (m_rowEnd[i]>m_rowEnd[j-1])
+				m_rowEnd[j-1] = m_rowEnd[i];
+		}
+		else
+		{
+			m_rowStart[j] = m_rowStart[i];
+			m_rowEnd[j++] = m_rowEnd[i];
+		}
+	}
+	m_numRowCols = j;
 }
 
 // Blob format:
@@ -145,11 +248,11 @@ int Blobs::handleSegment(uint8_t signature, uint16_t row, uint16_t startCol, uin
 int Blobs::runlengthAnalysis()
 {
 	uint32_t timer;
-    int32_t row=-1, icount=0;
+    int32_t row=-1, icount=0, y, displayRow=0;
     uint32_t startCol, sig, segmentStartCol, segmentEndCol, segmentSig=0;
     Qval qval;
-	register int32_t u, v, c;
-	int res=0, res2=0;
+	register int32_t c;
+	int res=0;
 
 	if (m_sendDetectedPixels)
 	{
@@ -160,7 +263,11 @@ int Blobs::runlengthAnalysis()
 	}
 
     m_numQvals = 0;
+	m_numSegments = 0;
+	// the assembly can be changed while we service chirp below, so latch it for the frame
+	m_frameAssembly = m_assembly;
 
+	BL_PROFILE_MARK(BL_STAGE_RLS);
 	setTimer(&timer);
 	
     while(1)
@@ -170,27 +277,36 @@ int Blobs::runlengthAnalysis()
 			if (getTimer(timer)>100000) // shouldn't take more than 100ms
 			{
 				printf("to\n");
-				res2 = -2; // timeout
+				res = -2; // timeout
 				goto end;
 			}
 		}
         if (qval.m_col>=0xfffe)
 		{
 			if (qval.m_col==0xfffe) // error code, queue overrun
-				res2 = -1; // queue overrun 
+				res = -1; // queue overrun 
             goto end;
 		}
-		if (res<0)
-			continue;
         if (qval.m_col==0)
         {
             if (segmentSig)
             {
-                res = handleSegment(segmentSig, row, segmentStartCol-1, segmentEndCol - segmentStartCol+1);
+                handleSegment(segmentSig, row, segmentStartCol-1, segmentEndCol - segmentStartCol+1);
                 segmentSig = 0;
             }
+            flushSegments();
             row++;
-			addQval(0);
+			if (row==0) // the first row says which rows the M0 is doing, see rls_m0.h
+			{
+				m_frameTop = qval.m_u;
+				m_frameDecimation = qval.m_v>1 ? qval.m_v : 1;
+			}
+			y = m_frameTop + row*m_frameDecimation;
+			if (m_numWindows)
+				windowRow(y);
+			// a line for each row of the frame, including the ones the M0 skipped
+			for (; displayRow<=y; displayRow++)
+				addQval(0);
 			if (icount++==5) // an interleave of every 5 lines or about every 175us seems good
 			{
 				g_chirpUsb->service();
@@ -199,21 +315,18 @@ int Blobs::runlengthAnalysis()
             continue;
         }
 
-        sig = qval.m_col&0x07;
+        // nothing to do on rows outside the windows
+        if (m_numWindows && m_numRowCols==0)
+            continue;
 
-        u = qval.m_u;
-        v = qval.m_v;
+        sig = qval.m_col&0x07;
 
-        u <<= CL_LUT_ENTRY_SCALE;
-        v <<= CL_LUT_ENTRY_SCALE;
         c = qval.m_y;
         if (c==0)
             c = 1;
-        u /= c;
-        v /= c;
 
-        if (m_clut.m_runtimeSigs[sig-1].m_uMin<u && u<m_clut.m_runtimeSigs[sig-1].m_uMax &&
-                m_clut.m_runtimeSigs[sig-1].m_vMin<v && v<m_clut.m_runtimeSigs[sig-1].m_vMax && c>=(int32_t)m_clut.m_miny)
+        // no divides here -- see ColorLUT::inBounds()
+        if (c>=(int32_t)m_clut.m_miny && ColorLUT::inBounds(m_clut.m_runtimeSigs[sig-1], qval.m_u, qval.m_v, c))
         {
          	qval.m_col >>= 3;
         	startCol = qval.m_col;
@@ -230,7 +343,7 @@ int Blobs::runlengthAnalysis()
 					segmentEndCol = startCol+1;
 				else
 				{
-					res = handleSegment(segmentSig, row, segmentStartCol, segmentEndCol - segmentStartCol);
+					handleSegment(segmentSig, row, segmentStartCol, segmentEndCol - segmentStartCol);
 					segmentStartCol = startCol;
 					segmentEndCol = startCol+1;
 				}
@@ -239,7 +352,7 @@ int Blobs::runlengthAnalysis()
 			{
 				if (startCol-segmentEndCol<=5)
 					segmentEndCol = startCol;
-                res = handleSegment(segmentSig, row, segmentStartCol, segmentEndCol - segmentStartCol);
+                handleSegment(segmentSig, row, segmentStartCol, segmentEndCol - segmentStartCol);
                 segmentSig = sig;
                 segmentStartCol = startCol;
 				segmentEndCol = startCol+1;
@@ -254,9 +367,10 @@ int Blobs::runlengthAnalysis()
 		free(m_qvals);
 		m_qvals = NULL;
 	}
+	flushSegments();
 	endFrame();
 	
-	return res2;
+	return res;
 }
 
 int Blobs::blobify()
@@ -271,10 +385,10 @@ int Blobs::blobify()
 
 	if (runlengthAnalysis()<0)
 	{
-   	 	for (i=0; i<CL_NUM_SIGNATURES; i++)
-        	m_assembler[i].Reset();
+		resetAssembly();
     	m_numBlobs = 0;
 		m_numCCBlobs = 0;
+		BL_PROFILE_MARK(BL_STAGES);
 		return -1;
 	}
 
@@ -287,13 +401,15 @@ int Blobs::blobify()
 
     for (i=0, m_numBlobs=0, m_numCCBlobs=0; i<CL_NUM_SIGNATURES; i++)
     {
+        BL_PROFILE_MARK(BL_STAGE_ASSEMBLY);
         colorCode = CC_SIGNATURE(i+1);
 
-        for (k=0, blobsStart=m_blobs+m_numBlobs, numBlobsStart=m_numBlobs, blob=m_assembler[i].finishedBlobs;
+        for (k=0, blobsStart=m_blobs+m_numBlobs, numBlobsStart=m_numBlobs, blob=finishedBlobs(i+1);
              blob && m_numBlobs<m_maxBlobs && k<m_maxBlobsPerModel; blob=blob->next, k++)
         {
-            if ((colorCode && blob->GetArea()<MIN_COLOR_CODE_AREA) ||
-                (!colorCode && blob->GetArea()<(int)m_minArea))
+            // with decimation, each row stands for m_frameDecimation rows
+            if ((colorCode && blob->GetArea()*m_frameDecimation<MIN_COLOR_CODE_AREA) ||
+                (!colorCode && blob->GetArea()*m_frameDecimation<(int)m_minArea))
                 continue;
             blob->getBBox((short &)left, (short &)top, (short &)right, (short &)bottom);
             if (bottom-top<=1) // blobs that are 1 line tall
@@ -301,16 +417,18 @@ int Blobs::blobify()
             m_blobs[m_numBlobs].m_model = i+1;
             m_blobs[m_numBlobs].m_left = left<<1;
             m_blobs[m_numBlobs].m_right = right<<1;
-            m_blobs[m_numBlobs].m_top = top;
-            m_blobs[m_numBlobs].m_bottom = bottom;
+            m_blobs[m_numBlobs].m_top = m_frameTop + top*m_frameDecimation;
+            m_blobs[m_numBlobs].m_bottom = m_frameTop + bottom*m_frameDecimation;
+            m_blobs[m_numBlobs].m_angle = 0; // only color codes have an angle
             m_numBlobs++;
         }
         //setTimer(&timer);
+        BL_PROFILE_MARK(BL_STAGE_COMBINE);
         if (!colorCode) // do not combine color code models
         {
             while(1)
             {
-                invalid2 = combine2(blobsStart, m_numBlobs-numBlobsStart);
+                invalid2 = m_merge.combine2(blobsStart, m_numBlobs-numBlobsStart);
                 if (invalid2==0)
                     break;
                 invalid += invalid2;
@@ -319,12 +437,14 @@ int Blobs::blobify()
         //timer2 += getTimer(timer);
     }
     //setTimer(&timer);
-    invalid += combine(m_blobs, m_numBlobs);
+    invalid += m_merge.combine(m_blobs, m_numBlobs);
     if (m_ccMode!=DISABLED)
     {
         m_ccBlobs = m_blobs + m_numBlobs;
         // calculate number of codedblobs left
+        BL_PROFILE_MARK(BL_STAGE_CC);
         processCC();
+        BL_PROFILE_MARK(BL_STAGE_COMBINE);
     }
 	// remove empty blobs -- note blobs can be made empty by CC algorithm
     if (invalid || m_ccMode!=DISABLED)
@@ -340,12 +460,15 @@ int Blobs::blobify()
     // reset read index-- new frame
     m_blobReadIndex = 0;
 
+	BL_PROFILE_MARK(BL_STAGE_TRACKING);
 	handleBlobTracking();
+	recordHistory();
     m_mutex = false;
 
     // free memory
-    for (i=0; i<CL_NUM_SIGNATURES; i++)
-        m_assembler[i].Reset();
+	BL_PROFILE_MARK(BL_STAGE_ASSEMBLY);
+	resetAssembly();
+	BL_PROFILE_MARK(BL_STAGES);
 
 #if 0
     static int frame = 0;
@@ -499,20 +622,14 @@ int compAreaBlobC(const void *a, const void *b)
 }
 
 
-int Blobs::getBlobs(uint8_t sigmap, uint8_t n, uint8_t *buf, uint16_t len)
+// copy the tracked blobs that match sigmap into blobs, sorted by area (biggest first)
+uint16_t Blobs::assembleBlobs(uint8_t sigmap, BlobC *blobs, uint16_t len)
 {
-	BlobC *retBlobs;
 	BlobA *blob;
 	uint16_t bi;
 	uint8_t sigbit;
 	SimpleListNode<Tracker<BlobA> > *i;
-	
-	// if we're copying blobs over (m_mutex!=0), or if we've already "gotBlobs" (m_blobReadIndex!=0), return error
-	if (m_mutex || m_blobReadIndex)
-		return -1;
-	
-	retBlobs = (BlobC *)buf;
-	len /= sizeof(BlobC);
+
 	for (i=m_blobTrackersList.m_first, bi=0; i!=NULL && bi<len; i=i->m_next)
 	{
 		blob = i->m_object.get();
@@ -521,16 +638,28 @@ int Blobs::getBlobs(uint8_t sigmap, uint8_t n, uint8_t *buf, uint16_t len)
 			sigbit = (1<<(blob->m_model-1));
 			if ((blob->m_model>CL_NUM_SIGNATURES && sigmap&0x80) || sigbit&sigmap)
 			{
-				convertBlob(&retBlobs[bi], *blob);
-				retBlobs[bi].m_index = i->m_object.m_index;
-				retBlobs[bi].m_age = i->m_object.m_age;
+				convertBlob(&blobs[bi], *blob);
+				blobs[bi].m_index = i->m_object.m_index;
+				blobs[bi].m_age = i->m_object.m_age;
 				bi++;
 			}
 		}
 	}
 
 	// sort blobs by area
-	qsort(retBlobs, bi, sizeof(BlobC), compAreaBlobC);
+	qsort(blobs, bi, sizeof(BlobC), compAreaBlobC);
+	return bi;
+}
+
+int Blobs::getBlobs(uint8_t sigmap, uint8_t n, uint8_t *buf, uint16_t len)
+{
+	uint16_t bi;
+	
+	// if we're copying blobs over (m_mutex!=0), or if we've already "gotBlobs" (m_blobReadIndex!=0), return error
+	if (m_mutex || m_blobReadIndex)
+		return -1;
+	
+	bi = assembleBlobs(sigmap, (BlobC *)buf, len/sizeof(BlobC));
 	m_blobReadIndex = 1; // flag that we "gotBlobs"
 	
 	// note, we need to create a decently-long list so we can sort (above) and then return the n biggest
@@ -546,6 +675,176 @@ SimpleList<Tracker<BlobA> > *Blobs::getBlobs()
 	return &m_blobTrackersList;
 }
 
+static bool sigmapMatch(uint8_t sigmap, uint16_t model)
+{
+	if (model>CL_NUM_SIGNATURES) // color code
+		return sigmap&0x80;
+	return (1<<(model-1))&sigmap;
+}
+
+// called at the end of blobify() (with m_mutex set) -- save this frame's biggest blocks in the ring
+void Blobs::recordHistory()
+{
+	BlobHistory *frame;
+	BlobA *blob;
+	BlobC blobc;
+	SimpleListNode<Tracker<BlobA> > *i;
+	uint32_t t, area;
+	uint16_t dropped;
+	uint8_t j;
+
+	if (m_history==NULL)
+		return;
+
+	// keep time in whole milliseconds, carrying the remainder over to the next frame
+	t = getTimer(m_historyTimer);
+	m_historyTimer += t - t%1000;
+	m_historyMs += t/1000;
+
+	if (m_historyCount==BL_HISTORY_FRAMES) // full, overwrite oldest
+	{
+		m_historyHead = (m_historyHead+1)%BL_HISTORY_FRAMES;
+		m_historyCount--;
+	}
+	frame = &m_history[(m_historyHead+m_historyCount)%BL_HISTORY_FRAMES];
+	frame->m_frame = ++m_historyFrame;
+	frame->m_timestamp = m_historyMs;
+	frame->m_numBlobs = 0;
+	// keep the largest BL_HISTORY_BLOBS of all signatures, biggest first, and count the rest
+	for (i=m_blobTrackersList.m_first, dropped=0; i!=NULL; i=i->m_next)
+	{
+		if ((blob=i->m_object.get())==NULL)
+			continue;
+		convertBlob(&blobc, *blob);
+		blobc.m_index = i->m_object.m_index;
+		blobc.m_age = i->m_object.m_age;
+		area = blobc.m_width*blobc.m_height;
+		j = frame->m_numBlobs;
+		if (j==BL_HISTORY_BLOBS)
+		{
+			dropped++;
+			if (area<=(uint32_t)frame->m_blobs[j-1].m_width*frame->m_blobs[j-1].m_height)
+				continue;
+			j--;
+		}
+		else
+			frame->m_numBlobs++;
+		for (; j>0 && area>(uint32_t)frame->m_blobs[j-1].m_width*frame->m_blobs[j-1].m_height; j--)
+			frame->m_blobs[j] = frame->m_blobs[j-1];
+		frame->m_blobs[j] = blobc;
+	}
+	frame->m_dropped = dropped<0xff ? dropped : 0xff;
+	m_historyCount++;
+}
+
+// Copy the frames recorded after lastFrame into buf -- a uint8_t frame count, a uint8_t flag that's
+// set if there are more frames than fit, 2 bytes of padding, then for each frame a BlobHistoryHeader
+// followed by its blocks (n at most, matching sigmap).  If lastFrame is no longer in the ring
+// (or never was), all recorded frames are returned.
+int Blobs::getBlobHistory(uint8_t sigmap, uint8_t n, uint16_t lastFrame, uint8_t *buf, uint16_t len)
+{
+	uint8_t f, numFrames;
+	uint16_t i, j, offset;
+	BlobHistory *frame;
+	BlobHistoryHeader *header;
+	BlobC *blobs;
+
+	if (m_mutex || m_history==NULL)
+		return -1;
+
+	// find the first frame after lastFrame
+	for (f=0; f<m_historyCount && m_history[(m_historyHead+f)%BL_HISTORY_FRAMES].m_frame!=lastFrame; f++);
+	f = f==m_historyCount ? 0 : f+1;
+
+	for (numFrames=0, offset=4; f<m_historyCount; f++, numFrames++)
+	{
+		frame = &m_history[(m_historyHead+f)%BL_HISTORY_FRAMES];
+		for (i=0, j=0; i<frame->m_numBlobs && j<n; i++)
+		{
+			if (sigmapMatch(sigmap, frame->m_blobs[i].m_model))
+				j++;
+		}
+		// only whole frames
+		if (offset+sizeof(BlobHistoryHeader)+j*sizeof(BlobC)>len)
+			break;
+		header = (BlobHistoryHeader *)(buf+offset);
+		header->m_frame = frame->m_frame;
+		header->m_numBlobs = j;
+		header->m_dropped = frame->m_dropped;
+		header->m_timestamp = frame->m_timestamp;
+		blobs = (BlobC *)(buf+offset+sizeof(BlobHistoryHeader));
+		for (i=0, j=0; i<frame->m_numBlobs && j<header->m_numBlobs; i++)
+		{
+			if (sigmapMatch(sigmap, frame->m_blobs[i].m_model))
+				blobs[j++] = frame->m_blobs[i];
+		}
+		offset += sizeof(BlobHistoryHeader) + j*sizeof(BlobC);
+	}
+	buf[0] = numFrames;
+	buf[1] = f<m_historyCount;
+	buf[2] = buf[3] = 0;
+
+	return offset;
+}
+
+static int compAreaBlobP(const void *a, const void *b)
+{
+	BlobP *ba=(BlobP *)a, *bb=(BlobP *)b;
+	return bb->m_blob.m_width*bb->m_blob.m_height - ba->m_blob.m_width*ba->m_blob.m_height;
+}
+
+// Like getBlobs(), but the blocks are where their trackers predict they are aheadMs after now (the
+// request), along with their velocities.  It doesn't wait for a new frame, the prediction is
+// for whenever it's called.
+int Blobs::getPredictedBlobs(uint8_t sigmap, uint8_t n, uint16_t aheadMs, uint8_t *buf, uint16_t len)
+{
+	BlobA blob;
+	BlobP *blobs=(BlobP *)buf;
+	uint16_t bi;
+	uint32_t aheadUs;
+	SimpleListNode<Tracker<BlobA> > *i;
+
+	if (m_mutex)
+		return -1;
+
+	aheadUs = getTimer(m_timer) + aheadMs*1000; // m_timer is when the last frame was tracked
+	for (i=m_blobTrackersList.m_first, bi=0; i!=NULL && bi<len/sizeof(BlobP); i=i->m_next)
+	{
+		if (i->m_object.get()==NULL || !sigmapMatch(sigmap, i->m_object.m_object.m_model))
+			continue;
+		predictBlob(i->m_object, aheadUs, &blob);
+		convertBlob(&blobs[bi].m_blob, blob);
+		blobs[bi].m_blob.m_index = i->m_object.m_index;
+		blobs[bi].m_blob.m_age = i->m_object.m_age;
+		blobs[bi].m_vx = i->m_object.m_vx;
+		blobs[bi].m_vy = i->m_object.m_vy;
+		bi++;
+	}
+
+	qsort(blobs, bi, sizeof(BlobP), compAreaBlobP);
+	if (n<bi)
+		bi = n;
+	return bi*sizeof(BlobP);
+}
+
+// the tracker's blob moved to where it's predicted to be aheadUs after its last frame, kept
+// in the positive quadrant
+void Blobs::predictBlob(const Tracker<BlobA> &tracker, uint32_t aheadUs, BlobA *blob)
+{
+	int32_t dx, dy;
+
+	*blob = tracker.m_object;
+	tracker.predict(&dx, &dy, aheadUs);
+	if (dx<-(int32_t)blob->m_left)
+		dx = -blob->m_left;
+	if (dy<-(int32_t)blob->m_top)
+		dy = -blob->m_top;
+	blob->m_left += dx;
+	blob->m_right += dx;
+	blob->m_top += dy;
+	blob->m_bottom += dy;
+}
+
 uint16_t Blobs::compress(BlobA *blobs, uint16_t numBlobs)
 {
     uint16_t i, invalid;
@@ -584,13 +883,129 @@ void Blobs::shift()
 }
 
 
-uint16_t Blobs::combine(BlobA *blobs, uint16_t numBlobs)
+BlobMerge::BlobMerge()
+{
+    m_mergeDist = MAX_MERGE_DIST;
+    m_every = true;
+}
+
+void BlobMerge::setMergeDist(uint16_t mergeDist)
+{
+    m_mergeDist = mergeDist;
+}
+
+// sets the bit of each valid blob in the cells its box touches
+void BlobMerge::build(const BlobA *blobs, uint16_t numBlobs)
+{
+    uint16_t i, row, col, left, right, top, bottom;
+    uint32_t bit;
+
+    m_every = numBlobs<BL_MERGE_MIN_BLOBS;
+    if (m_every)
+        return;
+    memset(m_cells, 0, sizeof(m_cells));
+    for (i=0; i<numBlobs; i++)
+    {
+        if (blobs[i].m_model==0)
+            continue;
+        left = blobs[i].m_left>>BL_MERGE_CELL_SHIFT;
+        right = blobs[i].m_right>>BL_MERGE_CELL_SHIFT;
+        top = blobs[i].m_top>>BL_MERGE_CELL_SHIFT;
+        bottom = blobs[i].m_bottom>>BL_MERGE_CELL_SHIFT;
+        if (right>=BL_MERGE_COLS)
+            right = BL_MERGE_COLS-1;
+        if (bottom>=BL_MERGE_ROWS)
+            bottom = BL_MERGE_ROWS-1;
+        if (left>right)
+            left = right;
+        if (top>bottom)
+            top = bottom;
+        bit = 1UL<<(i&31);
+        for (row=top; row<=bottom; row++)
+        {
+            for (col=left; col<=right; col++)
+                m_cells[row*BL_MERGE_COLS+col][i>>5] |= bit;
+        }
+    }
+}
+
+// m_found = the blobs whose cells overlap the box's -- every blob whose box touches it, and some others.
+// Without the grid next() goes through every blob instead.
+void BlobMerge::find(int32_t left, int32_t right, int32_t top, int32_t bottom)
+{
+    int32_t row, col;
+    uint16_t i;
+    uint32_t *cell;
+
+    if (m_every)
+        return;
+    left = left<0 ? 0 : left>>BL_MERGE_CELL_SHIFT;
+    right = right<0 ? 0 : right>>BL_MERGE_CELL_SHIFT;
+    top = top<0 ? 0 : top>>BL_MERGE_CELL_SHIFT;
+    bottom = bottom<0 ? 0 : bottom>>BL_MERGE_CELL_SHIFT;
+    if (right>=BL_MERGE_COLS)
+        right = BL_MERGE_COLS-1;
+    if (bottom>=BL_MERGE_ROWS)
+        bottom = BL_MERGE_ROWS-1;
+    if (left>right)
+        left = right;
+    if (top>bottom)
+        top = bottom;
+
+    memset(m_found, 0, sizeof(m_found));
+    for (row=top; row<=bottom; row++)
+    {
+        for (col=left; col<=right; col++)
+        {
+            cell = m_cells[row*BL_MERGE_COLS+col];
+            for (i=0; i<BL_MERGE_WORDS; i++)
+                m_found[i] |= cell[i];
+        }
+    }
+}
+
+// advances *j to the next blob in m_found, returns false if there isn't one before numBlobs
+bool BlobMerge::next(uint16_t *j, uint16_t numBlobs)
+{
+    uint16_t i = *j + 1;
+    uint32_t bits;
+
+    if (m_every)
+    {
+        *j = i;
+        return i<numBlobs;
+    }
+    while (i<numBlobs)
+    {
+        bits = m_found[i>>5]>>(i&31);
+        if (bits==0)
+        {
+            i = (i|31) + 1; // next word
+            continue;
+        }
+        while ((bits&1)==0)
+        {
+            bits >>= 1;
+            i++;
+        }
+        if (i>=numBlobs)
+            break;
+        *j = i;
+        return true;
+    }
+    return false;
+}
+
+uint16_t BlobMerge::combine(BlobA *blobs, uint16_t numBlobs)
 {
     uint16_t i, j, left0, right0, top0, bottom0;
     uint16_t left, right, top, bottom;
     uint16_t invalid;
 
-    // delete blobs that are fully enclosed by larger blobs
+    build(blobs, numBlobs);
+
+    // delete blobs that are fully enclosed by larger blobs.  Either way the two overlap, so only
+    // the blobs in blob i's cells need testing.
     for (i=0, invalid=0; i<numBlobs; i++)
     {
         if (blobs[i].m_model==0)
@@ -600,7 +1015,8 @@ uint16_t Blobs::combine(BlobA *blobs, uint16_t numBlobs)
         top0 = blobs[i].m_top;
         bottom0 = blobs[i].m_bottom;
 
-        for (j=i+1; j<numBlobs; j++)
+        find(left0, right0, top0, bottom0);
+        for (j=i; next(&j, numBlobs); )
         {
             if (blobs[j].m_model==0)
                 continue;
@@ -625,7 +1041,7 @@ uint16_t Blobs::combine(BlobA *blobs, uint16_t numBlobs)
     return invalid;
 }
 
-uint16_t Blobs::merge(uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, uint16_t *D0,
+uint16_t BlobMerge::merge(uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, uint16_t *D0,
            uint16_t *A1, uint16_t *B1, uint16_t *C1, uint16_t *D1)
 {
     bool c0, c1, c2, c3;
@@ -717,11 +1133,13 @@ uint16_t Blobs::merge(uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, ui
     return invalid;
 }
 
-uint16_t Blobs::combine2(BlobA *blobs, uint16_t numBlobs)
+uint16_t BlobMerge::combine2(BlobA *blobs, uint16_t numBlobs)
 {
     uint16_t i, j, *left0, *right0, *top0, *bottom0;
     uint16_t *left1, *right1, *top1, *bottom1, *m1;
-    uint16_t invalid;
+    uint16_t invalid, merged;
+
+    build(blobs, numBlobs);
 
     for (i=0, invalid=0; i<numBlobs; i++)
     {
@@ -732,7 +1150,9 @@ uint16_t Blobs::combine2(BlobA *blobs, uint16_t numBlobs)
         top0 = &blobs[i].m_top;
         bottom0 = &blobs[i].m_bottom;
 
-        for (j=i+1; j<numBlobs; j++)
+        // merge() only takes blobs within m_mergeDist of blob i
+        find(*left0-m_mergeDist, *right0+m_mergeDist, *top0-m_mergeDist, *bottom0+m_mergeDist);
+        for (j=i; next(&j, numBlobs); )
         {
             m1 = &blobs[j].m_model;
             if (*m1==0)
@@ -742,8 +1162,14 @@ uint16_t Blobs::combine2(BlobA *blobs, uint16_t numBlobs)
             top1 = &blobs[j].m_top;
             bottom1 = &blobs[j].m_bottom;
 
-            invalid += merge(m1, left0, right0, top0, bottom0, left1, right1, top1, bottom1);
-            invalid += merge(m1, top0, bottom0, left0, right0, top1, bottom1, left1, right1);
+            merged = merge(m1, left0, right0, top0, bottom0, left1, right1, top1, bottom1);
+            merged += merge(m1, top0, bottom0, left0, right0, top1, bottom1, left1, right1);
+            // blob i grew, so blobs after j that were too far away might not be now
+            if (merged)
+            {
+                invalid += merged;
+                find(*left0-m_mergeDist, *right0+m_mergeDist, *top0-m_mergeDist, *bottom0+m_mergeDist);
+            }
         }
     }
 
@@ -1167,6 +1593,14 @@ void Blobs::processCC()
 void Blobs::endFrame()
 {
     int i;
+
+	BL_PROFILE_MARK(BL_STAGE_ASSEMBLY);
+	if (m_frameAssembly==UNION_FIND)
+	{
+		m_unionFind.EndFrame();
+		m_unionFind.SortFinished();
+		return;
+	}
     for (i=0; i<CL_NUM_SIGNATURES; i++)
     {
         m_assembler[i].EndFrame();
@@ -1174,7 +1608,29 @@ void Blobs::endFrame()
     }
 }
 
-uint32_t Blobs::compareBlobs(const BlobA &b0, const BlobA &b1)
+void Blobs::resetAssembly()
+{
+    int i;
+
+	if (m_frameAssembly==UNION_FIND)
+		m_unionFind.Reset();
+	else
+	{
+    	for (i=0; i<CL_NUM_SIGNATURES; i++)
+        	m_assembler[i].Reset();
+	}
+}
+
+// finished blobs of signature (1-7), sorted by area
+CBlob *Blobs::finishedBlobs(uint8_t signature)
+{
+	if (m_frameAssembly==UNION_FIND)
+		return m_unionFind.finishedBlobs[signature];
+	return m_assembler[signature-1].finishedBlobs;
+}
+
+// b0 is compared where it's predicted to be, dx, dy from where it was
+uint32_t Blobs::compareBlobs(const BlobA &b0, const BlobA &b1, int32_t dx, int32_t dy)
 {
 	int32_t xcenter, ycenter, left, right, top, bottom, vel2;
 	
@@ -1184,8 +1640,8 @@ uint32_t Blobs::compareBlobs(const BlobA &b0, const BlobA &b1)
 	
 	xcenter = (b0.m_left+b0.m_right)>>1;
 	ycenter = (b0.m_top+b0.m_bottom)>>1;
-	xcenter -= (b1.m_left+b1.m_right)>>1;
-	ycenter -= (b1.m_top+b1.m_bottom)>>1;
+	xcenter -= ((b1.m_left+b1.m_right)>>1) - dx;
+	ycenter -= ((b1.m_top+b1.m_bottom)>>1) - dy;
 	
 	vel2 = (xcenter*xcenter + ycenter*ycenter)>>1; // calc dist
 	vel2 *= BL_PERIOD;
@@ -1195,66 +1651,21 @@ uint32_t Blobs::compareBlobs(const BlobA &b0, const BlobA &b1)
 		return TR_MAXVAL; 
 	
 	// find distance between 
-	left = b0.m_left - b1.m_left;
-	right = b0.m_right - b1.m_right;
-	top = b0.m_top - b1.m_top;
-	bottom = b0.m_bottom - b1.m_bottom;
+	left = b0.m_left - b1.m_left + dx;
+	right = b0.m_right - b1.m_right + dx;
+	top = b0.m_top - b1.m_top + dy;
+	bottom = b0.m_bottom - b1.m_bottom + dy;
 	
 	return (left*left + right*right + top*top + bottom*bottom)>>2;
 }
 
 
-uint16_t Blobs::handleBlobTracking2()
-{
-	uint32_t val, min;
-	uint16_t n=0;
-	SimpleListNode<Tracker<BlobA> > *i;
-	uint8_t j;
-	BlobA *minBlob;
-	
-	// go through list, find best candidates
-	for (i=m_blobTrackersList.m_first; i!=NULL; i=i->m_next)
-	{
-		// already found minimum, continue
-		if (i->m_object.m_minVal!=TR_MAXVAL)
-			continue;
-		
-		// find min
-		for (j=0, min=TR_MAXVAL, minBlob=NULL; j<m_numBlobs+m_numCCBlobs; j++)
-		{
-			val = compareBlobs(i->m_object.m_object, m_blobs[j]);
-			// find minimum, but if line is already chosen, make sure we're a better match
-			if (val<min && i->m_object.swappable(val, &m_blobs[j]))  
-			{
-				min = val;
-				minBlob = &m_blobs[j];
-			}
-		}
-		if (minBlob)
-		{
-			// if this minimum line already has a tracker, see which is better
-			if (minBlob->m_tracker)
-			{
-				minBlob->m_tracker->resetMin(); // reset tracker pointed to by current minline
-				minBlob->m_tracker = &i->m_object; 
-				i->m_object.setMin(minBlob, min);
-				n++;
-			}
-			else
-			{
-				minBlob->m_tracker = &i->m_object; // update tracker pointer			
-				i->m_object.setMin(minBlob, min);
-				n++;
-			}
-		}
-	}
-	return n;
-}
-
 void Blobs::handleBlobTracking()
 {
 	SimpleListNode<Tracker<BlobA> > *i, *inext;
 	uint16_t j;
+	int32_t dx, dy;
+	BlobA *b0, *b1;
 	
 	if (m_timer==0)
 		m_timer = BL_PERIOD;
@@ -1267,16 +1678,37 @@ void Blobs::handleBlobTracking()
 	// reset tracking table
 	// Note, we don't need to reset g_linesList entries (e.g. m_tracker) because these are renewed  
 	for (i=m_blobTrackersList.m_first; i!=NULL; i=i->m_next) 
+	{
 		i->m_object.resetMin();
+		i->m_object.addTime(m_timer);
+	}
 	
-	// do search, find minimums
-	while(handleBlobTracking2());
+	// match trackers to blobs, best matches first
+	m_trackAssociation.begin();
+	for (i=m_blobTrackersList.m_first; i!=NULL; i=i->m_next)
+	{
+		dx = dy = 0;
+		if (m_prediction)
+			i->m_object.predict(&dx, &dy);
+		m_trackAssociation.addTracker(&i->m_object);
+		for (j=0; j<m_numBlobs+m_numCCBlobs; j++)
+			m_trackAssociation.add(&m_blobs[j], j, compareBlobs(i->m_object.m_object, m_blobs[j], dx, dy));
+	}
+	m_trackAssociation.assign();
 	
 	// go through, update tracker, remove entries that are no longer valid
 	for (i=m_blobTrackersList.m_first; i!=NULL; i=inext)
 	{
 		inext = i->m_next;
 		
+		// measure the velocity before update() moves m_object
+		if (i->m_object.m_minVal!=TR_MAXVAL)
+		{
+			b0 = &i->m_object.m_object;
+			b1 = i->m_object.m_minObject;
+			i->m_object.motion(((b1->m_left+b1->m_right)>>1) - ((b0->m_left+b0->m_right)>>1), 
+				((b1->m_top+b1->m_bottom)>>1) - ((b0->m_top+b0->m_bottom)>>1));
+		}
 		if (i->m_object.update()&TR_EVENT_INVALIDATED)
 			m_blobTrackersList.remove(i); // no longer valid?  remove from tracker list
 	}	
@@ -1355,6 +1787,66 @@ void Blobs::setMaxBlobVelocity(uint16_t maxVel)
 	m_maxTrackingVel2 = maxVel*maxVel;	
 }
 
+void Blobs::setBlobPrediction(bool prediction)
+{
+	m_prediction = prediction;
+}
+
+// Blocks are only looked for in the windows (up to BL_MAX_WINDOWS rectangles in block
+// coordinates, no windows is the whole frame), and on every decimation'th row.  Windows past
+// the edges of the frame are clipped.  The M0 needs to be told which rows to do, see
+// getRowWindow() and cc_setWindows().
+int Blobs::setWindows(const RectA *windows, uint8_t numWindows, uint8_t decimation)
+{
+	uint8_t i;
+
+	if (numWindows>BL_MAX_WINDOWS || decimation<1 || decimation>BL_MAX_DECIMATION)
+		return -1;
+	for (i=0; i<numWindows; i++)
+	{
+		if (windows[i].m_width==0 || windows[i].m_height==0 ||
+			windows[i].m_xOffset>=CAM_RES2_WIDTH || windows[i].m_yOffset>=CAM_RES2_HEIGHT)
+			return -1;
+	}
+	for (i=0; i<numWindows; i++)
+	{
+		m_windows[i] = windows[i];
+		if (m_windows[i].m_width>CAM_RES2_WIDTH-m_windows[i].m_xOffset)
+			m_windows[i].m_width = CAM_RES2_WIDTH-m_windows[i].m_xOffset;
+		if (m_windows[i].m_height>CAM_RES2_HEIGHT-m_windows[i].m_yOffset)
+			m_windows[i].m_height = CAM_RES2_HEIGHT-m_windows[i].m_yOffset;
+	}
+	m_numWindows = numWindows;
+	m_decimation = decimation;
+
+	return 0;
+}
+
+// the rows that cover all of the windows
+void Blobs::getRowWindow(uint16_t *top, uint16_t *bottom, uint8_t *decimation)
+{
+	uint8_t i;
+
+	if (m_numWindows==0)
+	{
+		*top = 0;
+		*bottom = CAM_RES2_HEIGHT;
+	}
+	else
+	{
+		*top = m_windows[0].m_yOffset;
+		*bottom = m_windows[0].m_yOffset + m_windows[0].m_height;
+		for (i=1; i<m_numWindows; i++)
+		{
+			if (m_windows[i].m_yOffset<*top)
+				*top = m_windows[i].m_yOffset;
+			if (m_windows[i].m_yOffset+m_windows[i].m_height>*bottom)
+				*bottom = m_windows[i].m_yOffset + m_windows[i].m_height;
+		}
+	}
+	*decimation = m_decimation;
+}
+
 
 void Blobs::convertBlob(BlobC *blobc, const BlobA &bloba)
 {
@@ -0,0 +1,276 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <new>
+#include "pixy_init.h"
+#include <blobunion.h>
+
+CBlobUnionFind::CBlobUnionFind()
+{
+    blobs= NULL;
+    parent= NULL;
+    runs= hulls= NULL;
+    Reset();
+}
+
+CBlobUnionFind::~CBlobUnionFind()
+{
+    delete [] blobs;
+    delete [] parent;
+    delete [] runs;
+    delete [] hulls;
+}
+
+// Tables are allocated the first time they're needed and kept, so memory
+// is only used if this engine is
+bool
+CBlobUnionFind::Alloc()
+{
+    blobs= new (std::nothrow) CBlob[BU_MAX_LABELS];
+    parent= new (std::nothrow) unsigned short[BU_MAX_LABELS];
+    runs= new (std::nothrow) SRun[BU_MAX_ROW_RUNS];
+    hulls= new (std::nothrow) SRun[BU_MAX_ROW_RUNS];
+    if (blobs==NULL || parent==NULL || runs==NULL || hulls==NULL) {
+        delete [] blobs;
+        delete [] parent;
+        delete [] runs;
+        delete [] hulls;
+        blobs= NULL;
+        parent= NULL;
+        runs= hulls= NULL;
+        return false;
+    }
+    return true;
+}
+
+void
+CBlobUnionFind::Reset()
+{
+    int i;
+
+    for (i=0; i<BU_MODELS; i++) {
+        finishedBlobs[i]= NULL;
+        runHead[i]= runTail[i]= hullCursor[i]= BU_NONE;
+    }
+    numLabels= 0;
+    freeBlobs= NULL;
+    numRuns= 0;
+    currentRow= -1;
+    collectRow= 0;
+    m_dropped= 0;
+}
+
+// Find the root label, halving the path as we go
+unsigned short
+CBlobUnionFind::Find(unsigned short label)
+{
+    while (parent[label]!=label) {
+        parent[label]= parent[parent[label]];
+        label= parent[label];
+    }
+    return label;
+}
+
+// root1 joins root0.  Returns the new root.
+unsigned short
+CBlobUnionFind::Union(unsigned short root0, unsigned short root1)
+{
+    CBlob *blob0= blobs + root0;
+    CBlob *blob1= blobs + root1;
+
+    parent[root1]= root0;
+    blob0->moments.Add(blob1->moments);
+    blob0->UpdateBoundingBox(blob1->left, blob1->top, blob1->right);
+    if (blob1->lastBottom.row > blob0->lastBottom.row)
+        blob0->lastBottom.row= blob1->lastBottom.row;
+    return root0;
+}
+
+unsigned short
+CBlobUnionFind::NewLabel(unsigned char model)
+{
+    CBlob *blob;
+    unsigned short label;
+
+    if (freeBlobs==NULL && numLabels==BU_MAX_LABELS && currentRow>=collectRow)
+        Collect();
+    if (freeBlobs) {
+        blob= freeBlobs;
+        freeBlobs= blob->next;
+    }
+    else if (numLabels<BU_MAX_LABELS)
+        blob= blobs + numLabels++;
+    else
+        return BU_NONE;
+
+    label= blob - blobs;
+    parent[label]= label;
+    blob->Reset();
+    blob->lastBottom.model= model;
+    return label;
+}
+
+// Out of labels, so look for ones that can be used again.  Components that have finished (nothing on the previous row or this
+// one) don't need their non-root labels any more, and the ones less than 3
+// rows tall won't be reported, like the blobs CBlobAssembler::BlobNewRow
+// deletes.  Model 0 marks a free label.
+void
+CBlobUnionFind::Collect()
+{
+    unsigned short label, root;
+    CBlob *blob;
+
+    for (label=0, blob=blobs; label<numLabels; label++, blob++) {
+        if (blob->lastBottom.model==0)
+            continue;
+        // a freed root still leads to its bottom row
+        root= Find(label);
+        if (blobs[root].lastBottom.row + 1 >= currentRow)
+            continue;
+        if (root==label && blob->lastBottom.row - blob->top > 1)
+            continue;
+        blob->lastBottom.model= 0;
+        blob->next= freeBlobs;
+        freeBlobs= blob;
+    }
+    // Try again next row, or if nothing turned up, give it some rows
+    collectRow= currentRow + (freeBlobs ? 1 : BU_COLLECT_ROWS);
+}
+
+// The current row's spans become the surface
+void
+CBlobUnionFind::NewRow(short row)
+{
+    int m;
+    SRun *tmp;
+
+    tmp= hulls;
+    hulls= runs;
+    runs= tmp;
+    for (m=0; m<BU_MODELS; m++) {
+        // with a row of no segments in between, there's nothing to attach to
+        hullCursor[m]= row==currentRow+1 ? runHead[m] : BU_NONE;
+        runHead[m]= runTail[m]= BU_NONE;
+    }
+    numRuns= 0;
+    currentRow= row;
+}
+
+int
+CBlobUnionFind::Add(const SSegment &segment)
+{
+    unsigned short i, label, root, tail;
+    unsigned char model= segment.model;
+    CBlob *blob;
+    SRun *run;
+    SMoments segmentMoments;
+
+    if (runs==NULL && !Alloc()) {
+        if (m_dropped++==0)
+            DBG("blobs\nno memory");
+        return -1;
+    }
+
+    if (segment.row != currentRow)
+        NewRow(segment.row);
+
+    if (numRuns==BU_MAX_ROW_RUNS)
+        goto drop;
+
+    // Skip spans entirely to the left.  Segments come left to right, so
+    // the next segment won't need them either.
+    for (i=hullCursor[model]; i!=BU_NONE && hulls[i].endCol<segment.startCol; i=hulls[i].next);
+    hullCursor[model]= i;
+
+    // Join every component this segment touches.  The leftmost stays the
+    // root, so segments to the left on this row keep their labels.
+    for (label=BU_NONE; i!=BU_NONE && hulls[i].startCol<=segment.endCol; i=hulls[i].next) {
+        root= Find(hulls[i].label);
+        if (label==BU_NONE)
+            label= root;
+        else if (root!=label)
+            label= Union(label, root);
+    }
+
+    if (label==BU_NONE && (label= NewLabel(model))==BU_NONE)
+        goto drop;
+
+    // Grow the bounding box.  Segments come top to bottom, so this row is the bottom.
+    blob= blobs + label;
+    if (segment.startCol < blob->left)
+        blob->left= segment.startCol;
+    if (segment.endCol > blob->right)
+        blob->right= segment.endCol;
+    if (segment.row < blob->top)
+        blob->top= segment.row;
+    blob->lastBottom.row= segment.row;
+    segment.GetMoments(segmentMoments);
+    blob->moments.Add(segmentMoments);
+
+    // Extend the component's span, or start a new one
+    tail= runTail[model];
+    if (tail!=BU_NONE && runs[tail].label==label)
+        runs[tail].endCol= segment.endCol;
+    else {
+        run= runs + numRuns;
+        run->startCol= segment.startCol;
+        run->endCol= segment.endCol;
+        run->label= label;
+        run->next= BU_NONE;
+        if (tail==BU_NONE)
+            runHead[model]= numRuns;
+        else
+            runs[tail].next= numRuns;
+        runTail[model]= numRuns++;
+    }
+    return 0;
+
+drop:
+    // Components we already have keep growing
+    if (m_dropped++==0)
+        DBG("blobs %d\nlabels full", numLabels);
+    return -1;
+}
+
+void
+CBlobUnionFind::EndFrame()
+{
+    int i;
+    unsigned short label;
+    CBlob *blob;
+
+    for (i=0; i<BU_MODELS; i++)
+        finishedBlobs[i]= NULL;
+
+    // Every root is a component.  Like CBlobAssembler, drop the ones less
+    // than 3 rows tall.
+    for (label=0, blob=blobs; label<numLabels; label++, blob++) {
+        if (parent[label]!=label || blob->lastBottom.model==0)
+            continue;
+        if (blob->lastBottom.row - blob->top <= 1)
+            continue;
+        blob->next= finishedBlobs[blob->lastBottom.model];
+        finishedBlobs[blob->lastBottom.model]= blob;
+    }
+}
+
+void
+CBlobUnionFind::SortFinished()
+{
+    int i;
+
+    for (i=0; i<BU_MODELS; i++)
+        CBlobAssembler::SortList(finishedBlobs[i]);
+}
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <new>
 #include "chirp.hpp"
+#include "chirpcrc.h"
 #include "debuglog.h"
 
 
@@ -50,6 +51,13 @@ Chirp::Chirp(bool hinterested, bool client, Link *link)
     m_hinformer = false;
     m_hinterested = hinterested;
     m_client = client;
+    m_caps = 0;
+    m_sendTag = 0;
+    m_recvTag = 0;
+    m_nextTag = 0;
+    memset(m_pending, 0, sizeof(m_pending));
+    m_zeroCopy = false;
+    m_lease = NULL;
 
     m_procTableSize = CRP_PROCTABLE_LEN;
     m_procTable = new (std::nothrow) ProcTableEntry[m_procTableSize];
@@ -69,11 +77,15 @@ Chirp::~Chirp()
     // if we're a client, disconnect (let server know)
     if (m_client)
         remoteInit(false);
+    restoreBuffer();
+    dropLease();
     if (!m_sharedMem)
     {
         restoreBuffer();
         delete[] m_buf;
     }
+    for (int i=0; i<CRP_PIPELINE_DEPTH; i++)
+        delete[] m_pending[i].buf;
     delete[] m_procTable;
   log("pixydebug: Chirp::~Chirp() returned\n");
 }
@@ -94,9 +106,9 @@ int Chirp::setLink(Link *link)
     m_blkSize = m_link->blockSize();
 
     if (m_errorCorrected)
-        m_headerLen = 12; // startcode (uint32_t), type (uint8_t), (pad), proc (uint16_t), len (uint32_t)
+        m_headerLen = 12; // startcode (uint32_t), type (uint8_t), tag (uint8_t), proc (uint16_t), len (uint32_t)
     else
-        m_headerLen = 8;  // type (uint8_t), (pad), proc (uint16_t), len (uint32_t)
+        m_headerLen = 8;  // type (uint8_t), tag (uint8_t), proc (uint16_t), len (uint32_t)
 
     if (m_sharedMem)
     {
@@ -204,6 +216,38 @@ void Chirp::restoreBuffer()
     }
 }
 
+int Chirp::setZeroCopy(bool zeroCopy)
+{
+    if (zeroCopy && (m_link==NULL || !(m_link->getFlags()&LINK_FLAG_ZERO_COPY)))
+        return CRP_RES_ERROR;
+    m_zeroCopy = zeroCopy;
+    return CRP_RES_OK;
+}
+
+uint8_t *Chirp::keepLease()
+{
+    uint8_t *lease = m_lease;
+
+    m_lease = NULL; // caller owns it now
+    return lease;
+}
+
+void Chirp::releaseLease(uint8_t *lease)
+{
+    if (lease && m_link)
+        m_link->releaseBuffer(lease);
+}
+
+// hand the link buffer from the last receive back, unless the caller has kept it
+void Chirp::dropLease()
+{
+    if (m_lease)
+    {
+        m_link->releaseBuffer(m_lease);
+        m_lease = NULL;
+    }
+}
+
 
 int Chirp::serialize(Chirp *chirp, uint8_t *buf, uint32_t bufSize, ...)
 {
@@ -419,7 +463,7 @@ int Chirp::loadArgs(va_list *args, void *recvArgs[])
 int Chirp::call(uint8_t service, ChirpProc proc, va_list args)
 {
     int res, i;
-    uint8_t type;
+    uint8_t type, tag;
     va_list arguments;
 
     va_copy(arguments, args);
@@ -446,6 +490,9 @@ int Chirp::call(uint8_t service, ChirpProc proc, va_list args)
     else
         type = CRP_CALL;
 
+    // tag the call so we can match its response (gotoe echoes the tag)
+    tag = m_sendTag = m_nextTag++;
+
     // send call data
     if ((res=sendChirpRetry(type, proc))!=CRP_RES_OK) // convert call into response
     {
@@ -457,26 +504,12 @@ int Chirp::call(uint8_t service, ChirpProc proc, va_list args)
     // if the service is synchronous, receive response while servicing other calls
     if (!(service&ASYNC))
     {
-        ChirpProc recvProc;
         void *recvArgs[CRP_MAX_ARGS+1];
-        m_link->setTimer(); // set timer, so we can check to see if we're taking too much time
 
-        while(1)
+        if ((res=recvResponse(tag, recvArgs))<0)
         {
-            if ((res=recvChirp(&type, &recvProc, recvArgs, true))==CRP_RES_OK)
-            {
-                if (type&CRP_RESPONSE)
-                    break;
-                else // handle calls as they come in
-                    handleChirp(type, recvProc, (const void **)recvArgs);
-            }
-            else
-            {
-                va_end(arguments);
-                return res;
-            }
-            if (m_link->getTimer()>m_headerTimeout) // we could receive XDATA (for example) and never exit this while loop
-                return CRP_RES_ERROR_RECV_TIMEOUT;
+            va_end(arguments);
+            return res;
         }
 
         // deal with arguments
@@ -518,6 +551,171 @@ int Chirp::call(uint8_t service, ChirpProc proc, ...)
   return result;
 }
 
+int Chirp::issue(ChirpProc proc, ...)
+{
+    int res;
+    va_list args;
+
+    va_start(args, proc);
+    res = issue(proc, args);
+    va_end(args);
+
+    return res;
+}
+
+int Chirp::issue(ChirpProc proc, va_list args)
+{
+    int res, i;
+    va_list arguments;
+    ChirpPending *pending;
+    void *recvArgs[CRP_MAX_ARGS+1];
+
+    if (!m_connected)
+        return CRP_RES_ERROR_NOT_CONNECTED;
+
+    // find a free slot
+    for (i=0; i<CRP_PIPELINE_DEPTH && m_pending[i].outstanding; i++);
+    if (i==CRP_PIPELINE_DEPTH)
+        return CRP_RES_ERROR_MEMORY;
+    pending = &m_pending[i];
+
+    // parse arguments and assemble in m_buf
+    m_len = 0;
+    restoreBuffer();
+    va_copy(arguments, args);
+    res = vassemble(&arguments);
+    va_end(arguments);
+    if (res<0)
+        return res;
+
+    m_sendTag = m_nextTag++;
+    if ((res=sendChirpRetry(CRP_CALL, proc))!=CRP_RES_OK)
+        return res;
+    pending->tag = m_sendTag;
+    pending->outstanding = true;
+    pending->received = false;
+
+    // gotoe can't tag its responses, so wait for this one now and hold on to it until it's collected
+    if (!(m_caps&CRP_CAP_PIPELINE))
+    {
+        if ((res=recvResponse(pending->tag, recvArgs))<0 || (res=stashResponse(pending))<0)
+        {
+            pending->outstanding = false;
+            return res;
+        }
+    }
+
+    return pending->tag;
+}
+
+int Chirp::collect(uint8_t tag, ...)
+{
+    int res;
+    va_list args;
+
+    va_start(args, tag);
+    res = collect(tag, args);
+    va_end(args);
+
+    return res;
+}
+
+// Note, returned arrays point into the slot's buffer, which is valid until the next issue()
+int Chirp::collect(uint8_t tag, va_list args)
+{
+    int res;
+    va_list arguments;
+    ChirpPending *pending;
+    void *recvArgs[CRP_MAX_ARGS+1];
+
+    if ((pending=lookupPending(tag))==NULL)
+        return CRP_RES_ERROR;
+
+    if (pending->received)
+        res = deserializeParse(pending->buf, pending->len, recvArgs);
+    else
+        res = recvResponse(tag, recvArgs);
+    pending->outstanding = false;
+    if (res<0)
+        return res;
+
+    va_copy(arguments, args);
+    res = loadArgs(&arguments, recvArgs);
+    va_end(arguments);
+
+    return res;
+}
+
+bool Chirp::pipelined()
+{
+    return m_caps&CRP_CAP_PIPELINE;
+}
+
+// receive the response to the call tagged with tag while servicing other calls.
+// Responses to other outstanding issued calls are stashed until they're collected.
+int Chirp::recvResponse(uint8_t tag, void *args[])
+{
+    int res;
+    uint8_t type;
+    ChirpProc recvProc;
+    ChirpPending *pending;
+
+    m_link->setTimer(); // set timer, so we can check to see if we're taking too much time
+
+    while(1)
+    {
+        if ((res=recvChirp(&type, &recvProc, args, true))!=CRP_RES_OK)
+            return res;
+        if (type&CRP_RESPONSE)
+        {
+            // without tags, the next response is ours
+            if (!(m_caps&CRP_CAP_PIPELINE) || m_recvTag==tag)
+                return CRP_RES_OK;
+            if ((pending=lookupPending(m_recvTag)) && !pending->received && (res=stashResponse(pending))<0)
+                return res;
+            // otherwise it's a stale response (e.g. to an ASYNC call) -- drop it
+        }
+        else // handle calls as they come in
+            handleChirp(type, recvProc, (const void **)args);
+        if (m_link->getTimer()>m_headerTimeout) // we could receive XDATA (for example) and never exit this while loop
+            return CRP_RES_ERROR_RECV_TIMEOUT;
+    }
+}
+
+// copy the response that was just received (responseInt and args) into the pending slot
+int Chirp::stashResponse(ChirpPending *pending)
+{
+    if (pending->bufSize<m_len)
+    {
+        delete [] pending->buf;
+        pending->buf = new (std::nothrow) uint8_t[m_len];
+        if (pending->buf==NULL)
+        {
+            pending->bufSize = 0;
+            return CRP_RES_ERROR_MEMORY;
+        }
+        pending->bufSize = m_len;
+    }
+    // recvChirp() has already inserted responseInt in front of the args
+    memcpy(pending->buf, m_buf+m_headerLen-4, m_len);
+    pending->len = m_len;
+    pending->received = true;
+
+    return CRP_RES_OK;
+}
+
+ChirpPending *Chirp::lookupPending(uint8_t tag)
+{
+    int i;
+
+    for (i=0; i<CRP_PIPELINE_DEPTH; i++)
+    {
+        if (m_pending[i].outstanding && m_pending[i].tag==tag)
+            return &m_pending[i];
+    }
+    return NULL;
+}
+
 int Chirp::sendChirpRetry(uint8_t type, ChirpProc proc)
 {
     int i, res=-1;
@@ -548,14 +746,18 @@ int Chirp::sendChirpRetry(uint8_t type, ChirpProc proc)
 
 int Chirp::sendChirp(uint8_t type, ChirpProc proc)
 {
-    int res;
+    int res, i;
     if (m_errorCorrected)
         res = sendFull(type, proc);
     else
     {
-        // we'll send forever as long as we get naks
-        // we rely on receiver to give up
-        while((res=sendHeader(type, proc))==CRP_RES_ERROR_CRC);
+        // resend as long as we get naks, but not forever -- if gotoe is sending too (e.g. it
+        // gave up on a response we're still sending), each side reads the other's data as a nak
+        for (i=0; (res=sendHeader(type, proc))==CRP_RES_ERROR_CRC; i++)
+        {
+            if (i>=m_maxNak)
+                return CRP_RES_ERROR_MAX_NAK;
+        }
         if (res!=CRP_RES_OK)
             return res;
         res = sendData();
@@ -570,6 +772,7 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, const void *args[])
     int res;
     int32_t responseInt = 0;
     uint8_t n;
+    uint8_t tag = m_recvTag; // save, so we can tag the response
 
     // default case, we return one integer (responseint)
     m_len = 4;
@@ -581,7 +784,7 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, const void *args[])
         if (type==CRP_CALL_ENUMERATE)
             responseInt = handleEnumerate((char *)args[0], (ChirpProc *)args[1]);
         else if (type==CRP_CALL_INIT)
-            responseInt = handleInit((uint16_t *)args[0], (uint8_t *)args[1]);
+            responseInt = handleInit((uint16_t *)args[0], (uint8_t *)args[1], (uint8_t *)args[2]);
         else if (type==CRP_CALL_ENUMERATE_INFO)
             responseInt = handleEnumerateInfo((ChirpProc *)args[0]);
         else
@@ -641,6 +844,7 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, const void *args[])
         // write responseInt
         *(uint32_t *)(m_buf+m_headerLen) = responseInt;
         // send response
+        m_sendTag = tag;
         res = sendChirpRetry(CRP_RESPONSE | (type&~CRP_CALL), m_procTable[proc].chirpProc);	// convert call into response
         restoreBuffer(); // restore buffer immediately!
         if (res!=CRP_RES_OK) 
@@ -735,20 +939,26 @@ int Chirp::remoteInit(bool connect)
 {
     int res;
     uint32_t responseInt;
-    uint8_t hinformer;
+    uint8_t hinformer, caps = 0;
+
+    // only ask for pipelining if the link keeps receiving while we're sending calls
+    if (connect && (m_link->getFlags()&LINK_FLAG_BUFFERED_RECEIVE))
+        caps |= CRP_CAP_PIPELINE;
 
     res = call(CRP_CALL_INIT, 0,
                UINT16(connect ? m_blkSize : 0), // send block size
                UINT8(m_hinterested), // send whether we're interested in hints or not
+               UINT8(caps), // send capabilities we'd like to use (older firmware ignores this)
                END_OUT_ARGS,
                &responseInt,
-               &hinformer,       // receive whether we should send hints
+               &hinformer,       // receive whether we should send hints, and agreed capabilities
                END_IN_ARGS
                );
     if (res>=0)
     {
         m_connected = connect;
-        m_hinformer = hinformer;
+        m_hinformer = hinformer&CRP_INIT_HINTERESTED;
+        m_caps = hinformer&caps;
         return responseInt;
     }
     return res;
@@ -815,7 +1025,8 @@ int32_t Chirp::handleEnumerate(char *procName, ChirpProc *callback)
     return proc;
 }
 
-int32_t Chirp::handleInit(uint16_t *blkSize, uint8_t *hinformer)
+// caps is NULL if gotoe predates capability negotiation
+int32_t Chirp::handleInit(uint16_t *blkSize, uint8_t *hinformer, uint8_t *caps)
 {
     int32_t responseInt;
 
@@ -824,8 +1035,10 @@ int32_t Chirp::handleInit(uint16_t *blkSize, uint8_t *hinformer)
     m_connected = connect;
     m_blkSize = *blkSize;  // get block size, write it
     m_hinformer = *hinformer;
+    m_caps = connect && caps ? *caps&CRP_CAPS_SUPPORTED : 0;
 
-    CRP_RETURN(this, UINT8(m_hinterested), END);
+    // only report capabilities if they were asked for -- older clients treat any nonzero value as hinterested
+    CRP_RETURN(this, UINT8((m_hinterested ? CRP_INIT_HINTERESTED : 0) | m_caps), END);
 
     return responseInt;
 }
@@ -901,6 +1114,7 @@ int Chirp::recvChirp(uint8_t *type, ChirpProc *proc, void *args[], bool wait) //
     uint32_t i, offset;
 	
     restoreBuffer();
+    dropLease();
 
     // receive
     if (m_errorCorrected)
@@ -1057,15 +1271,8 @@ uint8_t Chirp::getType(const void *arg)
 
 uint16_t Chirp::calcCrc(uint8_t *buf, uint32_t len)
 {
-    uint32_t i;
-    uint16_t crc;
-
     // this isn't a real crc, but it's cheap and prob good enough
-    for (i=0, crc=0; i<len; i++)
-        crc += buf[i];
-    crc += len;
-
-    return crc;
+    return crcSliced(buf, len);
 }
 
 
@@ -1075,6 +1282,7 @@ int Chirp::sendFull(uint8_t type, ChirpProc proc)
 
     *(uint32_t *)m_buf = CRP_START_CODE;
     *(uint8_t *)(m_buf+4) = type;
+    *(uint8_t *)(m_buf+5) = m_sendTag;
     *(ChirpProc *)(m_buf+6) = proc;
     *(uint32_t *)(m_buf+8) = m_len;
     // send header
@@ -1100,21 +1308,23 @@ int Chirp::sendHeader(uint8_t type, ChirpProc proc)
         return res;
 
     *(uint8_t *)m_buf = type;
+    *(uint8_t *)(m_buf+1) = m_sendTag;
     *(uint16_t *)(m_buf+2) = proc;
     *(uint32_t *)(m_buf+4) = m_len;
     if ((res=m_link->send(m_buf, m_headerLen, m_sendTimeout))<0)
         return res;
     crc = calcCrc(m_buf, m_headerLen);
 
-    if (m_len>=CRP_MAX_HEADER_LEN)
-        chunk = CRP_MAX_HEADER_LEN;
+    // first chunk of data goes with the header (data starts after the header in m_buf)
+    if (m_len>=CRP_MAX_HEADER_LEN-m_headerLen)
+        chunk = CRP_MAX_HEADER_LEN-m_headerLen;
     else
         chunk = m_len;
-    if (m_link->send(m_buf, chunk, m_sendTimeout)<0)
+    if (m_link->send(m_buf+m_headerLen, chunk, m_sendTimeout)<0)
         return CRP_RES_ERROR_SEND_TIMEOUT;
 
     // send crc
-    crc += calcCrc(m_buf, chunk);
+    crc += calcCrc(m_buf+m_headerLen, chunk);
     if (m_link->send((uint8_t *)&crc, 2, m_sendTimeout)<0)
         return CRP_RES_ERROR_SEND_TIMEOUT;
 
@@ -1133,24 +1343,24 @@ int Chirp::sendData()
 {
     uint16_t crc;
     uint32_t chunk;
-    uint8_t sequence;
+    uint8_t sequence, naks;
     bool ack;
     int res;
 
-    for (sequence=0; m_offset<m_len; )
+    for (sequence=0, naks=0; m_offset<m_len; )
     {
         if (m_len-m_offset>=m_blkSize)
             chunk = m_blkSize;
         else
             chunk = m_len-m_offset;
         // send data
-        if (m_link->send(m_buf+m_offset, chunk, m_sendTimeout)<0)
+        if (m_link->send(m_buf+m_headerLen+m_offset, chunk, m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
         // send sequence
         if (m_link->send((uint8_t *)&sequence, 1, m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
         // send crc
-        crc = calcCrc(m_buf+m_offset, chunk) + calcCrc((uint8_t *)&sequence, 1);
+        crc = calcCrc(m_buf+m_headerLen+m_offset, chunk) + calcCrc((uint8_t *)&sequence, 1);
         if (m_link->send((uint8_t *)&crc, 2, m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
 
@@ -1160,7 +1370,10 @@ int Chirp::sendData()
         {
             m_offset += chunk;
             sequence++;
+            naks = 0;
         }
+        else if (++naks>m_maxNak)
+            return CRP_RES_ERROR_MAX_NAK;
     }
     return CRP_RES_OK;
 }
@@ -1217,7 +1430,8 @@ int Chirp::recvHeader(uint8_t *type, ChirpProc *proc, bool wait)
         }
     }
     // receive rest of header
-    if (m_link->receive(m_buf, m_headerLen, m_idleTimeout) < 0) {
+    return_value = m_link->receive(m_buf, m_headerLen, m_idleTimeout);
+    if (return_value < 0) {
       return_value = CRP_RES_ERROR_RECV_TIMEOUT;
       goto chirp_recvheader__exit;
     }
@@ -1228,6 +1442,7 @@ int Chirp::recvHeader(uint8_t *type, ChirpProc *proc, bool wait)
     }
 
     *type = *(uint8_t *)m_buf;
+    m_recvTag = *(uint8_t *)(m_buf+1);
     *proc = *(ChirpProc *)(m_buf+2);
     m_len = *(uint32_t *)(m_buf+4);
     crc = calcCrc(m_buf, m_headerLen);
@@ -1237,7 +1452,11 @@ int Chirp::recvHeader(uint8_t *type, ChirpProc *proc, bool wait)
     else
         chunk = m_len;
 
-    return_value = m_link->receive(m_buf, chunk+2, m_idleTimeout);
+    if (m_headerLen+chunk+2>m_bufSize && (return_value=realloc(m_headerLen+chunk+2))<0)
+      goto chirp_recvheader__exit;
+
+    // data goes after the header, same as when we receive everything at once (recvFull)
+    return_value = m_link->receive(m_buf+m_headerLen, chunk+2, m_idleTimeout);
 
     if (return_value < 0) { // +2 for crc
       goto chirp_recvheader__exit;
@@ -1246,8 +1465,8 @@ int Chirp::recvHeader(uint8_t *type, ChirpProc *proc, bool wait)
       return_value = CRP_RES_ERROR;
       goto chirp_recvheader__exit;
     }
-    copyAlign((char *)&rcrc, (char *)(m_buf+chunk), 2);
-    if (rcrc==crc+calcCrc(m_buf, chunk))
+    copyAlign((char *)&rcrc, (char *)(m_buf+m_headerLen+chunk), 2);
+    if (rcrc==crc+calcCrc(m_buf+m_headerLen, chunk))
     {
         m_offset = chunk;
         sendAck(true);
@@ -1270,7 +1489,8 @@ int Chirp::recvFull(uint8_t *type, ChirpProc *proc, bool wait)
 {
     int res;
     uint32_t startCode;
-    uint32_t len, recvd;
+    uint32_t len, recvd, leaseLen;
+    uint8_t *lease;
 
 	if (m_link==NULL)
 		return CRP_RES_ERROR_NOT_CONNECTED;
@@ -1289,15 +1509,31 @@ int Chirp::recvFull(uint8_t *type, ChirpProc *proc, bool wait)
             break;
     }
     *type = *(uint8_t *)(m_buf+4);
+    m_recvTag = *(uint8_t *)(m_buf+5);
     *proc = *(ChirpProc *)(m_buf+6);
     m_len = *(uint32_t *)(m_buf+8);
 
-    if (m_len+m_headerLen>m_bufSize && (res=realloc(m_len+m_headerLen))<0)
-        return res;
-
     if (m_len+m_headerLen>recvd && !m_sharedMem)
     {
         len = m_len+m_headerLen;
+        // zero-copy -- if the rest of a (non-call) message arrived in one block, parse it in place by
+        // copying what we've already received into the headroom in front of the block
+        if (m_zeroCopy && !(*type&CRP_CALL) && recvd<=LINK_BUFFER_HEADROOM)
+        {
+            leaseLen = len-recvd;
+            if (m_link->getBuffer(&lease, &leaseLen, m_idleTimeout)==LINK_RESULT_OK)
+            {
+                memcpy(lease-recvd, m_buf, recvd);
+                m_lease = lease;
+                m_bufSave = m_buf; // restoreBuffer() switches back
+                m_buf = lease-recvd;
+                return CRP_RES_OK;
+            }
+        }
+
+        if (len>m_bufSize && (res=realloc(len))<0)
+            return res;
+
         while(recvd<len)
         {
             if ((res=m_link->receive(m_buf+recvd, len-recvd, m_idleTimeout))<0)
@@ -1347,13 +1583,13 @@ int Chirp::recvData()
             chunk = m_blkSize;
         else
             chunk = m_len-m_offset;
-        if (m_link->receive(m_buf+m_offset, chunk+3, m_dataTimeout)<0) // +3 to read sequence, crc
+        if ((res=m_link->receive(m_buf+m_headerLen+m_offset, chunk+3, m_dataTimeout))<0) // +3 to read sequence, crc
             return CRP_RES_ERROR_RECV_TIMEOUT;
         if (res<(int)chunk+3)
             return CRP_RES_ERROR;
-        sequence = *(uint8_t *)(m_buf+m_offset+chunk);
-        copyAlign((char *)&crc, (char *)(m_buf+m_offset+chunk+1), 2);
-        if (crc==calcCrc(m_buf+m_offset, chunk+1))
+        sequence = *(uint8_t *)(m_buf+m_headerLen+m_offset+chunk);
+        copyAlign((char *)&crc, (char *)(m_buf+m_headerLen+m_offset+chunk+1), 2);
+        if (crc==calcCrc(m_buf+m_headerLen+m_offset, chunk+1))
         {
             if (rsequence==sequence)
             {
@@ -77,6 +77,7 @@ bool IterPixel::next(UVPixel *uv, RGBPixel *rgb)
 bool IterPixel::nextHelper(UVPixel *uv, RGBPixel *rgb)
 {
     int32_t r, g1, g2, b, u, v, c, miny=CL_MIN_Y;
+    const uint8_t *pixels;
 
     while(1)
     {
@@ -89,10 +90,12 @@ bool IterPixel::nextHelper(UVPixel *uv, RGBPixel *rgb)
         if (m_y>=m_region.m_height)
             return false;
 
-        r = m_pixels[m_x];
-        g1 = m_pixels[m_x - 1];
-        g2 = m_pixels[-m_frame.m_width + m_x];
-        b = m_pixels[-m_frame.m_width + m_x - 1];
+        // index from a pointer to the pixel -- m_x is unsigned, so m_x-1 is only -1 on 32-bit targets
+        pixels = m_pixels + m_x;
+        r = pixels[0];
+        g1 = pixels[-1];
+        g2 = pixels[-m_frame.m_width];
+        b = pixels[-m_frame.m_width - 1];
 		if (rgb)
 		{
 		  	rgb->m_r = r;
@@ -146,6 +149,50 @@ uint32_t IterPixel::averageRgb(uint32_t *pixels)
 	return (r<<16) | (g<<8) | b;
 }
 
+// (u<<CL_LUT_ENTRY_SCALE)/y rounds toward zero, so for y>0:
+//   u/y>min  <=>  u>=(min+1)*y if min>=0,  u>=min*y+1 otherwise
+//   u/y<max  <=>  u<=max*y-1 if max>0,     u<=(max-1)*y otherwise
+// |u/y| is at most 1<<30 (u is 16 bits), so clamping min and max there changes nothing and
+// keeps min+1 and max-1 from overflowing.
+static void setBound(int32_t min, int32_t max, int32_t *lo, int8_t *loBias, int32_t *hi, int8_t *hiBias)
+{
+	if (min<-(1<<30)-1)
+		min = -(1<<30)-1;
+	else if (min>(1<<30))
+		min = 1<<30;
+	if (max<-(1<<30))
+		max = -(1<<30);
+	else if (max>(1<<30)+1)
+		max = (1<<30)+1;
+
+	if (min>=0)
+	{
+		*lo = min+1;
+		*loBias = 0;
+	}
+	else
+	{
+		*lo = min;
+		*loBias = 1;
+	}
+	if (max>0)
+	{
+		*hi = max;
+		*hiBias = -1;
+	}
+	else
+	{
+		*hi = max-1;
+		*hiBias = 0;
+	}
+}
+
+static void setBounds(RuntimeSignature *sig)
+{
+	setBound(sig->m_uMin, sig->m_uMax, &sig->m_uLo, &sig->m_uLoBias, &sig->m_uHi, &sig->m_uHiBias);
+	setBound(sig->m_vMin, sig->m_vMax, &sig->m_vLo, &sig->m_vLoBias, &sig->m_vHi, &sig->m_vHiBias);
+}
+
 ColorLUT::ColorLUT(uint8_t *lut)
 {
 	int i; 
@@ -160,7 +207,10 @@ ColorLUT::ColorLUT(uint8_t *lut)
     m_ratio = CL_DEFAULT_TOL;
     m_ccGain = CL_DEFAULT_CCGAIN;
 	for (i=0; i<CL_NUM_SIGNATURES; i++)
+	{
 		m_sigRanges[i] = CL_DEFAULT_SIG_RANGE;
+		setBounds(m_runtimeSigs+i);
+	}
 }
 
 
@@ -344,6 +394,7 @@ void ColorLUT::updateSignature(uint8_t signum)
 	m_runtimeSigs[signum].m_uMax = m_signatures[signum].m_uMean + (m_signatures[signum].m_uMax - m_signatures[signum].m_uMean)*range;
 	m_runtimeSigs[signum].m_vMin = m_signatures[signum].m_vMean + (m_signatures[signum].m_vMin - m_signatures[signum].m_vMean)*range;
 	m_runtimeSigs[signum].m_vMax = m_signatures[signum].m_vMean + (m_signatures[signum].m_vMax - m_signatures[signum].m_vMean)*range;
+	setBounds(m_runtimeSigs+signum);
 
     m_runtimeSigs[signum].m_rgbSat = saturate(m_signatures[signum].m_rgb);
 }
@@ -367,52 +418,140 @@ int ColorLUT::setSignature(uint8_t signum, const ColorSignature &sig)
 }
 
 
-int ColorLUT::generateLUT()
+// The LUT is indexed by (r-g)>>3 and (b-g)>>3, 6 bits each.  With the (r, g, b) grid
+// generateLUT() samples (every 4th value of each), the samples that land in a bin are the ones
+// with r-g in {8*du, 8*du+4} and b-g in {8*dv, 8*dv+4}, du and dv being the signed bin indexes.
+// Returns the lowest signature from first to last that takes any of them, 0 if none does.
+uint8_t ColorLUT::matchBin(uint32_t bin, uint8_t first, uint8_t last)
 {
-    int32_t r, g, b, u, v, y, bin, sig;
-
-    clearLUT();
-
-    // recalc bounds for each signature
-    for (r=0; r<CL_NUM_SIGNATURES; r++)
-        updateSignature(r+1);
+    int32_t du, dv, r, g, b, i, j, y, gmin, gmax, ymin, ymax, sig, match;
+    int32_t step = 1<<(8-CL_LUT_COMPONENT_SCALE); // sample spacing
+    int32_t uq[4], vq[4], uqmin, uqmax, vqmin, vqmax;
+    uint8_t sigs;
+
+    du = bin>>CL_LUT_COMPONENT_SCALE;
+    dv = bin&((1<<CL_LUT_COMPONENT_SCALE)-1);
+    if (du>=1<<(CL_LUT_COMPONENT_SCALE-1))
+        du -= 1<<CL_LUT_COMPONENT_SCALE;
+    if (dv>=1<<(CL_LUT_COMPONENT_SCALE-1))
+        dv -= 1<<CL_LUT_COMPONENT_SCALE;
+    du <<= 9-CL_LUT_COMPONENT_SCALE;
+    dv <<= 9-CL_LUT_COMPONENT_SCALE;
+
+    // Brightness of the samples is 3g+(r-g)+(b-g), within these bounds.  And u/y and v/y are
+    // monotonic in u (v) and y, so the samples' u and v are bounded by those of the corners.
+    // Signatures that can't take any of the corners are skipped.
+    gmin = 0;
+    if (gmin<-du-step)
+        gmin = -du-step;
+    if (gmin<-dv-step)
+        gmin = -dv-step;
+    gmax = (1<<8)-step;
+    if (gmax>(1<<8)-step-du)
+        gmax = (1<<8)-step-du;
+    if (gmax>(1<<8)-step-dv)
+        gmax = (1<<8)-step-dv;
+    ymin = 3*gmin + du + dv;
+    ymax = 3*gmax + du + dv + 2*step;
+    if (ymin<(int32_t)m_miny)
+        ymin = m_miny;
+    if (ymax<ymin)
+        return 0;
+    uq[0] = (du<<CL_LUT_ENTRY_SCALE)/ymin;
+    uq[1] = (du<<CL_LUT_ENTRY_SCALE)/ymax;
+    uq[2] = ((du+step)<<CL_LUT_ENTRY_SCALE)/ymin;
+    uq[3] = ((du+step)<<CL_LUT_ENTRY_SCALE)/ymax;
+    vq[0] = (dv<<CL_LUT_ENTRY_SCALE)/ymin;
+    vq[1] = (dv<<CL_LUT_ENTRY_SCALE)/ymax;
+    vq[2] = ((dv+step)<<CL_LUT_ENTRY_SCALE)/ymin;
+    vq[3] = ((dv+step)<<CL_LUT_ENTRY_SCALE)/ymax;
+    for (i=1, uqmin=uqmax=uq[0], vqmin=vqmax=vq[0]; i<4; i++)
+    {
+        if (uq[i]<uqmin)
+            uqmin = uq[i];
+        else if (uq[i]>uqmax)
+            uqmax = uq[i];
+        if (vq[i]<vqmin)
+            vqmin = vq[i];
+        else if (vq[i]>vqmax)
+            vqmax = vq[i];
+    }
+    for (sig=first-1, sigs=0; sig<last; sig++)
+    {
+        if (m_signatures[sig].m_uMin==0 && m_signatures[sig].m_uMax==0)
+            continue;
+        if (uqmax<=m_runtimeSigs[sig].m_uMin || uqmin>=m_runtimeSigs[sig].m_uMax ||
+                vqmax<=m_runtimeSigs[sig].m_vMin || vqmin>=m_runtimeSigs[sig].m_vMax)
+            continue;
+        sigs |= 1<<sig;
+    }
 
-    for (r=0; r<1<<8; r+=1<<(8-CL_LUT_COMPONENT_SCALE))
+    // only signatures lower than the best match so far are worth testing
+    for (g=0, match=last+1; g<1<<8 && sigs; g+=step)
     {
-        for (g=0; g<1<<8; g+=1<<(8-CL_LUT_COMPONENT_SCALE))
+        for (i=0; i<2; i++)
         {
-            for (b=0; b<1<<8; b+=1<<(8-CL_LUT_COMPONENT_SCALE))
+            r = g+du+i*step;
+            if (r<0 || r>=1<<8)
+                continue;
+            for (j=0; j<2; j++)
             {
+                b = g+dv+j*step;
+                if (b<0 || b>=1<<8)
+                    continue;
                 y = r+g+b;
-
                 if (y<(int32_t)m_miny)
                     continue;
-                u = ((r-g)<<CL_LUT_ENTRY_SCALE)/y;
-                v = ((b-g)<<CL_LUT_ENTRY_SCALE)/y;
-
-                for (sig=0; sig<CL_NUM_SIGNATURES; sig++)
+                for (sig=first-1; sig<match-1; sig++)
                 {
-                    if (m_signatures[sig].m_uMin==0 && m_signatures[sig].m_uMax==0)
-                        continue;
-                    if ((m_runtimeSigs[sig].m_uMin<u) && (u<m_runtimeSigs[sig].m_uMax) &&
-                            (m_runtimeSigs[sig].m_vMin<v) && (v<m_runtimeSigs[sig].m_vMax))
+                    if ((sigs&(1<<sig)) && inBounds(m_runtimeSigs[sig], r-g, b-g, y))
                     {
-                        u = r-g;
-                        u >>= 9-CL_LUT_COMPONENT_SCALE;
-                        u &= (1<<CL_LUT_COMPONENT_SCALE)-1;
-                        v = b-g;
-                        v >>= 9-CL_LUT_COMPONENT_SCALE;
-                        v &= (1<<CL_LUT_COMPONENT_SCALE)-1;
-
-                        bin = (u<<CL_LUT_COMPONENT_SCALE)+ v;
-
-                        if (m_lut[bin]==0 || m_lut[bin]>sig+1)
-                            m_lut[bin] = sig+1;
+                        match = sig+1;
+                        // done if nothing lower can match
+                        sigs &= (1<<sig)-1;
+                        break;
                     }
                 }
             }
         }
     }
+    return match>last ? 0 : match;
+}
+
+// With signum 0, regenerates the whole LUT.  Otherwise only signum has changed (its signature
+// or range), so only the bins it takes now, or took before, are looked at again.  Changing the
+// minimum brightness or more than one signature needs a full regeneration.
+int ColorLUT::generateLUT(uint8_t signum)
+{
+    uint32_t bin;
+    uint8_t sig;
+
+    if (signum>CL_NUM_SIGNATURES)
+        return -1;
+
+    if (signum==0)
+    {
+        // recalc bounds for each signature
+        for (sig=1; sig<=CL_NUM_SIGNATURES; sig++)
+            updateSignature(sig);
+
+        for (bin=0; bin<CL_LUT_SIZE; bin++)
+            m_lut[bin] = matchBin(bin, 1, CL_NUM_SIGNATURES);
+
+        return 0;
+    }
+
+    updateSignature(signum);
+
+    // The lowest signature wins a bin, so bins won by a lower signature stay as they are.  Bins
+    // signum won may now go to a higher one, and bins nothing lower won may now go to signum.
+    for (bin=0; bin<CL_LUT_SIZE; bin++)
+    {
+        if (m_lut[bin]==signum)
+            m_lut[bin] = matchBin(bin, signum, CL_NUM_SIGNATURES);
+        else if ((m_lut[bin]==0 || m_lut[bin]>signum) && matchBin(bin, signum, signum))
+            m_lut[bin] = signum;
+    }
 
     return 0;
 }
@@ -0,0 +1,133 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include "rlsline.h"
+
+// RLS_DSP selects the M4's SIMD instructions.  Define it on the host to check that code with the
+// plain C intrinsics in host/benchmarks/hostinc.
+#if defined(CORE_M4) && !defined(RLS_DSP)
+#define RLS_DSP
+#endif
+
+#ifdef RLS_DSP
+#ifdef CORE_M4
+#include "lpc43xx.h"
+#else
+#include "core_cm4_simd.h"
+#endif
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// LUT index of a column: (r-g)>>3 and (b-g)>>3, 6 bits each
+#define RLS_INDEX_BITS        6
+#define RLS_INDEX_MASK        ((1<<RLS_INDEX_BITS)-1)
+
+// Look up the signature of each column.  Only the LUT index is worked out here, which is the
+// part that's the same for every column.  The Qval sums are only needed for the few columns
+// that make a Qval, so those are done later.
+static void lineSigs(const uint8_t *bgLine, const uint8_t *grLine, const uint8_t *lut, uint8_t *sigs, uint32_t cols)
+{
+    uint32_t col=0;
+    int32_t u, v;
+
+#ifdef RLS_DSP
+    uint32_t bg, gr, ub, ug, idx;
+
+    // 2 columns at a time, one in each halfword
+    for (; col+2<=cols; col+=2)
+    {
+        bg = *(const uint32_t *)(bgLine+col*2);
+        gr = *(const uint32_t *)(grLine+col*2);
+        ub = __SSUB16(__UXTB16(bg), __UXTB16(__ROR(bg, 8))); // b-g
+        ug = __SSUB16(__UXTB16(__ROR(gr, 8)), __UXTB16(gr)); // r-g
+        // bits 3-8 of each halfword don't depend on the other one
+        idx = (((ug>>3)&(RLS_INDEX_MASK*0x00010001UL))<<RLS_INDEX_BITS) | ((ub>>3)&(RLS_INDEX_MASK*0x00010001UL));
+        sigs[col] = lut[idx&0xffff];
+        sigs[col+1] = lut[idx>>16];
+    }
+#elif defined(__SSE2__)
+    __m128i bg, gr, lo=_mm_set1_epi16(0xff), mask=_mm_set1_epi16(RLS_INDEX_MASK), idx;
+
+    // 8 columns at a time, one in each 16-bit lane
+    for (; col+8<=cols; col+=8)
+    {
+        bg = _mm_loadu_si128((const __m128i *)(bgLine+col*2));
+        gr = _mm_loadu_si128((const __m128i *)(grLine+col*2));
+        bg = _mm_sub_epi16(_mm_and_si128(bg, lo), _mm_srli_epi16(bg, 8)); // b-g
+        gr = _mm_sub_epi16(_mm_srli_epi16(gr, 8), _mm_and_si128(gr, lo)); // r-g
+        idx = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(gr, 3), mask), RLS_INDEX_BITS),
+            _mm_and_si128(_mm_srli_epi16(bg, 3), mask));
+        sigs[col] = lut[_mm_extract_epi16(idx, 0)];
+        sigs[col+1] = lut[_mm_extract_epi16(idx, 1)];
+        sigs[col+2] = lut[_mm_extract_epi16(idx, 2)];
+        sigs[col+3] = lut[_mm_extract_epi16(idx, 3)];
+        sigs[col+4] = lut[_mm_extract_epi16(idx, 4)];
+        sigs[col+5] = lut[_mm_extract_epi16(idx, 5)];
+        sigs[col+6] = lut[_mm_extract_epi16(idx, 6)];
+        sigs[col+7] = lut[_mm_extract_epi16(idx, 7)];
+    }
+#endif
+
+    // the rest, or all of it without SIMD
+    for (; col<cols; col++)
+    {
+        v = bgLine[col*2] - bgLine[col*2+1];
+        u = grLine[col*2+1] - grLine[col*2];
+        sigs[col] = lut[(((u>>3)&RLS_INDEX_MASK)<<RLS_INDEX_BITS) | ((v>>3)&RLS_INDEX_MASK)];
+    }
+}
+
+uint32_t rlsLine(const uint8_t *bgLine, const uint8_t *grLine, const uint8_t *lut, Qval *qvals, uint32_t cols)
+{
+    uint32_t sigWords[RLS_LINE_MAX_COLS/4];
+    uint8_t *sigs = (uint8_t *)sigWords;
+    uint32_t col, sig, n=0;
+    const uint8_t *bg, *gr;
+
+    if (cols>RLS_LINE_MAX_COLS)
+        cols = RLS_LINE_MAX_COLS;
+    lineSigs(bgLine, grLine, lut, sigs, cols);
+
+    // A Qval is a pair of columns with the same signature, the sums of the pair, with the two
+    // columns after it skipped.  A column that doesn't match the one before it isn't the
+    // start of a pair either.
+    for (col=0; col<cols; col++)
+    {
+        // most of a line usually matches nothing
+        while ((col&3)==0 && col+4<=cols && sigWords[col>>2]==0)
+            col += 4;
+        if (col>=cols)
+            break;
+        sig = sigs[col];
+        if (sig==0)
+            continue;
+        if (++col>=cols)
+            break;
+        if (sigs[col]!=sig)
+            continue;
+
+        bg = bgLine + col*2;
+        gr = grLine + col*2;
+        qvals[n].m_u = gr[-1] - gr[-2] + gr[1] - gr[0];
+        qvals[n].m_v = bg[-2] - bg[-1] + bg[0] - bg[1];
+        qvals[n].m_y = bg[-2] + bg[-1] + bg[0] + bg[1] + gr[-1] + gr[1];
+        qvals[n].m_col = (col<<3) | sig;
+        n++;
+        col += 2;
+    }
+
+    return n;
+}
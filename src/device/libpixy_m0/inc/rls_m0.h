@@ -20,7 +20,13 @@
 
 #define MAX_NEW_QVALS_PER_LINE   ((CAM_RES2_WIDTH/3)+2)
 
+// getRLSFrame() does rows top through bottom-1, every decimation'th row.  Each row's
+// line-begin Qval has the row in m_u and the decimation in m_v, so the M4 knows which rows
+// it got.
+#define RLS_MAX_DECIMATION       8
+
 int rls_init(void);
 int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut);
+int32_t setRLSWindow(uint16_t *top, uint16_t *bottom, uint8_t *decimation);
 
 #endif
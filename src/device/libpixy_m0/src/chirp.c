@@ -15,6 +15,7 @@
 
 #include <string.h>
 #include "chirp.h"
+#include "chirpcrc.h"
 
 // todo yield, sleep() while waiting for sync response
 // todo
@@ -741,15 +742,8 @@ uint8_t chirpGetType(void *arg)
 
 uint16_t calcCrc(uint8_t *buf, uint32_t len)
 {
-    uint32_t i;
-    uint16_t crc;
-
     // this isn't a real crc, but it's cheap and prob good enough
-    for (i=0, crc=0; i<len; i++)
-        crc += buf[i];
-    crc += len;
-
-    return crc;
+    return crcCompact(buf, len);
 }
 
 #ifdef CRP_ERROR_CORRECTED
@@ -383,10 +383,16 @@ uint32_t rgData[] =
 
 int g_foo = 0;
 
+static uint16_t g_rlsTop = 0;
+static uint16_t g_rlsBottom = CAM_RES2_HEIGHT;
+static uint8_t g_rlsDecimation = 1;
+
 int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 {
 	uint8_t *lut2 = (uint8_t *)*lut;
-	uint32_t line;
+	uint32_t line, skip;
+	uint16_t top = g_rlsTop, bottom = g_rlsBottom; // latched for the frame
+	uint8_t decimation = g_rlsDecimation;
 	Qval *qvalStore;
 	uint32_t numQvals;
 	uint8_t *lineStore;
@@ -399,9 +405,16 @@ int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 //		return 0;
    	qvalStore =	(Qval *)*m0Mem;
 	lineStore = (uint8_t *)*m0Mem + MAX_NEW_QVALS_PER_LINE*sizeof(Qval);
-	skipLines(1);
-	for (line=0; line<CAM_RES2_HEIGHT; line++) 
+	lineBegin.m_v = decimation;
+	// each row is 2 lines from the camera
+	skipLines(1 + top*2);
+	for (line=top; line<bottom; line+=decimation) 
 	{
+		if (line>top)
+		{
+			for (skip=0; skip<(decimation-1)*2; skip++)
+				skipLine();
+		}
 		// not enough space--- return error
 		if (qq_free()<MAX_NEW_QVALS_PER_LINE)
 		{
@@ -410,6 +423,7 @@ int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 			//printf("*\n");
 			return -1;
 		} 
+		lineBegin.m_u = line;
 		qq_enqueue(&lineBegin); 
 		lineProcessedRL0A((uint32_t *)&CAM_PORT, lineStore, CAM_RES2_WIDTH/2); 
 		numQvals = lineProcessedRL1A((uint32_t *)&CAM_PORT, qvalStore, lut2, lineStore, CAM_RES2_WIDTH/2, g_qqueue->data, g_qqueue->writeIndex, QQ_MEM_SIZE);
@@ -423,9 +437,21 @@ int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 	return 0;
 }
 
+int32_t setRLSWindow(uint16_t *top, uint16_t *bottom, uint8_t *decimation)
+{
+	if (*top>=*bottom || *bottom>CAM_RES2_HEIGHT || *decimation<1 || *decimation>RLS_MAX_DECIMATION)
+		return -1;
+	g_rlsTop = *top;
+	g_rlsBottom = *bottom;
+	g_rlsDecimation = *decimation;
+
+	return 0;
+}
+
 int rls_init(void)
 {
 	chirpSetProc("getRLSFrame", (ProcPtr)getRLSFrame);
+	chirpSetProc("setRLSWindow", (ProcPtr)setRLSWindow);
 	return 0;
 }
 
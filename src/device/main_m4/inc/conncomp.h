@@ -31,11 +31,13 @@ int32_t cc_clearSig(const uint8_t &signum, Chirp *chirp=NULL);
 int32_t cc_clearAllSig(Chirp *chirp=NULL);
 int32_t cc_setLabel(const uint32_t &signum, const char *label, Chirp *chirp=NULL);
 int32_t cc_setMemory(const uint32_t &location, const uint32_t &len, const uint8_t *data);
+int32_t cc_setWindows(uint8_t decimation, uint8_t numWindows, const RectA *windows);
+int32_t cc_setWindowsChirp(const uint8_t &decimation, const uint32_t &len, const uint16_t *windows);
 int32_t cc_getRLSFrameChirp(Chirp *chirp);
 int32_t cc_getRLSFrameChirpFlags(Chirp *chirp, uint8_t renderFlags=RENDER_FLAG_FLUSH);
 int32_t cc_getRLSFrame(uint8_t *memory, uint8_t *lut, bool sync=true);
 int cc_sendBlobs(Chirp *chirp, SimpleList<Tracker<BlobA> > *blobs, uint8_t renderFlags=RENDER_FLAG_FLUSH);
-int cc_loadLut(void);
+int cc_loadLut(uint8_t signum=0);
 void cc_sendPoints(Points &points, uint16_t width, uint16_t height, Chirp *chirp, uint8_t renderFlags=RENDER_FLAG_BLEND | RENDER_FLAG_FLUSH);
 void cc_setLEDOverride(bool override);
 
@@ -19,6 +19,7 @@
 #include "equeue.h"
 #include "simplelist.h"
 #include "tracker.h"
+#include "trackassoc.h"
 
 #define LINE_EDGE_DIST_DEFAULT            4
 #define LINE_EDGE_THRESH_DEFAULT          35
@@ -35,10 +36,33 @@
 
 #define LINE_HTHRESH_RATIO	              3/5
 
-#define LINE_GRID_WIDTH_REDUCTION         3
-#define LINE_GRID_HEIGHT_REDUCTION        1
-#define LINE_GRID_WIDTH                   (CAM_RES3_WIDTH>>LINE_GRID_WIDTH_REDUCTION)
-#define LINE_GRID_HEIGHT                  (CAM_RES3_HEIGHT>>LINE_GRID_HEIGHT_REDUCTION)
+// Line resolution profiles ("Line resolution" parameter).  The grid is the frame reduced by a
+// power of 2 each way.  vScan() only looks at every 4th column, so 2 is the finest width
+// reduction, and the largest grid still fits Point's 8-bit coordinates.  Finer grids use a
+// shorter edge distance, at most m_maxDist, so a thin line's edges don't spread over cells.
+// Parameters that are distances in the grid (merge distance, minimum line length, line compare)
+// are given in standard cells and shifted left by m_distShift for the profile's finer cells.
+#define LINE_RES_STANDARD                 0  // 79x52
+#define LINE_RES_FINE                     1  // 159x52
+#define LINE_RES_FINEST                   2  // 159x104
+#define LINE_RES_PROFILES                 3
+
+struct LineResProfile
+{
+	uint8_t m_widthReduction;
+	uint8_t m_heightReduction;
+	uint16_t m_maxDist;
+	uint8_t m_distShift;
+};
+
+#define LINE_GRID_MAX_WIDTH               (CAM_RES3_WIDTH>>2)
+#define LINE_GRID_MAX_HEIGHT              CAM_RES3_HEIGHT
+
+// set from the profile by line_open()
+#define LINE_GRID_WIDTH_REDUCTION         g_lineGridWidthReduction
+#define LINE_GRID_HEIGHT_REDUCTION        g_lineGridHeightReduction
+#define LINE_GRID_WIDTH                   g_lineGridWidth
+#define LINE_GRID_HEIGHT                  g_lineGridHeight
 
 #define LINE_GRID_INDEX(x, y)             (LINE_GRID_WIDTH*(y)+(x))
 #define LINE_GRID_INDEX_P(p)              LINE_GRID_INDEX(p.m_x, p.m_y)
@@ -46,6 +70,8 @@
 #define LINE_GRID_P(p)                    LINE_GRID(p.m_x, p.m_y)
 #define LINE_GRID_LINE(x, y)              (LINE_GRID(x, y)&LINE_NODE_LINE_MASK)
 #define LINE_GRID_LINE_P(p)               (LINE_GRID_P(p)&LINE_NODE_LINE_MASK)
+// words in each row of the bitplane of nodes that extractLineSegments() hasn't visited
+#define LINE_GRID_ROW_WORDS               ((LINE_GRID_WIDTH+31)>>5)
 
 
 #define LINE_NODE_LINE_MASK               0x03ff
@@ -58,12 +84,36 @@
 #define LINE_MAX_SEGMENT_POINTS           32
 #define LINE_MAX_INTERSECTION_LINES       8 // needs to be an even number
 #define LINE_MAX_FRAME_INTERSECTION_LINES 6 // needs to be an even numbe
+// sizes of the pools that a frame's lists and barcodes come from, see line_getPoolUsage()
+#define LINE_MAX_NODES                    (LINE_MAX_LINES*2) // both ends of each line
+#define LINE_MAX_NADIRS                   0x40
+#define LINE_MAX_INTERSECTIONS            LINE_MAX_NADIRS // one for each nadir
 
 #define LINE_DEBUG_BENCHMARK              1  // not bit
 #define LINE_DEBUG_LAYERS                 2  // bit
 #define LINE_DEBUG_GRAPH_CHECK            4  // bit
 #define LINE_DEBUG_TRACKING               8 // bit
 
+// Host builds can time the stages of line_processMain() by defining LINE_PROFILE and providing
+// lineProfileMark(), which is called as each stage starts.  On Pixy the marks compile away.
+#define LINE_STAGE_GRID                   0  // clearing the rows of g_lineGrid the last frame wrote
+#define LINE_STAGE_EQUEUE                 1  // waiting for and reading the M0's edges
+#define LINE_STAGE_HLINE                  2  // detectCodes(), line_hLine()
+#define LINE_STAGE_VLINE                  3  // line_vLine()
+#define LINE_STAGE_CODES                  4  // clusterCodes(), clearGrid(), handleBarCodeTracking()
+#define LINE_STAGE_SEGMENTS               5  // extractLineSegments()
+#define LINE_STAGE_NADIRS                 6  // findNadirs(), reduceNadirs()
+#define LINE_STAGE_INTERSECTIONS          7  // formIntersections(), cleanIntersections(), removeMinLines()
+#define LINE_STAGE_TRACKING               8  // handleLineTracking(), handleLineState()
+#define LINE_STAGES                       9  // (end of line_processMain())
+
+#ifdef LINE_PROFILE
+void lineProfileMark(uint8_t stage);
+#define LINE_PROFILE_MARK(stage)          lineProfileMark(stage)
+#else
+#define LINE_PROFILE_MARK(stage)
+#endif
+
 #define	LINE_RM_MINIMAL                   0
 #define	LINE_RM_MINIMAL_STR               "Primary features, no backgound"  
 #define	LINE_RM_PRIMARY_FEATURES          1
@@ -81,6 +131,16 @@
 #define LINE_MMC_VTSIZE                   8  // voting table size
 #define LINE_MMC_VBOUNDARY                0.25
 #define LINE_MMC_HBOUNDARY                0.1
+#define LINE_MMC_BARCODES                 (LINE_MMC_CANDIDATE_BARCODES+1) // +1 for the one detectCodes() is filling
+
+// order of the pools in line_getPoolUsage()
+#define LINE_POOL_LINES                   0
+#define LINE_POOL_NODES                   1
+#define LINE_POOL_NADIRS                  2
+#define LINE_POOL_INTERSECTIONS           3
+#define LINE_POOL_BARCODES                4
+#define LINE_POOL_CLUSTERS                5
+#define LINE_POOLS                        6
 
 #define LINE_MIN_ACQUISITION_TAN_ANGLE    500
 #define LINE_MIN_ACQUISITION_LENGTH2      15*15
@@ -93,6 +153,7 @@
 #define LINE_HT_RIGHT                     0x08
 
 #define LINE_FILTERING_MULTIPLIER         16
+#define LINE_TRACKING_TRACKERS            128 // trackers matched together, more go in further batches
 
 #define LINE_LINE_FILTERING				  1
 #define LINE_INTERSECTION_FILTERING       1
@@ -168,7 +229,12 @@ struct DecodedBarCode
 
 typedef uint16_t LineGridNode;
 
+extern const LineResProfile g_lineResProfiles[LINE_RES_PROFILES];
 extern LineGridNode *g_lineGrid;
+extern uint8_t g_lineGridWidthReduction;
+extern uint8_t g_lineGridHeightReduction;
+extern uint8_t g_lineGridWidth;
+extern uint8_t g_lineGridHeight;
 
 struct Nadir
 {
@@ -335,5 +401,7 @@ int line_reversePrimary();
 int line_legoLineData(uint8_t *buf, uint32_t buflen);
 
 int32_t line_streamEdgesLines(const uint8_t &bitmap);
+int line_getPoolUsage(uint16_t *usage);
+int32_t line_getPoolUsageChirp(Chirp *chirp=NULL);
 
 #endif
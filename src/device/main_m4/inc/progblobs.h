@@ -27,6 +27,11 @@
 
 #define TYPE_REQUEST_GETBLOBS      0x20
 #define TYPE_RESPONSE_GETBLOBS     0x21
+#define TYPE_REQUEST_GETBLOBHISTORY   0x22
+#define TYPE_RESPONSE_GETBLOBHISTORY  0x23
+#define TYPE_REQUEST_GETPREDICTEDBLOBS   0x24
+#define TYPE_RESPONSE_GETPREDICTEDBLOBS  0x25
+#define TYPE_REQUEST_SETWINDOWS       0x26
 
 
 #define PROG_NAME_BLOBS            "color_connected_components"
@@ -88,6 +93,8 @@ private:
 	static uint8_t m_state;
 	static void handleRecv();
 	static void blobsAssemble(uint8_t sigmap, uint8_t n, bool checksum);
+	static void blobHistoryAssemble(uint8_t sigmap, uint8_t n, uint16_t lastFrame, bool checksum);
+	static void predictedBlobsAssemble(uint8_t sigmap, uint8_t n, uint8_t aheadMs, bool checksum);
 	static const char *m_views[];
 	static const ActionScriptlet m_actions[];
 
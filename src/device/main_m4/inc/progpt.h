@@ -53,7 +53,7 @@ public:
 	virtual int packet(uint8_t type, const uint8_t *data, uint8_t len, bool checksum);
 
 	static void acquire();
-	static BlobA *track();
+	static Tracker<BlobA> *track();
 
 private:
 	static void shadowCallback(const char *id, const uint32_t &val);
@@ -38,11 +38,22 @@
 
 #define SER_SYNC_NO_CHECKSUM          (SER_SYNC_BASE|SER_START_FLAG|SER_END_FLAG)
 #define SER_SYNC_CHECKSUM             (SER_SYNC_NO_CHECKSUM|SER_CHECKSUM_FLAG)
-#define SER_MAXLEN                    0xff
+#define SER_MAXLEN                    0xff // per packet
 #define SER_MIN_PACKET_HEADER         4
 #define SER_PACKET_HEADER_CS_SIZE     sizeof(uint16_t) // size of checksum
 #define SER_MAX_PACKET_HEADER         (SER_MIN_PACKET_HEADER + SER_PACKET_HEADER_CS_SIZE) // header + checksum
-#define SER_TXBUF_SIZE                (SER_MAXLEN+SER_MAX_PACKET_HEADER) 
+// Responses longer than SER_MAXLEN are sent as a series of packets -- the first has SER_START_FLAG
+// set, the last SER_END_FLAG, the ones in between neither.  A client has to ask for them with
+// SER_TYPE_REQUEST_MAX_RESPONSE first, otherwise responses are limited to one packet.  The serial
+// port and USB each ask for themselves.
+#define SER_MAX_RESPONSE              0x600 // enough for MAX_BLOBS blocks
+#define SER_MAX_FRAGMENTS             ((SER_MAX_RESPONSE+SER_MAXLEN-1)/SER_MAXLEN)
+#define SER_TXBUF_SIZE                (SER_MAX_RESPONSE+SER_MAX_PACKET_HEADER) 
+
+// who a response is for
+#define SER_CLIENT_SERIAL             0 // whichever serial interface is selected
+#define SER_CLIENT_USB                1 // chirp, see ser_packetChirp()
+#define SER_CLIENTS                   2
 
 // types
 
@@ -61,6 +72,7 @@
 #define SER_TYPE_REQUEST_LED          0x14
 #define SER_TYPE_REQUEST_LAMP         0x16
 #define SER_TYPE_REQUEST_FPS          0x18
+#define SER_TYPE_REQUEST_MAX_RESPONSE 0x1a
 #define SER_TYPE_REQUEST_NO_PROG_MAX  0x1f
 
 // error codes
@@ -75,8 +87,8 @@ int ser_init(Chirp *chirp);
 int32_t ser_packetChirp(const uint8_t &type, const uint32_t &len, const uint8_t *request, Chirp *chirp=NULL);
 int ser_setInterface(uint8_t interface);
 uint8_t ser_getInterface();
-uint8_t ser_getTx(uint8_t **data);
-void ser_setTx(uint8_t type, uint8_t len, bool checksum);
+uint16_t ser_getTx(uint8_t **data);
+void ser_setTx(uint8_t type, uint16_t len, bool checksum);
 
 void ser_sendResult(int32_t val, bool checksum);
 void ser_sendError(int8_t error, bool checksum);
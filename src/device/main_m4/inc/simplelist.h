@@ -17,6 +17,90 @@
 #define SIMPLELIST_H
 
 #include <new>
+#include <stdlib.h>
+
+// A fixed number of objects, allocated once.  alloc() and release() push and pop a stack of
+// the free objects, so they take constant time and don't touch the heap.  alloc() returns NULL
+// when the pool is empty, like new (std::nothrow).  m_highWater is the most objects that
+// were out at once, for sizing the pool.
+template <typename Object> class SimplePool
+{
+	public:
+	SimplePool()
+	{
+		m_objects = NULL;
+		m_free = NULL;
+		m_size = m_numFree = m_highWater = 0;
+	}
+	~SimplePool()
+	{
+		close();
+	}
+
+	int open(uint16_t size)
+	{
+		close();
+		m_objects = (Object *)malloc(size*sizeof(Object));
+		m_free = (Object **)malloc(size*sizeof(Object *));
+		if (m_objects==NULL || m_free==NULL)
+		{
+			close();
+			return -1;
+		}
+		m_size = size;
+		m_highWater = 0;
+		reset();
+		return 0;
+	}
+
+	void close()
+	{
+		if (m_objects)
+			free(m_objects);
+		if (m_free)
+			free(m_free);
+		m_objects = NULL;
+		m_free = NULL;
+		m_size = m_numFree = 0;
+	}
+
+	Object *alloc()
+	{
+		uint16_t used;
+
+		if (m_numFree==0)
+			return NULL;
+		used = m_size - m_numFree + 1;
+		if (used>m_highWater)
+			m_highWater = used;
+		return new (m_free[--m_numFree]) Object;
+	}
+
+	void release(Object *object)
+	{
+		object->~Object();
+		m_free[m_numFree++] = object;
+	}
+
+	// takes back every object, whether it was released or not, so nothing allocated since the
+	// last reset() can leak.  Nothing is destroyed, so the objects can't own anything.
+	void reset()
+	{
+		uint16_t i;
+
+		for (i=0; i<m_size; i++)
+			m_free[i] = m_objects + m_size-1-i; // m_objects[0] first
+		m_numFree = m_size;
+	}
+
+	uint16_t m_size;
+	uint16_t m_highWater;
+
+	private:
+	Object *m_objects;
+	Object **m_free;
+	uint16_t m_numFree;
+};
 
 template <typename Object> class SimpleListNode;
 
@@ -27,6 +111,7 @@ template <typename Object> class SimpleList
 	{
 		m_first = m_last = NULL;
 		m_size = 0;
+		m_pool = NULL;
 	}
 	~SimpleList()
 	{
@@ -41,7 +126,7 @@ template <typename Object> class SimpleList
 		while(n)
 		{
 			temp = n->m_next;
-			delete n;
+			deleteNode(n);
 			n = temp;
 		}
 		m_first = m_last = NULL;
@@ -50,7 +135,7 @@ template <typename Object> class SimpleList
 	
 	SimpleListNode<Object> *add(const Object &object)
 	{
-		SimpleListNode<Object> *node = new (std::nothrow) SimpleListNode<Object>;
+		SimpleListNode<Object> *node = newNode();
 
 		if (node==NULL)
 			return NULL;
@@ -86,7 +171,7 @@ template <typename Object> class SimpleList
 					m_last = nprev;
 				if (nprev)
 					nprev->m_next = n->m_next;
-				delete n;
+				deleteNode(n);
 				result = true;
 				m_size--;
 				break;
@@ -97,6 +182,7 @@ template <typename Object> class SimpleList
 		return result;
 	}
 	
+	// the lists need to have the same pool
 	void merge(SimpleList<Object> *list)
 	{
 		if (list && list->m_first)
@@ -112,9 +198,32 @@ template <typename Object> class SimpleList
 		}		
 	}
 	
+	// nodes come from pool instead of the heap -- set it while the list is empty
+	void setPool(SimplePool<SimpleListNode<Object> > *pool)
+	{
+		m_pool = pool;
+	}
+
+	// a node for add(SimpleListNode<Object> *), from the pool if there is one
+	SimpleListNode<Object> *newNode()
+	{
+		if (m_pool)
+			return m_pool->alloc();
+		return new (std::nothrow) SimpleListNode<Object>;
+	}
+
+	void deleteNode(SimpleListNode<Object> *node)
+	{
+		if (m_pool)
+			m_pool->release(node);
+		else
+			delete node;
+	}
+
 	SimpleListNode<Object> *m_first;
 	SimpleListNode<Object> *m_last;
 	uint16_t m_size;
+	SimplePool<SimpleListNode<Object> > *m_pool;
 };
 
 template <typename Object> class SimpleListNode
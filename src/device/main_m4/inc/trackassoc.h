@@ -0,0 +1,199 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef _TRACKASSOC_H
+#define _TRACKASSOC_H
+
+#include "tracker.h"
+
+// the cheapest candidates kept for each tracker
+#define TA_CANDIDATES_PER_TRACKER      3
+#define TA_NONE                        0xffff
+
+// Matches a frame's trackers to its objects (blobs, lines) for the Tracker<Object> state
+// machine.  The compare function gates each tracker's objects (TR_MAXVAL is out of the gate),
+// and the tracker keeps its TA_CANDIDATES_PER_TRACKER cheapest.  Then each tracker asks for
+// its candidates in turn, cheapest first.  An object goes to the cheapest tracker that asks,
+// and a tracker that loses its object asks for its next one.  That's the same as assigning
+// all of the pairs cheapest first, but each tracker asks at most TA_CANDIDATES_PER_TRACKER
+// times, so the work is bounded for any number of objects, where searching all of the objects
+// again after every swap isn't.
+//
+// Tiers come before cost: priority trackers (the primary line, say) first, then within those,
+// valid and trailing trackers before leading ones, so a new tracker can't take an object from
+// an established one, like Tracker::swappable().  On a tie the tracker that asked first keeps
+// the object.  Trackers past maxTrackers are matched in further batches of maxTrackers, in the
+// order they're added, to the objects the earlier batches left, so the trackers added first
+// should be the established ones.  Objects past maxObjects aren't matched.
+//
+// Usage: resetMin() every tracker and set every object's m_tracker to NULL.  Then call
+// begin(), then addTracker() for each tracker, each followed by add() for each object, then
+// assign().  Matched trackers get setMin() and their objects' m_tracker is set, and the rest
+// is as before -- Tracker::update() for every tracker and new trackers for objects with no
+// m_tracker.
+template <typename Object, uint16_t maxTrackers, uint16_t maxObjects> class TrackAssociation
+{
+public:
+	TrackAssociation()
+	{
+		begin();
+	}
+
+	void begin()
+	{
+		m_numTrackers = 0;
+		m_matched = 0;
+		m_current = NULL;
+		m_worst = 0;
+	}
+
+	void addTracker(Tracker<Object> *tracker, bool priority=false)
+	{
+		// out of room -- match this batch now, and the trackers after it get what's left
+		if (m_numTrackers>=maxTrackers)
+			match();
+		m_currentCandidates = m_candidates + m_numTrackers*TA_CANDIDATES_PER_TRACKER;
+		m_current = &m_trackers[m_numTrackers++];
+		m_current->m_tracker = tracker;
+		m_current->m_tier = priority ? 0 : 2;
+		if (tracker->m_state==TR_LEADING || tracker->m_state==TR_INVALID)
+			m_current->m_tier++;
+		m_current->m_numCandidates = 0;
+		m_current->m_next = 0;
+		m_current->m_match = TA_NONE;
+		m_worst = TR_MAXVAL;
+	}
+
+	// an object for the last tracker added, index is its place in this frame's objects, cost
+	// is from the compare function
+	void add(Object *object, uint16_t index, uint32_t cost)
+	{
+		Candidate *candidates=m_currentCandidates;
+		uint8_t i;
+
+		// most objects are out of the gate or no better than what the tracker has, so one test
+		// turns them away (m_worst is 0 before the first addTracker())
+		if (cost>=m_worst)
+			return;
+		// an object with a tracker was taken by an earlier batch
+		if (index>=maxObjects || object->m_tracker)
+			return;
+		// keep the cheapest, in order
+		i = m_current->m_numCandidates;
+		if (i==TA_CANDIDATES_PER_TRACKER)
+			i--;
+		else
+			m_current->m_numCandidates++;
+		for (; i>0 && cost<candidates[i-1].m_cost; i--)
+			candidates[i] = candidates[i-1];
+		candidates[i].m_cost = cost;
+		candidates[i].m_index = index;
+		m_objects[index] = object;
+		if (m_current->m_numCandidates==TA_CANDIDATES_PER_TRACKER)
+			m_worst = candidates[TA_CANDIDATES_PER_TRACKER-1].m_cost;
+	}
+
+	// returns the number of trackers matched
+	uint16_t assign()
+	{
+		uint16_t n;
+
+		match();
+		n = m_matched;
+		begin();
+		return n;
+	}
+
+private:
+	struct Entry
+	{
+		Tracker<Object> *m_tracker;
+		uint16_t m_match; // object index, or TA_NONE
+		uint8_t m_tier;
+		uint8_t m_numCandidates;
+		uint8_t m_next; // next candidate to ask for, the one after m_match
+	};
+
+	struct Candidate
+	{
+		uint32_t m_cost;
+		uint16_t m_index;
+	};
+
+	// match the trackers added since the last match()
+	void match()
+	{
+		uint16_t i, t;
+		Entry *entry;
+
+		for (i=0; i<maxObjects; i++)
+			m_holders[i] = TA_NONE;
+		for (i=0; i<m_numTrackers; i++)
+		{
+			// a tracker that loses its object asks again right away
+			for (t=i; t!=TA_NONE; )
+				t = ask(t);
+		}
+		for (i=0; i<m_numTrackers; i++)
+		{
+			entry = &m_trackers[i];
+			if (entry->m_match==TA_NONE)
+				continue;
+			entry->m_tracker->setMin(m_objects[entry->m_match], m_candidates[i*TA_CANDIDATES_PER_TRACKER+entry->m_next-1].m_cost);
+			m_objects[entry->m_match]->m_tracker = entry->m_tracker;
+			m_matched++;
+		}
+		m_numTrackers = 0;
+		m_current = NULL;
+	}
+
+	// tracker t asks for its candidates until it gets one, returns the tracker that lost it
+	uint16_t ask(uint16_t t)
+	{
+		Entry *entry=&m_trackers[t], *holder;
+		Candidate *candidate;
+		uint16_t h;
+
+		while (entry->m_next<entry->m_numCandidates)
+		{
+			candidate = &m_candidates[t*TA_CANDIDATES_PER_TRACKER + entry->m_next++];
+			h = m_holders[candidate->m_index];
+			if (h!=TA_NONE)
+			{
+				holder = &m_trackers[h];
+				if (holder->m_tier<entry->m_tier || (holder->m_tier==entry->m_tier &&
+					m_candidates[h*TA_CANDIDATES_PER_TRACKER + holder->m_next-1].m_cost<=candidate->m_cost))
+					continue;
+				holder->m_match = TA_NONE;
+			}
+			m_holders[candidate->m_index] = t;
+			entry->m_match = candidate->m_index;
+			return h;
+		}
+		return TA_NONE;
+	}
+
+	Entry m_trackers[maxTrackers];
+	Candidate m_candidates[maxTrackers*TA_CANDIDATES_PER_TRACKER];
+	Object *m_objects[maxObjects];
+	uint16_t m_holders[maxObjects]; // tracker holding each object
+	uint16_t m_numTrackers;
+	uint16_t m_matched; // so far this frame
+	Entry *m_current;
+	Candidate *m_currentCandidates;
+	uint32_t m_worst; // the current tracker's dearest candidate once it has all of them
+};
+
+#endif
@@ -22,6 +22,10 @@
 #define TR_DEFAULT_TRAILING_THRESH     500 // milliseconds
 #define TR_MAXVAL                      0xffffffff
 #define TR_MAXAGE                      0xff
+#define TR_MAX_MOTION_US               1000000 // microseconds -- m_motionUs stops here
+#define TR_MAX_PREDICT_US              100000  // microseconds -- predictions don't look further ahead
+#define TR_VELOCITY_FILTER             2       // each measured velocity moves the estimate 1/2^n of the way
+#define TR_MAX_VELOCITY                0x7fff  // pixels per second
 
 #define TR_EVENT_INVALIDATED           0x01
 #define TR_EVENT_VALIDATED             0x02
@@ -60,6 +64,8 @@ template <typename Object> struct Tracker
 		m_events = 0;
 		m_eventsShadow = 0;
 		m_age = 0;
+		m_vx = m_vy = 0;
+		m_motionUs = 0;
 		setTimerMs(&m_timer);
 	}
 	
@@ -183,6 +189,48 @@ template <typename Object> struct Tracker
 		return events;
 	}
 	
+	// Optional constant-velocity motion, for owners that want to gate and report with predicted
+	// positions (see Blobs::handleBlobTracking()).  Owners that use it call addTime() every
+	// frame with the time since the last frame, then motion() for a matched tracker with how far
+	// its new object is from m_object, before update().  Owners that don't never call these, and
+	// the velocity stays zero.
+	void addTime(uint32_t us)
+	{
+		m_motionUs += us;
+		if (m_motionUs>TR_MAX_MOTION_US)
+			m_motionUs = TR_MAX_MOTION_US;
+	}
+
+	void motion(int32_t dx, int32_t dy)
+	{
+		int32_t vx, vy;
+
+		if (m_motionUs==0)
+			return;
+		// pixels per second, dx and dy are at most a frame across, so this fits
+		vx = dx*1000000/(int32_t)m_motionUs;
+		vy = dy*1000000/(int32_t)m_motionUs;
+		vx = vx>TR_MAX_VELOCITY ? TR_MAX_VELOCITY : (vx<-TR_MAX_VELOCITY ? -TR_MAX_VELOCITY : vx);
+		vy = vy>TR_MAX_VELOCITY ? TR_MAX_VELOCITY : (vy<-TR_MAX_VELOCITY ? -TR_MAX_VELOCITY : vy);
+		// filtered from zero, so a first match that's wrong doesn't send the prediction off
+		m_vx += (vx-m_vx)>>TR_VELOCITY_FILTER;
+		m_vy += (vy-m_vy)>>TR_VELOCITY_FILTER;
+		m_motionUs = 0;
+	}
+
+	// how far m_object is predicted to have moved, aheadUs after the last addTime()
+	void predict(int32_t *dx, int32_t *dy, uint32_t aheadUs=0) const
+	{
+		uint32_t us;
+
+		us = m_motionUs + aheadUs;
+		if (us>TR_MAX_PREDICT_US)
+			us = TR_MAX_PREDICT_US;
+		us /= 100; // tenths of a millisecond, so the products fit
+		*dx = m_vx*(int32_t)us/10000;
+		*dy = m_vy*(int32_t)us/10000;
+	}
+
 	Object *get()
 	{
 		if (m_state==TR_INVALID || m_state==TR_LEADING)
@@ -202,6 +250,9 @@ template <typename Object> struct Tracker
 	uint32_t m_minVal;
 	Object *m_minObject;
 	Object m_object;
+	int16_t m_vx; // velocity, pixels per second
+	int16_t m_vy;
+	uint32_t m_motionUs; // microseconds since m_object was matched
 };
 
 
@@ -35,6 +35,7 @@ Qqueue *g_qqueue = NULL;
 Blobs *g_blobs = NULL;
 uint16_t g_ledBrightness;
 bool g_ledOverride = false;
+static ChirpProc g_setRLSWindowM0 = -1;
 
 
 static const ProcModule g_module[] =
@@ -84,6 +85,15 @@ static const ProcModule g_module[] =
 	"@r 0 if success, negative if error"
 	},
 	{
+	"cc_setWindows",
+	(ProcPtr)cc_setWindowsChirp,
+	{CRP_UINT8, CRP_UINTS16, END},
+	"Look for blocks only in the given windows, and on every nth row"
+	"@p decimation process every nth row, 1-8"
+	"@p windows x, y, width and height of each window, up to 4 windows, none for the whole frame"
+	"@r 0 if success, negative if error"
+	},
+	{
 	"cc_setMemory",
 	(ProcPtr)cc_setMemory,
 	{CRP_UINT32, CRP_UINTS8, END},
@@ -105,7 +115,9 @@ const uint32_t g_colors[] =
 };
 
 
-int cc_loadLut(void)
+// signum 0 loads all signatures, otherwise just signum is loaded and only its part of the
+// lut is regenerated
+int cc_loadLut(uint8_t signum)
 {
 	int i, res;
 	uint32_t len;
@@ -114,6 +126,8 @@ int cc_loadLut(void)
 
 	for (i=1; i<=CL_NUM_SIGNATURES; i++)
 	{
+		if (signum && i!=signum)
+			continue;
 		sprintf(id, "signature%d", i);
 		// get signature and add to color lut
 		res = prm_get(id, &len, &psig, END);
@@ -122,7 +136,7 @@ int cc_loadLut(void)
 		g_blobs->m_clut.setSignature(i, *psig);
 	}
 
-	g_blobs->m_clut.generateLUT();
+	g_blobs->m_clut.generateLUT(signum);
 	// go ahead and flush since we've changed things
 	g_qqueue->flush();
 
@@ -131,9 +145,11 @@ int cc_loadLut(void)
 
 void cc_signatureCallback(const char *id, const float &val)
 {
+	uint8_t signum = 0; // minimum brightness affects all signatures
+
 	if (id[0]=='S') // set Signature range
 	{
-		uint8_t signum = id[10]-'0'; // extract signature number
+		signum = id[10]-'0'; // extract signature number
 		g_blobs->m_clut.setSigRange(signum, val);
 	}
 	else if (id[0]=='M') // set minimum brightness 
@@ -142,7 +158,7 @@ void cc_signatureCallback(const char *id, const float &val)
   if (exec_pauseM0()) // pause M0, but only generate LUT if we're running 
 	{
 		// generate lut while M0 is paused
-		g_blobs->m_clut.generateLUT();			
+		g_blobs->m_clut.generateLUT(signum);			
 		exec_resumeM0();
 	}
 }
@@ -168,6 +184,10 @@ void cc_shadowCallback(const char *id, const void *val)
 		g_blobs->setBlobFiltering(*(uint8_t *)val);
 	else if (strcmp(id, "Max tracking velocity")==0)
 		g_blobs->setMaxBlobVelocity(*(uint16_t *)val);	
+	else if (strcmp(id, "Block prediction")==0)
+		g_blobs->setBlobPrediction(*(uint8_t *)val);
+	else if (strcmp(id, "Block assembly")==0)
+		g_blobs->setBlobAssembly((BlobAssembly)*(uint8_t *)val);
 }
 
 
@@ -237,9 +257,15 @@ void cc_loadParams(void)
 	prm_add("Max tracking velocity", progFlags | PRM_FLAG_SLIDER, PRM_PRIORITY_4+2,
 		"@c Expert @m 10 @M 320 Sets the maximum velocity a block can be tracked in pixels-per-second (default " STRINGIFY(BL_MAX_TRACKING_DIST) ")", INT16(BL_MAX_TRACKING_DIST), END);
 	prm_setShadowCallback("Max tracking velocity", (ShadowCallback)cc_shadowCallback);
+	prm_add("Block prediction", progFlags, PRM_PRIORITY_4+2,
+		"@c Expert Tracks blocks where their velocity predicts they'll be, instead of where they were last seen (default true)", UINT8(1), END);
+	prm_setShadowCallback("Block prediction", (ShadowCallback)cc_shadowCallback);
+	prm_add("Block assembly", progFlags, PRM_PRIORITY_4+2,
+		"@c Expert Sets how pixels are assembled into blocks.  Both give the same blocks; union-find handles all signatures in one pass (default linked list) @s 0=Linked_list @s 1=Union-find", UINT8(0), END);
+	prm_setShadowCallback("Block assembly", (ShadowCallback)cc_shadowCallback);
 
 	// load
-	uint8_t ccMode, filtering;
+	uint8_t ccMode, filtering, assembly, prediction;
 	uint16_t maxBlobs, maxBlobsPerModel, maxVel, mergeDist;
 	uint32_t minArea, growDist;
 	float miny;
@@ -254,6 +280,8 @@ void cc_loadParams(void)
 	prm_get("LED brightness", &g_ledBrightness, END);
 	prm_get("Block filtering", &filtering, END);
 	prm_get("Max tracking velocity", &maxVel, END);
+	prm_get("Block prediction", &prediction, END);
+	prm_get("Block assembly", &assembly, END);
 	
 	g_blobs->setMaxBlobs(maxBlobs);
 	g_blobs->setMaxBlobsPerModel(maxBlobsPerModel);
@@ -265,6 +293,8 @@ void cc_loadParams(void)
 	led_setMaxCurrent(g_ledBrightness);
 	g_blobs->setBlobFiltering(filtering);
 	g_blobs->setMaxBlobVelocity(maxVel);
+	g_blobs->setBlobPrediction(prediction);
+	g_blobs->setBlobAssembly((BlobAssembly)assembly);
 	
 	cc_loadLut();
 }
@@ -276,6 +306,10 @@ int cc_init(Chirp *chirp)
 
 	chirp->registerModule(g_module);	
 
+	g_setRLSWindowM0 = g_chirpM0->getProc("setRLSWindow", NULL);
+	if (g_setRLSWindowM0<0)
+		return -1;
+
 	cc_loadParams(); // setup default vals and load parameters
 
 	return 0;
@@ -290,9 +324,40 @@ int cc_open()
 int cc_close()
 {
 	g_blobs->reset();
+	cc_setWindows(1, 0, NULL); // the next program gets the whole frame
 	return 0;
 }
 
+// Blobs looks for blocks in the windows, and the M0 only does the rows the windows cover
+int32_t cc_setWindows(uint8_t decimation, uint8_t numWindows, const RectA *windows)
+{
+	int32_t res, responseInt = -1;
+	uint16_t top, bottom;
+
+	res = g_blobs->setWindows(windows, numWindows, decimation);
+	if (res<0)
+		return res;
+	g_blobs->getRowWindow(&top, &bottom, &decimation);
+	res = g_chirpM0->callSync(g_setRLSWindowM0, UINT16(top), UINT16(bottom), UINT8(decimation), END_OUT_ARGS, &responseInt, END_IN_ARGS);
+	if (res<0)
+		return res;
+
+	return responseInt;
+}
+
+int32_t cc_setWindowsChirp(const uint8_t &decimation, const uint32_t &len, const uint16_t *windows)
+{
+	RectA rects[BL_MAX_WINDOWS];
+	uint32_t i;
+
+	if (len%4 || len/4>BL_MAX_WINDOWS)
+		return -1;
+	for (i=0; i<len/4; i++)
+		rects[i] = RectA(windows[i*4], windows[i*4+1], windows[i*4+2], windows[i*4+3]);
+
+	return cc_setWindows(decimation, len/4, rects);
+}
+
 // this routine assumes it can grab valid pixels in video memory described by the box
 int32_t cc_setSigRegion(const uint32_t &type, const uint8_t &signum, const uint16_t &xoffset, const uint16_t &yoffset, const uint16_t &width, const uint16_t &height, Chirp *chirp)
 {
@@ -320,7 +385,7 @@ int32_t cc_setSigRegion(const uint32_t &type, const uint8_t &signum, const uint1
 	// save to flash
 	sprintf(id, "signature%d", signum);
 	prm_set(id, INTS8(sizeof(ColorSignature), sig), END);
-	cc_loadLut();
+	cc_loadLut(signum);
 
 	cprintf(0, "Signature set!\n");
 
@@ -357,7 +422,7 @@ int32_t cc_setSigPoint(const uint32_t &type, const uint8_t &signum, const uint16
 	// save to flash
 	sprintf(id, "signature%d", signum);
 	prm_set(id, INTS8(sizeof(ColorSignature), sig), END);
-	cc_loadLut();
+	cc_loadLut(signum);
 
 	cprintf(0, "Signature set!\n");
 
@@ -378,10 +443,9 @@ int32_t cc_clearSig(const uint8_t &signum, Chirp *chirp)
 
 	sprintf(id, "signature%d", signum);
 	res = prm_set(id, INTS8(sizeof(ColorSignature), &sig), END);
-	cc_loadLut();
 
 	// update lut
- 	cc_loadLut();
+ 	cc_loadLut(signum);
 
     exec_sendEvent(chirp, EVT_PARAM_CHANGE);
 
@@ -32,12 +32,22 @@
 #include "misc.h"
 #include "calc.h"
 #include "simplelist.h"
+#ifdef CORE_M4
+#include "lpc43xx.h"
+#endif
 
 #define ABS(x)      ((x)<0 ? -(x) : (x))
 #define SIGN(x)     ((x)>=0 ? 1 : -1)
 
 #define LINE_BUFSIZE    CAM_RES3_WIDTH/2
 
+// trailing zeros of a nonzero word -- rbit, clz on the M4
+#ifdef CORE_M4
+#define LINE_CTZ(bits)  __CLZ(__RBIT(bits))
+#else
+#define LINE_CTZ(bits)  __builtin_ctz(bits)
+#endif
+
 Equeue *g_equeue;
 
 static uint16_t *g_lineBuf;
@@ -61,8 +71,32 @@ static uint8_t g_repeat;
 static ChirpProc g_getEdgesM0 = -1;
 static ChirpProc g_setEdgeParamsM0 = -1;
 
+const LineResProfile g_lineResProfiles[LINE_RES_PROFILES] =
+{
+	{3, 1, 15, 0}, // LINE_RES_STANDARD
+	{2, 1, 3, 0},  // LINE_RES_FINE
+	{2, 0, 3, 1}   // LINE_RES_FINEST
+};
+static const LineResProfile *g_lineRes = &g_lineResProfiles[LINE_RES_STANDARD];
+
+// a distance parameter, which is in standard cells, in the grid's cells
+#define LINE_CELLS(dist)                  ((dist)<<g_lineRes->m_distShift)
+
 LineGridNode *g_lineGrid;
+uint8_t g_lineGridWidthReduction = 3;
+uint8_t g_lineGridHeightReduction = 1;
+uint8_t g_lineGridWidth = CAM_RES3_WIDTH>>3;
+uint8_t g_lineGridHeight = CAM_RES3_HEIGHT>>1;
 static uint8_t *g_lineGridMem;
+// the columns of each row of g_lineGrid written since the row was cleared, left>right if none
+static uint8_t g_lineGridLeft[LINE_GRID_MAX_HEIGHT];
+static uint8_t g_lineGridRight[LINE_GRID_MAX_HEIGHT];
+// A bit for each node of g_lineGrid with LINE_NODE_FLAG_1 and not LINE_NODE_FLAG_NULL, the nodes
+// extractLineSegments() can still visit, LINE_GRID_ROW_WORDS per row.  The search for the next
+// node is a few bit tests instead of a load and two tests per neighbor, and the scan for where
+// lines start skips 32 empty nodes at a time.  g_lineGrid keeps the flags and line indexes too,
+// for the nadir search and PixyMon.
+static uint32_t *g_lineGridLive;
 static LineSeg *g_lineSegs;
 static uint8_t *g_lineSegsMem;
 static uint8_t g_pointsPerSeg;
@@ -78,9 +112,15 @@ static SimpleList<Line2> g_linesList;
 static SimpleList<Point> g_nodesList;
 static SimpleList<Nadir> g_nadirsList;
 static SimpleList<Intersection> g_intersectionsList;
+static SimplePool<SimpleListNode<Line2> > g_linesPool;
+static SimplePool<SimpleListNode<Point> > g_nodesPool;
+static SimplePool<SimpleListNode<Nadir> > g_nadirsPool;
+static SimplePool<SimpleListNode<Intersection> > g_intersectionsPool;
 
 static uint8_t g_barcodeIndex;
 static BarCode **g_candidateBarcodes;
+static SimplePool<BarCode> g_barCodePool;
+static SimplePool<BarCodeCluster> g_clusterPool;
 static DecodedBarCode *g_votedBarcodes;
 static uint8_t *g_votedBarcodesMem;
 static uint8_t g_votedBarcodeIndex;
@@ -88,6 +128,7 @@ static uint16_t g_maxCodeDist;
 static uint16_t g_minVotingThreshold;
 
 static SimpleList<Tracker<Line2> > g_lineTrackersList;
+static TrackAssociation<Line2, LINE_TRACKING_TRACKERS, LINE_MAX_LINES> *g_lineAssociation;
 static Tracker<FrameIntersection> g_primaryIntersection;
 static bool g_newIntersection;
 
@@ -183,6 +224,13 @@ bool xdirection(const Point &p0, const Point &p1)
 
 static const ProcModule g_module[] =
 {
+	{
+	"line_getPoolUsage",
+	(ProcPtr)line_getPoolUsageChirp, 
+	{END}, 
+	"Get the sizes and high-water marks of the line pools"
+	"@r number of pools, and an array of size, high-water mark pairs: lines, nodes, nadirs, intersections, barcodes, barcode clusters"
+	},
 	END
 };
 
@@ -195,6 +243,8 @@ void line_shadowCallback(const char *id, const void *val)
 	if (strcmp(id, "Edge distance")==0)
 	{
 		g_dist = *(uint16_t *)val;
+		if (g_dist>g_lineRes->m_maxDist)
+			g_dist = g_lineRes->m_maxDist;
 		callM0 = true;
 	}
 	else if (strcmp(id, "Edge threshold")==0)
@@ -210,14 +260,14 @@ void line_shadowCallback(const char *id, const void *val)
 	else if (strcmp(id, "Line extraction distance")==0)
 		g_extractionDist = *(uint16_t *)val;
 	else if (strcmp(id, "Maximum merge distance")==0)
-		g_maxMergeDist = *(uint16_t *)val;
+		g_maxMergeDist = LINE_CELLS(*(uint16_t *)val);
 	else if (strcmp(id, "Minimum line length")==0)
 	{
-		g_minLineLength = *(uint16_t *)val;
+		g_minLineLength = LINE_CELLS(*(uint16_t *)val);
 		g_minLineLength2 = g_minLineLength*g_minLineLength; // squared
 	}
 	else if (strcmp(id, "Maximum line compare")==0)
-		g_maxLineCompare = *(uint32_t *)val; 
+		g_maxLineCompare = LINE_CELLS(LINE_CELLS(*(uint32_t *)val)); // it's squared 
 	else if (strcmp(id, "White line")==0)
 		g_whiteLine = *(uint8_t *)val;
 	else if (strcmp(id, "Manual vector select")==0)
@@ -264,6 +314,9 @@ int line_loadParams(int8_t progIndex)
 			"@c Tuning @m 1 @M 150 Sets edge detection threshold (default " STRINGIFY(LINE_EDGE_THRESH_DEFAULT) ")", UINT16(LINE_EDGE_THRESH_DEFAULT), END);
 		prm_setShadowCallback("Edge threshold", (ShadowCallback)line_shadowCallback);
 
+		prm_add("Line resolution", PROG_FLAGS(progIndex), PRM_PRIORITY_4, 
+			"@c Expert Sets the resolution of the grid lines are found in.  Finer grids find thinner lines farther away, at a lower frame rate.  Takes effect when the program restarts (default standard) @s 0=Standard_(79x52) @s 1=Fine_(159x52) @s 2=Finest_(159x104)", UINT8(LINE_RES_STANDARD), END);
+
 		prm_add("Minimum line width", PROG_FLAGS(progIndex) | PRM_FLAG_SLIDER, PRM_PRIORITY_5, 
 			"@c Tuning @m 0 @M 100 Sets minimum detected line width " STRINGIFY(LINE_MIN_WIDTH) ")", UINT16(LINE_MIN_WIDTH), END);
 		prm_setShadowCallback("Minimum line width", (ShadowCallback)line_shadowCallback);
@@ -337,15 +390,20 @@ int line_loadParams(int8_t progIndex)
 	
 	// load params
 	prm_get("Edge distance", &g_dist, END);	
+	if (g_dist>g_lineRes->m_maxDist)
+		g_dist = g_lineRes->m_maxDist;
 	prm_get("Edge threshold", &g_thresh, END);	
 	g_hThresh = g_thresh*LINE_HTHRESH_RATIO;
 	prm_get("Minimum line width", &g_minLineWidth, END);
 	prm_get("Maximum line width", &g_maxLineWidth, END);
 	prm_get("Line extraction distance", &g_extractionDist, END);
 	prm_get("Maximum merge distance", &g_maxMergeDist, END);
+	g_maxMergeDist = LINE_CELLS(g_maxMergeDist);
 	prm_get("Minimum line length", &g_minLineLength, END);
+	g_minLineLength = LINE_CELLS(g_minLineLength);
 	g_minLineLength2 = g_minLineLength*g_minLineLength; // square it 
 	prm_get("Maximum line compare", &g_maxLineCompare, END);
+	g_maxLineCompare = LINE_CELLS(LINE_CELLS(g_maxLineCompare)); // it's squared
 	prm_get("White line", &g_whiteLine, END);
 	prm_get("Intersection filtering", &g_lineFiltering, END);
 	leading = g_lineFiltering*LINE_FILTERING_MULTIPLIER;
@@ -379,6 +437,9 @@ int line_init(Chirp *chirp)
 
 int line_open(int8_t progIndex)
 {
+	uint8_t res;
+	bool poolError;
+	
 	g_linesList.clear();
 	g_nodesList.clear();
 	g_nadirsList.clear();
@@ -386,8 +447,18 @@ int line_open(int8_t progIndex)
 	g_lineTrackersList.clear();
 	g_barCodeTrackersList.clear();
 	
+	// the grid's memory is sized from the resolution, so it's only read here
+	if (prm_get("Line resolution", &res, END)<0 || res>=LINE_RES_PROFILES)
+		res = LINE_RES_STANDARD;
+	g_lineRes = &g_lineResProfiles[res];
+	g_lineGridWidthReduction = g_lineRes->m_widthReduction;
+	g_lineGridHeightReduction = g_lineRes->m_heightReduction;
+	g_lineGridWidth = CAM_RES3_WIDTH>>g_lineGridWidthReduction;
+	g_lineGridHeight = CAM_RES3_HEIGHT>>g_lineGridHeightReduction;
+	
 	g_lineGridMem = (uint8_t *)malloc(LINE_GRID_WIDTH*LINE_GRID_HEIGHT*sizeof(LineGridNode)+CAM_PREBUF_LEN+8); // +8 for extra memory at the end because little overruns sometimes happen
 	g_lineGrid = (LineGridNode *)(g_lineGridMem+CAM_PREBUF_LEN);
+	g_lineGridLive = (uint32_t *)malloc(LINE_GRID_HEIGHT*LINE_GRID_ROW_WORDS*sizeof(uint32_t));
 	
 	g_lines = (SimpleListNode<Line2> **)malloc(LINE_MAX_LINES*sizeof(SimpleListNode<Line2> *));
 	g_lineSegsMem = (uint8_t *)malloc(LINE_MAX_SEGMENTS*sizeof(LineSeg)+CAM_PREBUF_LEN);
@@ -395,11 +466,21 @@ int line_open(int8_t progIndex)
 	
 	g_candidateBarcodes = (BarCode **)malloc(LINE_MMC_CANDIDATE_BARCODES*sizeof(BarCode *));
 	
+	// the lists and barcodes of a frame come from these instead of the heap
+	poolError = g_linesPool.open(LINE_MAX_LINES)<0 || g_nodesPool.open(LINE_MAX_NODES)<0 || 
+		g_nadirsPool.open(LINE_MAX_NADIRS)<0 || g_intersectionsPool.open(LINE_MAX_INTERSECTIONS)<0 || 
+		g_barCodePool.open(LINE_MMC_BARCODES)<0 || g_clusterPool.open(LINE_MMC_VOTED_BARCODES)<0;
+	g_linesList.setPool(&g_linesPool);
+	g_nodesList.setPool(&g_nodesPool);
+	g_nadirsList.setPool(&g_nadirsPool);
+	g_intersectionsList.setPool(&g_intersectionsPool);
+	
 	g_votedBarcodesMem = (uint8_t *)malloc(LINE_MMC_VOTED_BARCODES*sizeof(DecodedBarCode)+CAM_PREBUF_LEN);
 	g_votedBarcodes = (DecodedBarCode *)(g_votedBarcodesMem+CAM_PREBUF_LEN);
 	
 	g_lineBuf = (uint16_t *)malloc(LINE_BUFSIZE*sizeof(uint16_t)); 
 	g_equeue = new (std::nothrow) Equeue;
+	g_lineAssociation = new (std::nothrow) TrackAssociation<Line2, LINE_TRACKING_TRACKERS, LINE_MAX_LINES>;
 
 	g_maxSegTanAngle = tan(M_PI/4)*1000;
 	g_maxEquivTanAngle = tan(M_PI/10)*1000;
@@ -428,14 +509,20 @@ int line_open(int8_t progIndex)
 	
 	g_renderMode = LINE_RM_ALL_FEATURES;
 	
-	if (g_equeue==NULL || g_lineBuf==NULL || g_lineGridMem==NULL || g_lineSegsMem==NULL || 
-		g_lines==NULL || g_candidateBarcodes==NULL || g_votedBarcodesMem==NULL)
+	if (g_equeue==NULL || g_lineBuf==NULL || g_lineGridMem==NULL || g_lineGridLive==NULL || g_lineSegsMem==NULL || 
+		g_lines==NULL || g_candidateBarcodes==NULL || g_votedBarcodesMem==NULL || g_lineAssociation==NULL || poolError)
 	{
 		cprintf(0, "Line memory error\n");
 		line_close();
 		return -1;
 	}
 	
+	// after this, only what's written is cleared, see clearDirtyGrid()
+	memset(g_lineGrid, 0, LINE_GRID_WIDTH*LINE_GRID_HEIGHT*sizeof(LineGridNode));
+	memset(g_lineGridLive, 0, LINE_GRID_HEIGHT*LINE_GRID_ROW_WORDS*sizeof(uint32_t));
+	memset(g_lineGridLeft, 0xff, LINE_GRID_HEIGHT);
+	memset(g_lineGridRight, 0, LINE_GRID_HEIGHT);
+	
 	g_repeat = 0;
 	
 	g_frameFlag = false;
@@ -447,10 +534,14 @@ void line_close()
 {
 	if (g_equeue)
 		delete g_equeue;
+	if (g_lineAssociation)
+		delete g_lineAssociation;
 	if (g_lineBuf)
 		free(g_lineBuf);
 	if (g_lineGridMem)
 		free(g_lineGridMem);
+	if (g_lineGridLive)
+		free(g_lineGridLive);
 	if (g_lineSegsMem)
 		free(g_lineSegsMem);
 	if (g_lines)
@@ -465,6 +556,12 @@ void line_close()
 	g_intersectionsList.clear();
 	g_lineTrackersList.clear();
 	g_barCodeTrackersList.clear();
+	g_linesPool.close();
+	g_nodesPool.close();
+	g_nadirsPool.close();
+	g_intersectionsPool.close();
+	g_barCodePool.close();
+	g_clusterPool.close();
 }
 
 int32_t line_getEdges()
@@ -477,6 +574,114 @@ int32_t line_getEdges()
 }
 
 
+static inline void markGrid(uint8_t x, uint8_t y)
+{
+	if (x<g_lineGridLeft[y])
+		g_lineGridLeft[y] = x;
+	if (x>g_lineGridRight[y])
+		g_lineGridRight[y] = x;
+}
+
+// marks the columns left through right of the rows top through bottom, clipped to the grid
+static void markGrid(int16_t left, int16_t right, int16_t top, int16_t bottom)
+{
+	if (left<0)
+		left = 0;
+	if (right>=LINE_GRID_WIDTH)
+		right = LINE_GRID_WIDTH-1;
+	if (top<0)
+		top = 0;
+	if (bottom>=LINE_GRID_HEIGHT)
+		bottom = LINE_GRID_HEIGHT-1;
+	for (; top<=bottom; top++)
+	{
+		markGrid(left, top);
+		markGrid(right, top);
+	}
+}
+
+static inline bool liveNode(uint8_t x, uint8_t y)
+{
+	return g_lineGridLive[y*LINE_GRID_ROW_WORDS + (x>>5)]&(1<<(x&0x1f));
+}
+
+static inline void clearLiveNode(uint8_t x, uint8_t y)
+{
+	g_lineGridLive[y*LINE_GRID_ROW_WORDS + (x>>5)] &= ~(1<<(x&0x1f));
+}
+
+// the live nodes at x-1, x and x+1 of row y in bits 0, 1 and 2
+static inline uint32_t liveNodes3(uint8_t x, uint8_t y)
+{
+	const uint32_t *row = g_lineGridLive + y*LINE_GRID_ROW_WORDS;
+	uint32_t bits;
+	uint8_t x0;
+	
+	if (x==0)
+		return (row[0]<<1)&0x06;
+	x0 = x-1;
+	bits = row[x0>>5]>>(x0&0x1f);
+	if ((x0&0x1f)>29 && (x0>>5)<LINE_GRID_ROW_WORDS-1) // straddles 2 words
+		bits |= row[(x0>>5)+1]<<(32-(x0&0x1f));
+	return bits&0x07;
+}
+
+// the first live node of row y at or after x, LINE_GRID_WIDTH if there isn't one
+static inline uint8_t nextLiveNode(uint8_t x, uint8_t y)
+{
+	const uint32_t *row = g_lineGridLive + y*LINE_GRID_ROW_WORDS;
+	uint32_t bits;
+	
+	while (x<LINE_GRID_WIDTH)
+	{
+		bits = row[x>>5]>>(x&0x1f);
+		if (bits)
+			return x + LINE_CTZ(bits);
+		x = (x|0x1f) + 1; // next word
+	}
+	return LINE_GRID_WIDTH;
+}
+
+// index can be past the end of its row (the line is at the right edge), so the row is found from it
+static inline void setGridNode(uint16_t index, LineGridNode flag)
+{
+	uint16_t x, y;
+	
+	g_lineGrid[index] |= flag;
+	y = index/LINE_GRID_WIDTH;
+	if (y<LINE_GRID_HEIGHT)
+	{
+		x = index - y*LINE_GRID_WIDTH;
+		markGrid(x, y);
+		g_lineGridLive[y*LINE_GRID_ROW_WORDS + (x>>5)] |= 1<<(x&0x1f);
+	}
+}
+
+// node index is at x, y
+static inline void nullGridNode(uint16_t index, uint8_t x, uint8_t y)
+{
+	g_lineGrid[index] |= LINE_NODE_FLAG_NULL;
+	clearLiveNode(x, y);
+}
+
+// Most of the grid is empty in a line following scene, so instead of clearing the whole grid
+// each frame, only the part of each row between the first and last nodes written is cleared.
+static void clearDirtyGrid()
+{
+	uint8_t y;
+	
+	for (y=0; y<LINE_GRID_HEIGHT; y++)
+	{
+		if (g_lineGridLeft[y]<=g_lineGridRight[y])
+		{
+			memset(&LINE_GRID(g_lineGridLeft[y], y), 0, (g_lineGridRight[y]-g_lineGridLeft[y]+1)*sizeof(LineGridNode));
+			memset(g_lineGridLive + y*LINE_GRID_ROW_WORDS, 0, LINE_GRID_ROW_WORDS*sizeof(uint32_t));
+		}
+		g_lineGridLeft[y] = 0xff;
+		g_lineGridRight[y] = 0;
+	}
+}
+
 int line_hLine(uint8_t row, uint16_t *buf, uint32_t len)
 {
 	uint16_t j, index, bit0, bit1, col0, col1, lineWidth;
@@ -495,9 +700,9 @@ int line_hLine(uint8_t row, uint16_t *buf, uint32_t len)
 				lineWidth = col1 - col0;
 				if (g_minLineWidth<lineWidth && lineWidth<g_maxLineWidth)
 				{
-					index = LINE_GRID_INDEX((((col0+col1)>>1) + g_dist)>>3, row>>1);
+					index = LINE_GRID_INDEX((((col0+col1)>>1) + g_dist)>>LINE_GRID_WIDTH_REDUCTION, row>>LINE_GRID_HEIGHT_REDUCTION);
 					if (index<LINE_GRID_WIDTH*LINE_GRID_HEIGHT+8)
-						g_lineGrid[index] |= LINE_NODE_FLAG_HLINE;
+						setGridNode(index, LINE_NODE_FLAG_HLINE);
 					else
 						cprintf(0, "high index\n");
 				}
@@ -517,9 +722,9 @@ int line_hLine(uint8_t row, uint16_t *buf, uint32_t len)
 				lineWidth = col1 - col0;
 				if (g_minLineWidth<lineWidth && lineWidth<g_maxLineWidth)
 				{
-					index = LINE_GRID_INDEX((((col0+col1)>>1) + g_dist)>>3, row>>1);
+					index = LINE_GRID_INDEX((((col0+col1)>>1) + g_dist)>>LINE_GRID_WIDTH_REDUCTION, row>>LINE_GRID_HEIGHT_REDUCTION);
 					if (index<LINE_GRID_WIDTH*LINE_GRID_HEIGHT+8)
-						g_lineGrid[index] |= LINE_NODE_FLAG_HLINE;
+						setGridNode(index, LINE_NODE_FLAG_HLINE);
 					else
 						cprintf(0, "high index\n");
 				}
@@ -549,9 +754,9 @@ int line_vLine(uint8_t row, uint8_t *vstate, uint16_t *buf, uint32_t len)
 					lineWidth = (row - (vstate[col0]-1))<<2; // multiply by 4 because vertical is subsampled by 4
 					if (g_minLineWidth<lineWidth && lineWidth<g_maxLineWidth && col0<LINE_VSIZE)
 					{
-						index = LINE_GRID_INDEX(col0>>1, (row - (lineWidth>>3))>>1);
+						index = LINE_GRID_INDEX((col0<<2)>>LINE_GRID_WIDTH_REDUCTION, (row - (lineWidth>>3))>>LINE_GRID_HEIGHT_REDUCTION); // col0 is every 4th column
 						if (index<LINE_GRID_WIDTH*LINE_GRID_HEIGHT+8)
-							g_lineGrid[index] |= LINE_NODE_FLAG_VLINE;
+							setGridNode(index, LINE_NODE_FLAG_VLINE);
 						else
 							cprintf(0, "high index\n");
 					}
@@ -575,9 +780,9 @@ int line_vLine(uint8_t row, uint8_t *vstate, uint16_t *buf, uint32_t len)
 					lineWidth = (row - (vstate[col0]-1))<<2; // multiply by 4 because vertical is subsampled by 4
 					if (g_minLineWidth<lineWidth && lineWidth<g_maxLineWidth && col0<LINE_VSIZE)
 					{
-						index = LINE_GRID_INDEX(col0>>1, (row - (lineWidth>>3))>>1);
+						index = LINE_GRID_INDEX((col0<<2)>>LINE_GRID_WIDTH_REDUCTION, (row - (lineWidth>>3))>>LINE_GRID_HEIGHT_REDUCTION); // col0 is every 4th column
 						if (index<LINE_GRID_WIDTH*LINE_GRID_HEIGHT+8)
-							g_lineGrid[index] |= LINE_NODE_FLAG_VLINE;
+							setGridNode(index, LINE_NODE_FLAG_VLINE);
 						else
 							cprintf(0, "high index\n");
 					}
@@ -668,16 +873,17 @@ void cleanGrid(Point ps[], uint8_t points)
 		{
 			j = LINE_GRID_INDEX_P(ps[i]);
 
+			markGrid(ps[i].m_x-2, ps[i].m_x+2, ps[i].m_y, ps[i].m_y);
 			g_lineGrid[j] &= ~LINE_NODE_LINE_MASK;
 			g_lineGrid[j] |= g_lineIndex;
 			if (ps[i].m_x>0)
-				g_lineGrid[j-1] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j-1, ps[i].m_x-1, ps[i].m_y);
 			if (ps[i].m_x>1)
-				g_lineGrid[j-2] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j-2, ps[i].m_x-2, ps[i].m_y);
 			if (ps[i].m_x<LINE_GRID_WIDTH-1)
-				g_lineGrid[j+1] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j+1, ps[i].m_x+1, ps[i].m_y);
 			if (ps[i].m_x<LINE_GRID_WIDTH-2)
-				g_lineGrid[j+2] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j+2, ps[i].m_x+2, ps[i].m_y);
 		}
 	}
 	else // horizontal
@@ -686,16 +892,17 @@ void cleanGrid(Point ps[], uint8_t points)
 		{
 			j = LINE_GRID_INDEX_P(ps[i]);
 			
+			markGrid(ps[i].m_x, ps[i].m_x, ps[i].m_y-2, ps[i].m_y+2);
 			g_lineGrid[j] &= ~LINE_NODE_LINE_MASK;
 			g_lineGrid[j] |= g_lineIndex;
 			if (ps[i].m_y>0)
-				g_lineGrid[j-LINE_GRID_WIDTH] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j-LINE_GRID_WIDTH, ps[i].m_x, ps[i].m_y-1);
 			if (ps[i].m_y>1)
-				g_lineGrid[j-LINE_GRID_WIDTH-LINE_GRID_WIDTH] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j-LINE_GRID_WIDTH-LINE_GRID_WIDTH, ps[i].m_x, ps[i].m_y-2);
 			if (ps[i].m_y<LINE_GRID_HEIGHT-1)
-				g_lineGrid[j+LINE_GRID_WIDTH] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j+LINE_GRID_WIDTH, ps[i].m_x, ps[i].m_y+1);
 			if (ps[i].m_y<LINE_GRID_HEIGHT-2)
-				g_lineGrid[j+LINE_GRID_WIDTH+LINE_GRID_WIDTH] |= LINE_NODE_FLAG_NULL;
+				nullGridNode(j+LINE_GRID_WIDTH+LINE_GRID_WIDTH, ps[i].m_x, ps[i].m_y+2);
 		}
 	}
 	// mark last point
@@ -779,110 +986,81 @@ LineSegIndex finishGridNode(Point ps[], uint8_t points, LineSegIndex prevSeg, Po
 
 bool ydirUp(Point &p, uint16_t &i, uint8_t &points, Point ps[])
 {
+	uint32_t bits;
+	
 	if (p.m_y==0)
 		return false;
 
-	if (g_lineGrid[i-LINE_GRID_WIDTH]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-LINE_GRID_WIDTH]&LINE_NODE_FLAG_NULL))
-	{
-		p.m_y--;
-		ps[points] = p;
+	// up, then up-left, then up-right
+	bits = liveNodes3(p.m_x, p.m_y-1);
+	if (bits==0) // no points in the up direction
+		return false;
+	p.m_y--;
+	if (bits&0x02)
 		i += -LINE_GRID_WIDTH;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
-	}
-	else if (p.m_x>0 && g_lineGrid[i-LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_NULL))
+	else if (bits&0x01)
 	{
-		p.m_y--;
 		p.m_x--;
-		ps[points] = p;
 		i += -LINE_GRID_WIDTH-1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
-	else if (p.m_x<LINE_GRID_WIDTH-1 && g_lineGrid[i-LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_NULL))
+	else
 	{
-		p.m_y--;
 		p.m_x++;
-		ps[points] = p;
 		i += -LINE_GRID_WIDTH+1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
-	else // no points in the up direction
-		return false;
+	ps[points++] = p;
+	nullGridNode(i, p.m_x, p.m_y);
+	return true;
 }
 
 bool xdirLeft(Point &p, uint16_t &i, uint8_t &points, Point ps[])
 {
-	if (p.m_x>0 && g_lineGrid[i-1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-1]&LINE_NODE_FLAG_NULL))
-	{
-		p.m_x--;
-		ps[points] = p;
-		i+= -1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
-	}
-	else if (p.m_x>0 && p.m_y>0 && g_lineGrid[i-LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_NULL))
+	if (p.m_x==0)
+		return false;
+	
+	if (liveNode(p.m_x-1, p.m_y))
+		i += -1;
+	else if (p.m_y>0 && liveNode(p.m_x-1, p.m_y-1))
 	{
 		p.m_y--;
-		p.m_x--;
-		ps[points] = p;
 		i += -LINE_GRID_WIDTH-1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
-	else if (p.m_x>0 && p.m_y<LINE_GRID_HEIGHT-1 && g_lineGrid[i+LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i+LINE_GRID_WIDTH-1]&LINE_NODE_FLAG_NULL))
+	else if (p.m_y<LINE_GRID_HEIGHT-1 && liveNode(p.m_x-1, p.m_y+1))
 	{
 		p.m_y++;
-		p.m_x--;
-		ps[points] = p;
 		i += LINE_GRID_WIDTH-1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
 	else
 		return false;
+	p.m_x--;
+	ps[points++] = p;
+	nullGridNode(i, p.m_x, p.m_y);
+	return true;
 }
 
 bool xdirRight(Point &p, uint16_t &i, uint8_t &points, Point ps[])
 {
-	if (p.m_x<LINE_GRID_WIDTH-1 && g_lineGrid[i+1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i+1]&LINE_NODE_FLAG_NULL))
-	{
-		p.m_x++;
-		ps[points] = p;
+	if (p.m_x>=LINE_GRID_WIDTH-1)
+		return false;
+	
+	if (liveNode(p.m_x+1, p.m_y))
 		i += 1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
-	}
-	else if (p.m_x<LINE_GRID_WIDTH-1 && p.m_y>0 && g_lineGrid[i-LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i-LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_NULL))
+	else if (p.m_y>0 && liveNode(p.m_x+1, p.m_y-1))
 	{
 		p.m_y--;
-		p.m_x++;
-		ps[points] = p;
 		i += -LINE_GRID_WIDTH+1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
-	else if (p.m_x<LINE_GRID_WIDTH-1 && p.m_y<LINE_GRID_HEIGHT-1 && g_lineGrid[i+LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_1 && !(g_lineGrid[i+LINE_GRID_WIDTH+1]&LINE_NODE_FLAG_NULL))
+	else if (p.m_y<LINE_GRID_HEIGHT-1 && liveNode(p.m_x+1, p.m_y+1))
 	{
 		p.m_y++;
-		p.m_x++;
-		ps[points] = p;
 		i += LINE_GRID_WIDTH+1;
-		g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
-		points++;
-		return true;
 	}
 	else
 		return false;
+	p.m_x++;
+	ps[points++] = p;
+	nullGridNode(i, p.m_x, p.m_y);
+	return true;
 }
 
 void extractLineSegments(const Point &p)
@@ -899,7 +1077,7 @@ void extractLineSegments(const Point &p)
 	
 	// nullify current point
 	ps[0] = p2;
-	g_lineGrid[i] |= LINE_NODE_FLAG_NULL;
+	nullGridNode(i, p2.m_x, p2.m_y);
 	points++;
 		
 	while(1)
@@ -1001,21 +1179,16 @@ void extractLineSegments(const Point &p)
 
 void extractLineSegments()
 {
-	int8_t i, j;
-	uint16_t k;
-	LineGridNode node;
+	int8_t i;
+	uint8_t j;
 	
 	for (i=LINE_GRID_HEIGHT-1; i>=0; i--) // bottom-up
 	{
-		k = i*LINE_GRID_WIDTH;
-		for (j=0; j<LINE_GRID_WIDTH; j++, k++)
-		{
-			node = g_lineGrid[k];
-			if (node&LINE_NODE_FLAG_1 && !(node&LINE_NODE_FLAG_NULL))
-				// we could do some analysis here to find the end of the continuous train of pixels, then asses which direction 
-				// the line is headed, upper-right, upper-left if it's horizontal
-				extractLineSegments(Point(j, i)); 
-		}
+		// the row is read again after each line, which visits (nulls) nodes of this row too
+		for (j=nextLiveNode(0, i); j<LINE_GRID_WIDTH; j=nextLiveNode(j+1, i))
+			// we could do some analysis here to find the end of the continuous train of pixels, then asses which direction 
+			// the line is headed, upper-right, upper-left if it's horizontal
+			extractLineSegments(Point(j, i)); 
 	}
 }
 
@@ -1080,7 +1253,7 @@ void addNadir(const Point &p0, const Point &p1)
 
 void search(const Point &p, uint8_t radius)
 {
-	int8_t i, r;
+	int16_t i, r;
 	uint16_t j, k;
 	uint8_t i0, i1;
 	
@@ -1204,7 +1377,7 @@ void addLine(SimpleListNode<Nadir> *nadirs, uint8_t li0, const Point &p01, Simpl
 {
 	SimpleListNode<Intersection> *j;
 	uint8_t i, li1 = linen1->m_object.m_index;
-	int8_t diffx, diffy;
+	int16_t diffx, diffy;
 	bool horiz;
 	const Line2 &line1 = linen1->m_object;
 
@@ -1387,7 +1560,7 @@ void formIntersections()
 	// go through nadir list and break up the lines
 	for (i=g_nadirsList.m_first; i!=NULL; i=i->m_next)
 	{
-		SimpleListNode<Intersection> *intern = new (std::nothrow) SimpleListNode<Intersection>;
+		SimpleListNode<Intersection> *intern = g_intersectionsList.newNode();
 		if (intern==NULL)
 			return;
 		Intersection *inter = &intern->m_object;
@@ -2023,7 +2196,7 @@ void clusterCodes()
             continue;
         if (j>=numClusters) // new entry
         {
-            clusters[j] = new (std::nothrow) BarCodeCluster;
+            clusters[j] = g_clusterPool.alloc();
 			if (clusters[j]==NULL)
 				break;
             // reset positions
@@ -2069,10 +2242,10 @@ void clusterCodes()
 #endif
 	
     for (i=0; i<numClusters; i++)
-        delete clusters[i];
+        g_clusterPool.release(clusters[i]);
 
     for (i=0; i<g_barcodeIndex; i++)
-        delete g_candidateBarcodes[i];
+        g_barCodePool.release(g_candidateBarcodes[i]);
 }
 
 int32_t decodeCode(BarCode *bc, uint16_t dec)
@@ -2242,7 +2415,7 @@ void detectCodes(uint8_t row, uint16_t *edges, uint32_t len)
 	if (len<LINE_MMC_MIN_EDGES)
 		return;
 
-	bc = new (std::nothrow) BarCode;
+	bc = g_barCodePool.alloc();
 	if (bc==NULL)
 		return;
 	
@@ -2267,7 +2440,7 @@ void detectCodes(uint8_t row, uint16_t *edges, uint32_t len)
 				if (res)
 				{
 					g_candidateBarcodes[g_barcodeIndex++] = bc;
-					bc = new (std::nothrow) BarCode;
+					bc = g_barCodePool.alloc();
 					if (bc==NULL)
 						return;
 				}
@@ -2276,7 +2449,7 @@ void detectCodes(uint8_t row, uint16_t *edges, uint32_t len)
 	}
 
 	end:	
-	delete bc;
+	g_barCodePool.release(bc);
 }
 
 int sendCodes(uint8_t renderFlags)
@@ -2312,7 +2485,7 @@ int sendTrackedCodes(uint8_t renderFlags)
 
 void clearGrid(const RectB rect)
 {
-	uint8_t i, j;
+	uint8_t i, j, left, right;
 	uint16_t index;
 	uint16_t height;
 	int16_t r0;
@@ -2326,8 +2499,14 @@ void clearGrid(const RectB rect)
 		r0 = 0;
 	for (i=r0; i<=rect.m_bottom; i++)
 	{
-		for (j=rect.m_left, index=i*LINE_GRID_WIDTH+rect.m_left; j<=rect.m_right; j++, index++)
+		// only what's been written this frame needs clearing
+		left = rect.m_left>g_lineGridLeft[i] ? rect.m_left : g_lineGridLeft[i];
+		right = rect.m_right<g_lineGridRight[i] ? rect.m_right : g_lineGridRight[i];
+		for (j=left, index=i*LINE_GRID_WIDTH+left; j<=right; j++, index++)
+		{
 			g_lineGrid[index] = 0;
+			clearLiveNode(j, i);
+		}
 	}
 }
 
@@ -2399,70 +2578,22 @@ uint32_t compareLines(const Line2 &line0, const Line2 &line1)
 	return da+db;
 }
 
-uint16_t handleLineTracking2()
+// primary lines and lines in the primary intersection are matched first
+bool lineTrackingPriority(const Tracker<Line2> &tracker)
 {
-	uint32_t val, min;
-	uint16_t n=0;
-	SimpleListNode<Tracker<Line2> > *i;
-	SimpleListNode<Line2> *j;
 	uint8_t k;
-	Line2 *minLine;
-	bool priority;
-	
-	// go through list, find best candidates
-	for (i=g_lineTrackersList.m_first; i!=NULL; i=i->m_next)
+
+	if (g_primaryActive && g_primaryLineIndex==tracker.m_index)
+		return true;
+	else if (g_primaryIntersection.m_state!=TR_INVALID)
 	{
-		// calculate priority -- primary lines and lines in the primary intersection
-		priority = false;
-		if (g_primaryActive && g_primaryLineIndex==i->m_object.m_index)
-			priority = true;
-		else if (g_primaryIntersection.m_state!=TR_INVALID)
+		for (k=0; k<g_primaryIntersection.m_object.m_n; k++)
 		{
-			for (k=0; k<g_primaryIntersection.m_object.m_n; k++)
-			{
-				if (g_primaryIntersection.m_object.m_lines[k].m_index==i->m_object.m_index)
-				{
-					priority = true;
-					break;
-				}
-			}
-		}
-		// already found minimum, continue
-		if (i->m_object.m_minVal!=TR_MAXVAL)
-			continue;
-		
-		// find min
-		for (j=g_linesList.m_first, min=TR_MAXVAL, minLine=NULL; j!=NULL; j=j->m_next)
-		{
-			val = compareLines(i->m_object.m_object, j->m_object);
-			if (!priority) 
-				val <<= 12; // we scale up by 4096 because this exceeds pretty much all possible compare values due to geometry
-			// find minimum, but if line is already chosen, make sure we're a better match
-			if (val<min && i->m_object.swappable(val, &j->m_object))
-			{
-				min = val;
-				minLine = &j->m_object;
-			}
-		}
-		if (minLine)
-		{
-			// if this minimum line already has a tracker, see which is better
-			if (minLine->m_tracker)
-			{
-				minLine->m_tracker->resetMin(); // reset tracker pointed to by current minline
-				minLine->m_tracker = &i->m_object; 
-				i->m_object.setMin(minLine, min);
-				n++;
-			}
-			else
-			{
-				minLine->m_tracker = &i->m_object; // update tracker pointer			
-				i->m_object.setMin(minLine, min);
-				n++;
-			}
+			if (g_primaryIntersection.m_object.m_lines[k].m_index==tracker.m_index)
+				return true;
 		}
 	}
-	return n;
+	return false;
 }
 
 
@@ -2470,15 +2601,22 @@ void handleLineTracking()
 {
 	SimpleListNode<Tracker<Line2> > *i, *inext;
 	SimpleListNode<Line2> *j;
-	uint16_t leading, trailing;
+	uint16_t leading, trailing, k;
 	
 	// reset tracking table
 	// Note, we don't need to reset g_linesList entries (e.g. m_tracker) because these are renewed  
 	for (i=g_lineTrackersList.m_first; i!=NULL; i=i->m_next)
 		i->m_object.resetMin();
 	
-	// do search, find minimums
-	while(handleLineTracking2());
+	// match trackers to lines, best matches first
+	g_lineAssociation->begin();
+	for (i=g_lineTrackersList.m_first; i!=NULL; i=i->m_next)
+	{
+		g_lineAssociation->addTracker(&i->m_object, lineTrackingPriority(i->m_object));
+		for (j=g_linesList.m_first, k=0; j!=NULL; j=j->m_next, k++)
+			g_lineAssociation->add(&j->m_object, k, compareLines(i->m_object.m_object, j->m_object));
+	}
+	g_lineAssociation->assign();
 	
 	// go through, update tracker, remove entries that are no longer valid
 	for (i=g_lineTrackersList.m_first; i!=NULL; i=inext)
@@ -3253,8 +3391,12 @@ int line_processMain()
 	g_lineIndex = 1; // set to 1 because 0 means empty...
 	g_lineSegIndex = 0;
 	g_barcodeIndex = 0;
+	// clusterCodes() releases the barcodes, but whatever a frame didn't release comes back here
+	g_barCodePool.reset();
+	g_clusterPool.reset();
 	memset(vstate, 0, LINE_VSIZE);
-	memset(g_lineGrid, 0, LINE_GRID_WIDTH*LINE_GRID_HEIGHT*sizeof(LineGridNode));
+	LINE_PROFILE_MARK(LINE_STAGE_GRID);
+	clearDirtyGrid();
 	
 	
 	if (g_debug==LINE_DEBUG_BENCHMARK)
@@ -3273,6 +3415,7 @@ int line_processMain()
 	setTimer(&timer);
 	for (i=0, row=-1, tlen=0; true; i++)
 	{
+		LINE_PROFILE_MARK(LINE_STAGE_EQUEUE);
 		while((len=g_equeue->readLine(g_lineBuf, LINE_BUFSIZE, &eof, &error))==0)
 		{	
 			if (getTimer(timer)>100000)
@@ -3285,12 +3428,16 @@ int line_processMain()
 		tlen += len;
 		if (g_lineBuf[0]==EQ_HSCAN_LINE_START)
 		{
+			LINE_PROFILE_MARK(LINE_STAGE_HLINE);
 			row++;
 			detectCodes(row, g_lineBuf+1, len-1);
 			line_hLine(row, g_lineBuf+1, len-1);
 		}
 		else if (g_lineBuf[0]==EQ_VSCAN_LINE_START)
+		{
+			LINE_PROFILE_MARK(LINE_STAGE_VLINE);
 			line_vLine(row, vstate, g_lineBuf+1, len-1);
+		}
 
 		if (g_debug&LINE_DEBUG_LAYERS)
 			CRP_SEND_XDATA(g_chirpUsb, HTYPE(FOURCC('E','D','G','S')), UINTS16(len, g_lineBuf), END);
@@ -3308,6 +3455,7 @@ int line_processMain()
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		timers.add(getTimer(timer));
 
+	LINE_PROFILE_MARK(LINE_STAGE_CODES);
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		setTimer(&timer);
 	clusterCodes();
@@ -3325,6 +3473,7 @@ int line_processMain()
 	{
 		cprintf(0, "error\n");
 		g_equeue->flush();
+		LINE_PROFILE_MARK(LINE_STAGES);
 		
 		return -1;
 	}
@@ -3342,6 +3491,7 @@ int line_processMain()
 	if (g_debug&LINE_DEBUG_LAYERS)
 		line_sendLineGrid(0);
 	
+	LINE_PROFILE_MARK(LINE_STAGE_SEGMENTS);
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		setTimer(&timer);
 	extractLineSegments();
@@ -3354,6 +3504,7 @@ int line_processMain()
 		sendPoints(g_nodesList, 0, "nodes");
 	}
 	
+	LINE_PROFILE_MARK(LINE_STAGE_NADIRS);
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		setTimer(&timer);
 	findNadirs();
@@ -3371,6 +3522,7 @@ int line_processMain()
 
 	checkGraph(__LINE__);
 
+	LINE_PROFILE_MARK(LINE_STAGE_INTERSECTIONS);
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		setTimer(&timer);
 	formIntersections();
@@ -3415,6 +3567,7 @@ int line_processMain()
 	if (g_debug&LINE_DEBUG_LAYERS)
 		sendLines(g_linesList, 0, "lines");
 		
+	LINE_PROFILE_MARK(LINE_STAGE_TRACKING);
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 		setTimer(&timer);
 	handleLineTracking();
@@ -3433,6 +3586,7 @@ int line_processMain()
 	g_primaryMutex = true;
 	handleLineState();
 	g_primaryMutex = false;	
+	LINE_PROFILE_MARK(LINE_STAGES);
 	
 	if (g_debug==LINE_DEBUG_BENCHMARK)
 	{
@@ -3570,7 +3724,7 @@ int line_getPrimaryFrame(uint8_t typeMap, uint8_t *buf, uint16_t len)
 int line_getAllFrame(uint8_t typeMap, uint8_t *buf, uint16_t len)
 {
 	uint16_t length = 0;
-	uint8_t plength, *hbuf;
+	uint8_t plength, *hbuf; // each feature section has a one-byte length
 	
 	if (!g_frameFlag || g_allMutex)
 		return -1; // no new data, or busy
@@ -3581,7 +3735,7 @@ int line_getAllFrame(uint8_t typeMap, uint8_t *buf, uint16_t len)
 		Line2 *line;
 		FrameLine *fline;
 		
-		for(n=g_lineTrackersList.m_first, plength=0, hbuf=buf+length; n!=NULL && length<len-sizeof(FrameLine)-2; n=n->m_next)
+		for(n=g_lineTrackersList.m_first, plength=0, hbuf=buf+length; n!=NULL && length<len-sizeof(FrameLine)-2 && plength<=0xff-sizeof(FrameLine); n=n->m_next)
 		{
 			fline = (FrameLine *)(buf + length + 2);
 			line = &n->m_object.m_object;
@@ -3607,7 +3761,7 @@ int line_getAllFrame(uint8_t typeMap, uint8_t *buf, uint16_t len)
 		SimpleListNode<Intersection> *i;
 		FrameIntersection *intersection;
 		
-		for (i=g_intersectionsList.m_first, plength=0, hbuf=buf+length; i!=NULL && length<len-sizeof(FrameIntersection)-2; i=i->m_next)
+		for (i=g_intersectionsList.m_first, plength=0, hbuf=buf+length; i!=NULL && length<len-sizeof(FrameIntersection)-2 && plength<=0xff-sizeof(FrameIntersection); i=i->m_next)
 		{
 			intersection = (FrameIntersection *)(buf + length + 2);
 			formatIntersection(i->m_object, intersection, true); 
@@ -3629,7 +3783,7 @@ int line_getAllFrame(uint8_t typeMap, uint8_t *buf, uint16_t len)
 		FrameCode *barcode;
 		
 		// go through list, find best candidates
-		for (j=g_barCodeTrackersList.m_first, plength=0, hbuf=buf+length; j!=NULL && length<len-sizeof(FrameCode)-2; j=j->m_next)
+		for (j=g_barCodeTrackersList.m_first, plength=0, hbuf=buf+length; j!=NULL && length<len-sizeof(FrameCode)-2 && plength<=0xff-sizeof(FrameCode); j=j->m_next)
 		{
 			dcode = &j->m_object.m_object;
 			barcode = (FrameCode *)(buf + length + 2);
@@ -3771,4 +3925,34 @@ int line_legoLineData(uint8_t *buf, uint32_t buflen)
 	return 4;
 }
 
+template <typename Object> void poolUsage(uint16_t *usage, const SimplePool<Object> &pool)
+{
+	usage[0] = pool.m_size;
+	usage[1] = pool.m_highWater;
+}
+
+// usage gets a size, high-water mark pair for each pool (LINE_POOLS*2 values)
+int line_getPoolUsage(uint16_t *usage)
+{
+	poolUsage(usage+LINE_POOL_LINES*2, g_linesPool);
+	poolUsage(usage+LINE_POOL_NODES*2, g_nodesPool);
+	poolUsage(usage+LINE_POOL_NADIRS*2, g_nadirsPool);
+	poolUsage(usage+LINE_POOL_INTERSECTIONS*2, g_intersectionsPool);
+	poolUsage(usage+LINE_POOL_BARCODES*2, g_barCodePool);
+	poolUsage(usage+LINE_POOL_CLUSTERS*2, g_clusterPool);
+	
+	return LINE_POOLS;
+}
+
+int32_t line_getPoolUsageChirp(Chirp *chirp)
+{
+	uint16_t usage[LINE_POOLS*2];
+	
+	line_getPoolUsage(usage);
+	if (chirp)
+		CRP_RETURN(chirp, UINTS16(LINE_POOLS*2, usage), END);
+	
+	return LINE_POOLS;
+}
+
 
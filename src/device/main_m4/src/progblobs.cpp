@@ -525,6 +525,38 @@ int ProgBlobs::staticPacket(uint8_t type, const uint8_t *data, uint8_t len, bool
 			
 		return 0;
 	}
+	else if (type==TYPE_REQUEST_GETBLOBHISTORY)
+	{
+		if (len==4)
+			blobHistoryAssemble(data[0], data[1], *(uint16_t *)(data+2), checksum);
+		else
+			ser_sendError(SER_ERROR_INVALID_REQUEST, checksum);
+
+		return 0;
+	}
+	else if (type==TYPE_REQUEST_GETPREDICTEDBLOBS)
+	{
+		if (len==3)
+			predictedBlobsAssemble(data[0], data[1], data[2], checksum);
+		else
+			ser_sendError(SER_ERROR_INVALID_REQUEST, checksum);
+
+		return 0;
+	}
+	else if (type==TYPE_REQUEST_SETWINDOWS)
+	{
+		int res = SER_ERROR_INVALID_REQUEST;
+
+		// decimation, number of windows, then a RectA for each
+		if (len>=2 && len==2+data[1]*sizeof(RectA))
+			res = cc_setWindows(data[0], data[1], (const RectA *)(data+2));
+		if (res>=0)
+			ser_sendResult(res, checksum);
+		else
+			ser_sendError(res, checksum);
+
+		return 0;
+	}
 	
 	// nothing rings a bell, return error
 	return -1;
@@ -636,4 +668,48 @@ void ProgBlobs::blobsAssemble(uint8_t sigmap, uint8_t n, bool checksum)
 		ser_setTx(TYPE_RESPONSE_GETBLOBS, res, checksum);
 }
 
+void ProgBlobs::blobHistoryAssemble(uint8_t sigmap, uint8_t n, uint16_t lastFrame, bool checksum)
+{
+	uint8_t *txData;
+	int res;
+	uint32_t len;
+
+	// bogus request
+	if (sigmap==0)
+	{
+		ser_sendError(SER_ERROR_INVALID_REQUEST, checksum);
+		return;
+	}
+
+	len = ser_getTx(&txData);
+
+	res = g_blobs->getBlobHistory(sigmap, n, lastFrame, txData, len);
+
+	if (res<0)
+		ser_sendError(SER_ERROR_BUSY, checksum);
+	else
+		ser_setTx(TYPE_RESPONSE_GETBLOBHISTORY, res, checksum);
+}
+
+void ProgBlobs::predictedBlobsAssemble(uint8_t sigmap, uint8_t n, uint8_t aheadMs, bool checksum)
+{
+	uint8_t *txData;
+	int res;
+	uint32_t len;
+
+	// bogus request
+	if (sigmap==0)
+	{
+		ser_sendError(SER_ERROR_INVALID_REQUEST, checksum);
+		return;
+	}
+
+	len = ser_getTx(&txData);
+
+	res = g_blobs->getPredictedBlobs(sigmap, n, aheadMs, txData, len);
 
+	if (res<0)
+		ser_sendError(SER_ERROR_BUSY, checksum);
+	else
+		ser_setTx(TYPE_RESPONSE_GETPREDICTEDBLOBS, res, checksum);
+}
@@ -95,7 +95,7 @@ void ProgPt::acquire()
 		m_index = blob->m_tracker->m_index;
 }
 	
-BlobA *ProgPt::track()
+Tracker<BlobA> *ProgPt::track()
 {
 	SimpleList<Tracker<BlobA> > *blobsList;
 	SimpleListNode<Tracker<BlobA> > *i;	
@@ -113,7 +113,7 @@ BlobA *ProgPt::track()
 		for (i=blobsList->m_first; i!=NULL; i=i->m_next)
 		{
 			if (i->m_object.m_index==m_index)
-				return &i->m_object.m_object;
+				return &i->m_object;
 		}
 		m_index = -1; // invalidate 
 	}
@@ -125,7 +125,8 @@ int ProgPt::loop(char *status)
 {
 	int32_t panError, tiltError;
 	uint16_t x, y;
-	BlobA *blob;
+	Tracker<BlobA> *tracker;
+	BlobA blob;
 	SimpleList<Tracker<BlobA> > *blobsList;
 
 	if (ProgBlobs::handleButton(status))
@@ -133,12 +134,14 @@ int ProgPt::loop(char *status)
 
 	SM_OBJECT->stream = 0; // don't capture raw frames, so we can double framerate
 
-	blob = track();
+	tracker = track();
 	
-	if (blob)
+	if (tracker)
 	{
-		x = blob->m_left + (blob->m_right - blob->m_left)/2;
-		y = blob->m_top + (blob->m_bottom - blob->m_top)/2;
+		// the frame was captured about a frame period ago, so aim where the blob is now
+		g_blobs->predictBlob(*tracker, BL_PERIOD, &blob);
+		x = blob.m_left + (blob.m_right - blob.m_left)/2;
+		y = blob.m_top + (blob.m_bottom - blob.m_top)/2;
 
 		panError = X_CENTER-x;
 		tiltError = y-Y_CENTER;
@@ -60,6 +60,14 @@ static uint8_t g_txBuf[SER_TXBUF_SIZE];
 static uint8_t *g_tx;
 static uint16_t g_txReadIndex; // current read index
 static uint16_t g_txLen; // current length
+static uint16_t g_txMaxResponse[SER_CLIENTS] = {SER_MAXLEN, SER_MAXLEN}; // largest response each client can take
+static uint8_t g_txClient = SER_CLIENT_SERIAL; // client of the request we're handling
+static uint16_t g_txResponseLen; // length of the whole response (all packets)
+static uint8_t g_txType;
+static bool g_txChecksum;
+static uint8_t g_txFragment; // packet of the response we're sending
+static uint8_t g_txNumFragments;
+static uint16_t g_txCs[SER_MAX_FRAGMENTS];
 static bool g_newPacket = false; 
 static BrightnessQ g_brightnessQ;
 static bool g_ready = false;
@@ -457,6 +465,22 @@ void ser_packet(uint8_t type, const uint8_t *rxData, uint8_t len, bool checksum)
 		uint32_t val = (uint32_t)fps; // convert to int, round up or down
 		ser_sendResult(val, checksum);				
 	}
+	else if (type==SER_TYPE_REQUEST_MAX_RESPONSE) // client can take multi-packet responses
+	{
+		if (len!=2)
+			ser_sendError(SER_ERROR_INVALID_REQUEST, checksum);
+		else
+		{
+			uint16_t &maxResponse = g_txMaxResponse[g_txClient];
+			maxResponse = *(uint16_t *)rxData;
+			if (maxResponse>SER_MAX_RESPONSE)
+				maxResponse = SER_MAX_RESPONSE;
+			else if (maxResponse<SER_MAXLEN)
+				maxResponse = SER_MAXLEN;
+			// return what we agreed to
+			ser_sendResult(maxResponse, checksum);
+		}
+	}
 	else // not able to find handler, return error
 		ser_sendError(SER_ERROR_TYPE_UNSUPPORTED, checksum);		
 }
@@ -464,9 +488,12 @@ void ser_packet(uint8_t type, const uint8_t *rxData, uint8_t len, bool checksum)
 int32_t ser_packetChirp(const uint8_t &type, const uint32_t &len, const uint8_t *request, Chirp *chirp)
 {
 	// handle packet without checksum
+	g_txClient = SER_CLIENT_USB;
 	ser_packet(type, request, len, false);
+	g_txClient = SER_CLIENT_SERIAL;
 	// send result data minus the header data, which we'll bring out explicitly (type, length, no sync)
-	CRP_RETURN(chirp, UINT8(g_tx[2]) /* type */, UINTS8(g_tx[3] /* len */, g_tx+SER_MIN_PACKET_HEADER) /* raw data */, END);
+	// The whole response goes in one chirp message, no matter how many packets it would take.
+	CRP_RETURN(chirp, UINT8(g_txType) /* type */, UINTS8(g_txResponseLen /* len */, g_txBuf+SER_MAX_PACKET_HEADER) /* raw data */, END);
 	
 	// return 0 regardless.  Actual result is returned in the g_tx data.
 	return 0;
@@ -481,12 +508,50 @@ uint32_t txCallback(uint8_t *data, uint32_t len)
 		return g_blobs->getBlock(data, len);
 }
 
+// write the header of the next packet of a multi-packet response.  It goes right in front of the
+// packet's data, on top of the end of the previous packet, which has already been sent.
+static void ser_nextFragment()
+{
+	uint16_t sync, len, offset;
+
+	offset = g_txFragment*SER_MAXLEN;
+	len = g_txResponseLen-offset;
+	if (len>SER_MAXLEN)
+		len = SER_MAXLEN;
+
+	sync = SER_SYNC_BASE;
+	if (g_txFragment==0)
+		sync |= SER_START_FLAG;
+	if (g_txFragment==g_txNumFragments-1)
+		sync |= SER_END_FLAG;
+
+	if (g_txChecksum)
+	{
+		g_tx = g_txBuf + offset;
+		*(uint16_t *)g_tx = sync|SER_CHECKSUM_FLAG;
+		*(uint16_t *)(g_tx+4) = g_txCs[g_txFragment];
+		g_txLen = SER_MAX_PACKET_HEADER + len;
+	}
+	else
+	{
+		g_tx = g_txBuf + SER_PACKET_HEADER_CS_SIZE + offset;
+		*(uint16_t *)g_tx = sync;
+		g_txLen = SER_MIN_PACKET_HEADER + len;
+	}
+	g_tx[2] = g_txType;
+	g_tx[3] = len;
+	g_txReadIndex = 0;
+	g_txFragment++;
+}
+
 // TX data return mechanism for new serial protocol (v3.0--)
 uint8_t ser_getByte(uint8_t *c)
 {
 	if (g_txReadIndex>=g_txLen)
 		return 0;
 	*c = g_tx[g_txReadIndex++];
+	if (g_txReadIndex==g_txLen && g_txFragment<g_txNumFragments)
+		ser_nextFragment();
 	return 1;
 }
 
@@ -591,35 +656,37 @@ void ser_rxCallback()
 
 // These routines (getTx and setTx) are expected to be called from within an ISR, otherwise there will be a race condition between writing to 
 // the tx buffer and the txCallback reading the tx buffer. 
-uint8_t ser_getTx(uint8_t **data)
+uint16_t ser_getTx(uint8_t **data)
 {
 	*data = g_txBuf+SER_MAX_PACKET_HEADER; // make room for header
-	return SER_TXBUF_SIZE-SER_MAX_PACKET_HEADER;
+	return g_txMaxResponse[g_txClient];
 }
 
-void ser_setTx(uint8_t type, uint8_t len, bool checksum)
+void ser_setTx(uint8_t type, uint16_t len, bool checksum)
 {
-	uint8_t i;
-	uint16_t cs;
+	uint16_t i, f, cs;
 	
-	g_txReadIndex = 0;
-	g_txLen = SER_MIN_PACKET_HEADER + len;
+	g_txType = type;
+	g_txResponseLen = len;
+	g_txChecksum = checksum;
+	g_txNumFragments = len ? (len+SER_MAXLEN-1)/SER_MAXLEN : 1;
+	// figure checksums up front, so there's little to do between packets
 	if (checksum)
 	{	
-		g_tx = g_txBuf;
-		*(uint16_t *)g_tx = SER_SYNC_CHECKSUM;
-		for (i=0, cs=0; i<len; i++)
+		for (i=0, f=0, cs=0; i<len; i++)
+		{
 			cs += g_txBuf[SER_MAX_PACKET_HEADER + i];
-		*(uint16_t *)(g_tx+4) = cs;
-		g_txLen += SER_PACKET_HEADER_CS_SIZE;
-	}
-	else
-	{
-		g_tx = g_txBuf + SER_PACKET_HEADER_CS_SIZE;
-		*(uint16_t *)g_tx = SER_SYNC_NO_CHECKSUM;
+			if (i%SER_MAXLEN==SER_MAXLEN-1 || i==len-1)
+			{
+				g_txCs[f++] = cs;
+				cs = 0;
+			}
+		}
+		if (len==0)
+			g_txCs[0] = 0;
 	}
-	g_tx[2] = type;
-	g_tx[3] = len;
+	g_txFragment = 0;
+	ser_nextFragment();
 	g_newPacket = true;
 	g_serial->startTransmit();
 }
@@ -689,6 +756,8 @@ int ser_setInterface(uint8_t interface)
 	g_txReadIndex = 0; 
 	g_txLen = 0; 
 	g_tx = g_txBuf;
+	g_txFragment = g_txNumFragments = 0;
+	g_txMaxResponse[SER_CLIENT_SERIAL] = SER_MAXLEN; // new client needs to ask again, USB's stays
 	g_brightnessQ.m_valid = false;
 
 	switch (interface)
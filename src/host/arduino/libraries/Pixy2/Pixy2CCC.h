@@ -24,6 +24,14 @@
 
 #define CCC_RESPONSE_BLOCKS                 0x21
 #define CCC_REQUEST_BLOCKS                  0x20
+#define CCC_RESPONSE_BLOCK_HISTORY          0x23
+#define CCC_REQUEST_BLOCK_HISTORY           0x22
+#define CCC_RESPONSE_PREDICTED_BLOCKS       0x25
+#define CCC_REQUEST_PREDICTED_BLOCKS        0x24
+#define CCC_REQUEST_SET_WINDOWS             0x26
+
+#define CCC_MAX_WINDOWS                     4
+#define CCC_MAX_DECIMATION                  8
 
 // Defines for sigmap:
 // You can bitwise "or" these together to make a custom sigmap.
@@ -78,6 +86,37 @@ struct Block
   uint8_t m_age;
 };
 
+// Block returned by getPredictedBlocks().  m_x and m_y are where Pixy predicts the block is,
+// from its velocity.
+struct PredictedBlock : Block
+{
+  int16_t m_vx; // pixels per second
+  int16_t m_vy;
+};
+
+// Header of each frame returned by getBlockHistory().  The frame's blocks follow it.
+struct BlockFrame
+{
+  Block *blocks()
+  {
+    return (Block *)(this+1);
+  }
+
+  uint16_t m_frame;      // frame number, increments every frame Pixy processes
+  uint8_t m_numBlocks;
+  uint8_t m_dropped;     // blocks Pixy saw that frame but had no room to keep (255 is 255 or more)
+  uint16_t m_timestamp;  // milliseconds, wraps -- use the difference between frames
+};
+
+// Window passed to setWindows(), in the same coordinates as the blocks
+struct CCCWindow
+{
+  uint16_t m_x;      // left edge
+  uint16_t m_y;      // top edge
+  uint16_t m_width;
+  uint16_t m_height;
+};
+
 template <class LinkType> class TPixy2;
 
 template <class LinkType> class Pixy2CCC
@@ -86,13 +125,43 @@ public:
   Pixy2CCC(TPixy2<LinkType> *pixy)
   {
     m_pixy = pixy;
+    numFrames = 0;
+    moreFrames = false;
+    lastFrame = 0;
+    numPredictedBlocks = 0;
+    predictedBlocks = NULL;
   }
   
   int8_t getBlocks(bool wait=true, uint8_t sigmap=CCC_SIG_ALL, uint8_t maxBlocks=0xff);
+  // Pixy keeps the blocks of the last several frames.  getBlockHistory() returns the frames
+  // that haven't been fetched yet (as many as fit in one response -- moreFrames is set if
+  // there are more), so you can poll at a lower rate without missing frames.  maxBlocks is
+  // per frame.  Look for gaps in m_frame to see if frames were missed.  Returns PIXY_RESULT_BUSY
+  // if Pixy is in the middle of adding a frame, just call again.
+  int8_t getBlockHistory(uint8_t sigmap=CCC_SIG_ALL, uint8_t maxBlocks=0xff);
+  BlockFrame *getHistoryFrame(uint8_t index);
+  // Like getBlocks(), but each block is where Pixy predicts it is aheadMs (up to 100) after the
+  // request, along with its velocity.  The frame Pixy last processed is already most of a frame
+  // old, so steering with predicted blocks cuts that lag.  It never waits -- the blocks are
+  // predicted for when you ask, so asking again before the next frame is fine.
+  int8_t getPredictedBlocks(uint8_t sigmap=CCC_SIG_ALL, uint8_t maxBlocks=0xff, uint8_t aheadMs=0);
+  // Pixy only looks for blocks in the windows (up to CCC_MAX_WINDOWS), and only on every
+  // decimation'th row (1 to CCC_MAX_DECIMATION), which frees up processing time for crowded
+  // scenes.  Blocks that cross a window's edge are cut off at the edge.  No windows is the
+  // whole frame.  The windows last until the program changes.
+  int8_t setWindows(const CCCWindow *windows, uint8_t numWindows, uint8_t decimation=1);
+  int8_t setWindow(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t decimation=1);
   
   uint8_t numBlocks;
   Block *blocks;
 
+  uint8_t numPredictedBlocks;
+  PredictedBlock *predictedBlocks;
+
+  uint8_t numFrames;
+  bool moreFrames;
+  uint16_t lastFrame;
+
 private:
   TPixy2<LinkType> *m_pixy;
 };
@@ -141,4 +210,127 @@ template <class LinkType> int8_t Pixy2CCC<LinkType>::getBlocks(bool wait, uint8_
   }
 }
 
+template <class LinkType> int8_t Pixy2CCC<LinkType>::getBlockHistory(uint8_t sigmap, uint8_t maxBlocks)
+{
+  numFrames = 0;
+  moreFrames = false;
+
+  // fill in request data
+  m_pixy->m_bufPayload[0] = sigmap;
+  m_pixy->m_bufPayload[1] = maxBlocks;
+  *(uint16_t *)(m_pixy->m_bufPayload+2) = lastFrame;
+  m_pixy->m_length = 4;
+  m_pixy->m_type = CCC_REQUEST_BLOCK_HISTORY;
+
+  // send request
+  m_pixy->sendPacket();
+  if (m_pixy->recvPacket()==0)
+  {
+    if (m_pixy->m_type==CCC_RESPONSE_BLOCK_HISTORY)
+    {
+      numFrames = m_pixy->m_buf[0];
+      moreFrames = m_pixy->m_buf[1];
+      if (numFrames)
+        lastFrame = getHistoryFrame(numFrames-1)->m_frame;
+      return numFrames;
+    }
+    // busy means Pixy is in the middle of adding a frame (or changing programs) -- the caller
+    // polls anyway, so it's quicker to let it come back than to wait here
+    else if (m_pixy->m_type==PIXY_TYPE_RESPONSE_ERROR)
+      return m_pixy->m_buf[0];
+  }
+  return PIXY_RESULT_ERROR;  // some kind of bitstream error
+}
+
+template <class LinkType> int8_t Pixy2CCC<LinkType>::getPredictedBlocks(uint8_t sigmap, uint8_t maxBlocks, uint8_t aheadMs)
+{
+  predictedBlocks = NULL;
+  numPredictedBlocks = 0;
+
+  while(1)
+  {
+    // fill in request data
+    m_pixy->m_bufPayload[0] = sigmap;
+    m_pixy->m_bufPayload[1] = maxBlocks;
+    m_pixy->m_bufPayload[2] = aheadMs;
+    m_pixy->m_length = 3;
+    m_pixy->m_type = CCC_REQUEST_PREDICTED_BLOCKS;
+
+    // send request
+    m_pixy->sendPacket();
+    if (m_pixy->recvPacket()==0)
+    {
+      if (m_pixy->m_type==CCC_RESPONSE_PREDICTED_BLOCKS)
+      {
+        predictedBlocks = (PredictedBlock *)m_pixy->m_buf;
+        numPredictedBlocks = m_pixy->m_length/sizeof(PredictedBlock);
+        return numPredictedBlocks;
+      }
+      // busy means Pixy is in the middle of tracking a frame, it won't be long
+      else if (m_pixy->m_type==PIXY_TYPE_RESPONSE_ERROR)
+      {
+        if ((int8_t)m_pixy->m_buf[0]!=PIXY_RESULT_BUSY && (int8_t)m_pixy->m_buf[0]!=PIXY_RESULT_PROG_CHANGING)
+          return m_pixy->m_buf[0];
+      }
+    }
+    else
+      return PIXY_RESULT_ERROR;  // some kind of bitstream error
+
+    delayMicroseconds(500);
+  }
+}
+
+template <class LinkType> int8_t Pixy2CCC<LinkType>::setWindows(const CCCWindow *windows, uint8_t numWindows, uint8_t decimation)
+{
+  uint32_t res;
+
+  if (numWindows>CCC_MAX_WINDOWS)
+    return PIXY_RESULT_ERROR;
+
+  m_pixy->m_bufPayload[0] = decimation;
+  m_pixy->m_bufPayload[1] = numWindows;
+  memcpy(m_pixy->m_bufPayload+2, windows, numWindows*sizeof(CCCWindow));
+  m_pixy->m_length = 2 + numWindows*sizeof(CCCWindow);
+  m_pixy->m_type = CCC_REQUEST_SET_WINDOWS;
+  m_pixy->sendPacket();
+  if (m_pixy->recvPacket()==0)
+  {
+    if (m_pixy->m_type==PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length==4)
+    {
+      res = *(uint32_t *)m_pixy->m_buf;
+      return (int8_t)res;
+    }
+    else if (m_pixy->m_type==PIXY_TYPE_RESPONSE_ERROR)
+      return m_pixy->m_buf[0];
+  }
+  return PIXY_RESULT_ERROR;  // some kind of bitstream error
+}
+
+template <class LinkType> int8_t Pixy2CCC<LinkType>::setWindow(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t decimation)
+{
+  CCCWindow window;
+
+  window.m_x = x;
+  window.m_y = y;
+  window.m_width = width;
+  window.m_height = height;
+
+  return setWindows(&window, 1, decimation);
+}
+
+template <class LinkType> BlockFrame *Pixy2CCC<LinkType>::getHistoryFrame(uint8_t index)
+{
+  uint8_t i;
+  BlockFrame *frame;
+
+  if (index>=numFrames)
+    return NULL;
+
+  // frames are packed back-to-back after the 4-byte response header
+  for (i=0, frame=(BlockFrame *)(m_pixy->m_buf+4); i<index; i++)
+    frame = (BlockFrame *)((uint8_t *)frame->blocks() + frame->m_numBlocks*sizeof(Block));
+
+  return frame;
+}
+
 #endif
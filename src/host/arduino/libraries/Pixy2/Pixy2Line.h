@@ -153,7 +153,8 @@ private:
 template <class LinkType> int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type,  uint8_t features, bool wait)
 {
   int8_t res;
-  uint8_t offset, fsize, ftype, *fdata;
+  uint8_t fsize, ftype, *fdata;
+  uint16_t offset;
   
   vectors = NULL;
   numVectors = 0;
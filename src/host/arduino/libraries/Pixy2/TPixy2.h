@@ -23,9 +23,20 @@
 #define PIXY_DEBUG
 
 #define PIXY_DEFAULT_ARGVAL                  0x80000000
+// Responses longer than 0xff bytes are sent as several packets, but only if we ask
+// for them (see init()).  Define PIXY_BUFFERSIZE larger before including this file 
+// to get them, e.g. 0x604 to get all blocks in one call. 
+#ifndef PIXY_BUFFERSIZE
 #define PIXY_BUFFERSIZE                      0x104
+#endif
 #define PIXY_CHECKSUM_SYNC                   0xc1af
 #define PIXY_NO_CHECKSUM_SYNC                0xc1ae
+#define PIXY_SYNC_MASK                       0xfff8
+#define PIXY_SYNC_BASE                       0xc1a8
+#define PIXY_SYNC_CHECKSUM_FLAG              0x0001
+#define PIXY_SYNC_START_FLAG                 0x0002
+#define PIXY_SYNC_END_FLAG                   0x0004
+#define PIXY_MAX_PACKET                      0xff
 #define PIXY_SEND_HEADER_SIZE                4
 #define PIXY_MAX_PROGNAME                    33
 
@@ -41,6 +52,7 @@
 #define PIXY_TYPE_REQUEST_LED                0x14
 #define PIXY_TYPE_REQUEST_LAMP               0x16
 #define PIXY_TYPE_REQUEST_FPS                0x18
+#define PIXY_TYPE_REQUEST_MAX_RESPONSE       0x1a
 
 #define PIXY_RESULT_OK                       0
 #define PIXY_RESULT_ERROR                    -1
@@ -115,12 +127,14 @@ private:
   int16_t getSync();
   int16_t recvPacket();
   int16_t sendPacket();
+  int8_t setMaxResponse(uint16_t len);
 
   uint8_t *m_buf;
   uint8_t *m_bufPayload;
   uint8_t m_type;
-  uint8_t m_length;
+  uint16_t m_length;
   bool m_cs;
+  uint16_t m_sync;
 };
 
 
@@ -157,6 +171,10 @@ template <class LinkType> int8_t TPixy2<LinkType>::init(uint32_t arg)
     if (getVersion()>=0) // successful version get -> pixy is ready
 	{
       getResolution(); // get resolution so we have it
+      // ask for responses as large as our buffer -- older firmware will return an error, 
+      // which is fine, we just get single packets. 
+      if (PIXY_BUFFERSIZE-PIXY_SEND_HEADER_SIZE>PIXY_MAX_PACKET)
+        setMaxResponse(PIXY_BUFFERSIZE-PIXY_SEND_HEADER_SIZE);
       return PIXY_RESULT_OK;
     }	  
     delayMicroseconds(5000); // delay for sync
@@ -183,14 +201,11 @@ template <class LinkType> int16_t TPixy2<LinkType>::getSync()
       // current byte is most significant byte
       start |= c << 8;
       cprev = c;
-      if (start==PIXY_CHECKSUM_SYNC)
-      {
-        m_cs = true;
-        return PIXY_RESULT_OK;
-      }
-      if (start==PIXY_NO_CHECKSUM_SYNC)
+      // start and end flags can vary (multi-packet responses), but base must match
+      if ((start&PIXY_SYNC_MASK)==PIXY_SYNC_BASE)
       {
-        m_cs = false;
+        m_sync = start;
+        m_cs = start&PIXY_SYNC_CHECKSUM_FLAG;
         return PIXY_RESULT_OK;
       }
     }
@@ -218,48 +233,60 @@ template <class LinkType> int16_t TPixy2<LinkType>::recvPacket()
 {
   uint16_t csCalc, csSerial;
   int16_t res;
+  uint8_t type, len, header[4];
   
-  res = getSync();
-  if (res<0)
-    return res;
-
-  if (m_cs)
+  // A response is one or more packets.  The first packet has the start flag set, 
+  // the last has the end flag set (single packets have both).  
+  for (m_length=0; true; m_length+=len)
   {
-    res = m_link.recv(m_buf, 4);
+    res = getSync();
     if (res<0)
       return res;
-
-    m_type = m_buf[0];
-    m_length = m_buf[1];
-
-    csSerial = *(uint16_t *)&m_buf[2];
-
-    res = m_link.recv(m_buf, m_length, &csCalc);
+    
+    if (m_length==0 && !(m_sync&PIXY_SYNC_START_FLAG))
+      return PIXY_RESULT_ERROR; // we missed the beginning 
+    
+    res = m_link.recv(header, m_cs ? 4 : 2);
     if (res<0)
       return res;
 
-    if (csSerial!=csCalc)
+    type = header[0];
+    len = header[1];
+    if (m_length>0 && type!=m_type)
+      return PIXY_RESULT_ERROR; // not a continuation of the same response
+    m_type = type;
+    if (m_length+len>PIXY_BUFFERSIZE)
+      return PIXY_RESULT_ERROR; 
+
+    if (m_cs)
     {
+      csSerial = *(uint16_t *)&header[2];
+
+      res = m_link.recv(m_buf+m_length, len, &csCalc);
+      if (res<0)
+        return res;
+
+      if (csSerial!=csCalc)
+      {
 #ifdef PIXY_DEBUG
-      Serial.println("error: checksum");
+        Serial.println("error: checksum");
 #endif
-      return PIXY_RESULT_CHECKSUM_ERROR;
+        return PIXY_RESULT_CHECKSUM_ERROR;
+      }
+    }
+    else
+    {   
+      res = m_link.recv(m_buf+m_length, len);
+      if (res<0)
+        return res;
+    }
+    
+    if (m_sync&PIXY_SYNC_END_FLAG)
+    {
+      m_length += len;
+      return PIXY_RESULT_OK;
     }
   }
-  else
-  {   
-    res = m_link.recv(m_buf, 2);
-    if (res<0)
-      return res;
-
-    m_type = m_buf[0];
-    m_length = m_buf[1];
-
-    res = m_link.recv(m_buf, m_length);
-    if (res<0)
-      return res;
-  }
-  return PIXY_RESULT_OK;
 }
 
 
@@ -433,4 +460,21 @@ template <class LinkType> int8_t TPixy2<LinkType>::getFPS()
       return PIXY_RESULT_ERROR;  // some kind of bitstream error	
 }
 
+template <class LinkType> int8_t TPixy2<LinkType>::setMaxResponse(uint16_t len)
+{
+  uint32_t res;
+  
+  *(uint16_t *)m_bufPayload = len;
+  m_length = 2;
+  m_type = PIXY_TYPE_REQUEST_MAX_RESPONSE;
+  sendPacket();
+  if (recvPacket()==0 && m_type==PIXY_TYPE_RESPONSE_RESULT && m_length==4)
+  {
+    res = *(uint32_t *)m_buf;
+    return res>PIXY_MAX_PACKET ? PIXY_RESULT_OK : PIXY_RESULT_ERROR; 
+  }
+  else
+    return PIXY_RESULT_ERROR;  // some kind of bitstream error
+}
+
 #endif
@@ -0,0 +1,467 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Replays a corpus of BA81 frames through the firmware's color connected components pipeline
+// (see ccchost.h) and reports the time per frame of each stage of Blobs::blobify().
+//
+//   ccc_benchmark [-r passes] [-u] [-v] [-k specks] [-b frames] [-w x,y,w,h]... [-d decimation]
+//                 [-s signum,x,y,w,h]... [-c signum,x,y,w,h]... [file...]
+//
+// Files hold raw CAM_RES2_WIDTH x CAM_RES2_HEIGHT BA81 frames back to back, e.g. saved from
+// getRawFrame().  -s teaches a signature and -c a color code signature from a region of the
+// first frame.  With no files, a synthetic corpus is made -- colored disks, a color code and
+// clutter moving over a noisy background -- so the numbers can be compared from build to build.
+// -k sets the number of clutter specks in each synthetic frame; past the default, they take
+// the objects' colors, for a busy scene with every signature active.  -b adds frames to the
+// end of the synthetic corpus with a grid of specks in the first signature's color above a
+// large disk of it, more blobs than a CBlobArena block holds.  -u assembles blobs with
+// CBlobUnionFind instead of a CBlobAssembler per signature.  -v makes the Qvals with rlsLine()
+// instead of the C version of the M0's code.  -w looks for blocks only in a window (up to
+// BL_MAX_WINDOWS of them) and -d only on every nth row, like cc_setWindows().
+// The checksum covers the blocks reported for each frame of the first pass, so it shouldn't
+// change unless the detection results do.  Returns nonzero if any frame fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "ccchost.h"
+
+#define CCC_BENCH_FRAMES        300
+#define CCC_BENCH_PASSES        5
+#define CCC_BENCH_MAX_FILE      (CCC_FRAME_SIZE*10000)
+
+struct SigRegion
+{
+  uint8_t m_signum;
+  uint32_t m_type;
+  RectA m_region;
+};
+
+// a synthetic object.  The right half is colored rgb2, which makes a color code.
+struct SynthObject
+{
+  int16_t m_x, m_y;     // top left in the first frame
+  int16_t m_vx, m_vy;   // 1/16 pixels per frame, bouncing off the edges
+  int16_t m_width, m_height;
+  bool m_disk;
+  uint8_t m_rgb[3];
+  uint8_t m_rgb2[3];
+};
+
+static const SynthObject g_objects[] =
+{
+  {40, 40, 24, 10, 36, 36, true, {200, 45, 40}, {200, 45, 40}},      // red
+  {180, 100, -18, 14, 44, 44, true, {50, 160, 60}, {50, 160, 60}},   // green
+  {110, 140, 30, -20, 28, 28, true, {40, 70, 200}, {40, 70, 200}},   // blue
+  {250, 30, -10, 22, 18, 18, true, {230, 140, 30}, {230, 140, 30}},  // orange
+  {140, 40, 12, 16, 28, 32, false, {190, 40, 170}, {40, 170, 190}},  // magenta/cyan color code
+};
+
+#define SYNTH_OBJECTS           (int)(sizeof(g_objects)/sizeof(g_objects[0]))
+#define SYNTH_CLUTTER           12
+#define SYNTH_BUSY_COLS         12     // grid of specks in the frames added by -b
+#define SYNTH_BUSY_ROWS         5
+
+static uint32_t g_rand;
+static int g_clutter = SYNTH_CLUTTER;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+static void setPixel(uint8_t *frame, int32_t x, int32_t y, const uint8_t rgb[3])
+{
+  int32_t val;
+
+  if (x<0 || x>=CAM_RES2_WIDTH || y<0 || y>=CAM_RES2_HEIGHT)
+    return;
+  // even lines are blue/green, odd lines green/red
+  if (y&1)
+    val = x&1 ? rgb[0] : rgb[1];
+  else
+    val = x&1 ? rgb[1] : rgb[2];
+  val += (int32_t)(random32()&0x0f) - 8;
+  if (val<0)
+    val = 0;
+  else if (val>255)
+    val = 255;
+  frame[y*CAM_RES2_WIDTH + x] = val;
+}
+
+// position along one axis, bouncing between 0 and range
+static int32_t bounce(int32_t start, int32_t v, uint32_t frame, int32_t range)
+{
+  int32_t pos;
+
+  if (range<=0)
+    return 0;
+  range *= 16;
+  pos = (start*16 + v*(int32_t)frame)%(2*range);
+  if (pos<0)
+    pos += 2*range;
+  if (pos>range)
+    pos = 2*range - pos;
+  return pos/16;
+}
+
+static void objectPos(const SynthObject *obj, uint32_t frame, int32_t *x, int32_t *y)
+{
+  *x = bounce(obj->m_x, obj->m_vx, frame, CAM_RES2_WIDTH-obj->m_width);
+  *y = bounce(obj->m_y, obj->m_vy, frame, CAM_RES2_HEIGHT-obj->m_height);
+}
+
+static void synthFrame(uint8_t *frame, uint32_t n)
+{
+  int32_t i, x, y, x0, y0, dx, dy, r, w, h;
+  uint8_t rgb[3];
+  const uint8_t *color;
+  static const uint8_t clutter[3] = {170, 60, 50};
+
+  g_rand = n*2654435761u + 1;
+
+  // background -- a gradient, a little greener than gray
+  for (y=0; y<CAM_RES2_HEIGHT; y++)
+  {
+    for (x=0; x<CAM_RES2_WIDTH; x++)
+    {
+      rgb[0] = rgb[2] = 40 + x*100/CAM_RES2_WIDTH + y*40/CAM_RES2_HEIGHT;
+      rgb[1] = rgb[0] + 6;
+      setPixel(frame, x, y, rgb);
+    }
+  }
+
+  for (i=0; i<SYNTH_OBJECTS; i++)
+  {
+    objectPos(&g_objects[i], n, &x0, &y0);
+    w = g_objects[i].m_width;
+    h = g_objects[i].m_height;
+    r = w/2;
+    for (y=0; y<h; y++)
+    {
+      for (x=0; x<w; x++)
+      {
+        dx = x-r;
+        dy = y-h/2;
+        if (g_objects[i].m_disk && dx*dx + dy*dy>r*r)
+          continue;
+        setPixel(frame, x0+x, y0+y, x<r ? g_objects[i].m_rgb : g_objects[i].m_rgb2);
+      }
+    }
+  }
+
+  // small specks, some big enough to become blocks
+  for (i=0; i<g_clutter; i++)
+  {
+    x0 = random32()%CAM_RES2_WIDTH;
+    y0 = random32()%CAM_RES2_HEIGHT;
+    r = 1 + random32()%4;
+    if (i<SYNTH_CLUTTER)
+      color = clutter;
+    else
+      color = (i&1) ? g_objects[i%SYNTH_OBJECTS].m_rgb2 : g_objects[i%SYNTH_OBJECTS].m_rgb;
+    for (y=-r; y<=r; y++)
+    {
+      for (x=-r; x<=r; x++)
+      {
+        if (x*x + y*y<=r*r)
+          setPixel(frame, x0+x, y0+y, color);
+      }
+    }
+  }
+}
+
+// a synthetic frame with a grid of specks in the first object's color over the top of it and
+// a large disk of the same color moving along the bottom
+static void synthBusyFrame(uint8_t *frame, uint32_t n)
+{
+  int32_t i, x, y, x0, y0, r;
+  const uint8_t *color = g_objects[0].m_rgb;
+
+  synthFrame(frame, n);
+  for (i=0; i<SYNTH_BUSY_COLS*SYNTH_BUSY_ROWS; i++)
+  {
+    x0 = 14 + (i%SYNTH_BUSY_COLS)*26;
+    y0 = 8 + (i/SYNTH_BUSY_COLS)*20;
+    for (y=-7; y<=7; y++)
+    {
+      for (x=-7; x<=7; x++)
+      {
+        if (x*x + y*y<=49)
+          setPixel(frame, x0+x, y0+y, color);
+      }
+    }
+  }
+  r = 28;
+  x0 = 40 + (n%64)*3;
+  y0 = CAM_RES2_HEIGHT - r - 8;
+  for (y=-r; y<=r; y++)
+  {
+    for (x=-r; x<=r; x++)
+    {
+      if (x*x + y*y<=r*r)
+        setPixel(frame, x0+x, y0+y, color);
+    }
+  }
+}
+
+// signatures from the middle of each object in the first frame
+static int synthSigs(SigRegion *sigs)
+{
+  int i, n;
+  int32_t x, y, w, h;
+
+  for (i=0, n=0; i<SYNTH_OBJECTS; i++)
+  {
+    objectPos(&g_objects[i], 0, &x, &y);
+    w = g_objects[i].m_width;
+    h = g_objects[i].m_height;
+    if (g_objects[i].m_disk)
+    {
+      sigs[n].m_signum = n+1;
+      sigs[n].m_type = 0;
+      sigs[n].m_region = RectA(x+w/4, y+h/4, w/2, h/2);
+      n++;
+    }
+    else // color code, one signature for each half
+    {
+      sigs[n].m_signum = n+1;
+      sigs[n].m_type = CL_MODEL_TYPE_COLORCODE;
+      sigs[n].m_region = RectA(x+w/8, y+h/4, w/4, h/2);
+      n++;
+      sigs[n].m_signum = n+1;
+      sigs[n].m_type = CL_MODEL_TYPE_COLORCODE;
+      sigs[n].m_region = RectA(x+w/2+w/8, y+h/4, w/4, h/2);
+      n++;
+    }
+  }
+  return n;
+}
+
+// appends the frames in filename to *frames
+static int loadFrames(const char *filename, uint8_t **frames, uint32_t *numFrames)
+{
+  FILE *file;
+  long len;
+  uint32_t n;
+  uint8_t *mem;
+
+  file = fopen(filename, "rb");
+  if (file==NULL)
+  {
+    printf("can't open %s\n", filename);
+    return -1;
+  }
+  fseek(file, 0, SEEK_END);
+  len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (len<CCC_FRAME_SIZE || len>CCC_BENCH_MAX_FILE)
+  {
+    printf("%s isn't %dx%d BA81 frames\n", filename, CAM_RES2_WIDTH, CAM_RES2_HEIGHT);
+    fclose(file);
+    return -1;
+  }
+  if (len%CCC_FRAME_SIZE)
+    printf("ignoring %ld bytes at the end of %s\n", len%CCC_FRAME_SIZE, filename);
+  n = len/CCC_FRAME_SIZE;
+  mem = (uint8_t *)realloc(*frames, (size_t)(*numFrames + n)*CCC_FRAME_SIZE);
+  if (mem==NULL)
+  {
+    fclose(file);
+    return -1;
+  }
+  *frames = mem;
+  if (fread(mem + (size_t)*numFrames*CCC_FRAME_SIZE, CCC_FRAME_SIZE, n, file)!=n)
+  {
+    printf("error reading %s\n", filename);
+    fclose(file);
+    return -1;
+  }
+  *numFrames += n;
+  fclose(file);
+  return 0;
+}
+
+static int parseSig(const char *arg, uint32_t type, SigRegion *sig)
+{
+  unsigned signum, x, y, w, h;
+
+  if (sscanf(arg, "%u,%u,%u,%u,%u", &signum, &x, &y, &w, &h)!=5 || signum<1 || signum>CL_NUM_SIGNATURES)
+    return -1;
+  sig->m_signum = signum;
+  sig->m_type = type;
+  sig->m_region = RectA(x, y, w, h);
+  return 0;
+}
+
+static int parseWindow(const char *arg, RectA *window)
+{
+  unsigned x, y, w, h;
+
+  if (sscanf(arg, "%u,%u,%u,%u", &x, &y, &w, &h)!=4)
+    return -1;
+  *window = RectA(x, y, w, h);
+  return 0;
+}
+
+static void usage()
+{
+  printf("usage: ccc_benchmark [-r passes] [-u] [-v] [-k specks] [-b frames] [-w x,y,w,h]... [-d decimation]\n"
+    "                     [-s signum,x,y,w,h]... [-c signum,x,y,w,h]... [file...]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  int i, len, pass, passes = CCC_BENCH_PASSES, numSigs = 0, numWindows = 0, decimation = 1, busyFrames = 0;
+  bool unionFind = false, vector = false;
+  uint32_t f, numFrames = 0, errors = 0, blocks = 0, checksum = 2166136261u;
+  uint64_t t0, t1, t2, m0Ns = 0, m4Ns = 0;
+  uint8_t *frames = NULL;
+  uint8_t blockBuf[MAX_BLOBS*sizeof(BlobC)];
+  SigRegion sigs[CL_NUM_SIGNATURES];
+  RectA windows[BL_MAX_WINDOWS];
+  CccHost *host;
+  static const char *stageNames[BL_STAGES] = {"rls", "assembly", "combine", "cc", "tracking"};
+
+  for (i=1; i<argc; i++)
+  {
+    if (strcmp(argv[i], "-r")==0 && i+1<argc)
+      passes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-k")==0 && i+1<argc)
+      g_clutter = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-b")==0 && i+1<argc)
+      busyFrames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-u")==0)
+      unionFind = true;
+    else if (strcmp(argv[i], "-v")==0)
+      vector = true;
+    else if (strcmp(argv[i], "-d")==0 && i+1<argc)
+      decimation = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-w")==0 && i+1<argc && numWindows<BL_MAX_WINDOWS)
+    {
+      if (parseWindow(argv[++i], &windows[numWindows++])<0)
+      {
+        usage();
+        return 1;
+      }
+    }
+    else if ((strcmp(argv[i], "-s")==0 || strcmp(argv[i], "-c")==0) && i+1<argc && numSigs<CL_NUM_SIGNATURES)
+    {
+      if (parseSig(argv[i+1], argv[i][1]=='c' ? CL_MODEL_TYPE_COLORCODE : 0, &sigs[numSigs++])<0)
+      {
+        usage();
+        return 1;
+      }
+      i++;
+    }
+    else if (argv[i][0]=='-')
+    {
+      usage();
+      return 1;
+    }
+    else if (loadFrames(argv[i], &frames, &numFrames)<0)
+      return 1;
+  }
+  if (passes<1)
+    passes = 1;
+
+  if (numFrames==0)
+  {
+    if (busyFrames<0)
+      busyFrames = 0;
+    numFrames = CCC_BENCH_FRAMES + busyFrames;
+    frames = (uint8_t *)malloc((size_t)numFrames*CCC_FRAME_SIZE);
+    if (frames==NULL)
+      return 1;
+    for (f=0; f<numFrames; f++)
+    {
+      if (f<CCC_BENCH_FRAMES)
+        synthFrame(frames + (size_t)f*CCC_FRAME_SIZE, f);
+      else
+        synthBusyFrame(frames + (size_t)f*CCC_FRAME_SIZE, f);
+    }
+    if (numSigs==0)
+      numSigs = synthSigs(sigs);
+  }
+  if (numSigs==0)
+  {
+    printf("no signatures -- use -s or -c\n");
+    free(frames);
+    return 1;
+  }
+
+  host = new (std::nothrow) CccHost;
+  for (i=0; i<numSigs; i++)
+  {
+    if (host->setSignature(sigs[i].m_signum, frames, sigs[i].m_region, sigs[i].m_type)<0)
+    {
+      printf("bad region for signature %d\n", sigs[i].m_signum);
+      errors++;
+    }
+  }
+  host->generateLUT();
+  if (unionFind)
+    host->m_blobs->setBlobAssembly(UNION_FIND);
+  host->m_vectorRLS = vector;
+  if ((numWindows || decimation!=1) && host->setWindows(windows, numWindows, decimation)<0)
+  {
+    printf("bad windows or decimation\n");
+    errors++;
+  }
+
+  blobsProfileReset();
+  for (pass=0; pass<passes; pass++)
+  {
+    host->m_blobs->reset();
+    for (f=0; f<numFrames; f++)
+    {
+      t0 = hostTimeNs();
+      if (host->produce(frames + (size_t)f*CCC_FRAME_SIZE)<0)
+        errors++;
+      t1 = hostTimeNs();
+      if (host->process()<0)
+        errors++;
+      t2 = hostTimeNs();
+      m0Ns += t1-t0;
+      m4Ns += t2-t1;
+
+      len = host->m_blobs->getBlobs(0xff, 0xff, blockBuf, sizeof(blockBuf));
+      if (pass==0 && len>0)
+      {
+        blocks += len/sizeof(BlobC);
+        // FNV-1a
+        for (i=0; i<len; i++)
+          checksum = (checksum^blockBuf[i])*16777619u;
+      }
+    }
+  }
+  delete host;
+  free(frames);
+
+  printf("%u frames x %d passes, %.1f blocks/frame, checksum %08x\n", numFrames, passes,
+         (double)blocks/numFrames, checksum);
+  printf("%-24s %9.1f us/frame\n", vector ? "rls (rlsLine)" : "rls (M0, emulated)", m0Ns/1e3/numFrames/passes);
+  for (i=0; i<BL_STAGES; i++)
+    printf("%-24s %9.1f us/frame\n", stageNames[i], g_blobsProfileNs[i]/1e3/numFrames/passes);
+  printf("%-24s %9.1f us/frame %9.0f frames/s\n", "blobify", m4Ns/1e3/numFrames/passes,
+         1e9*numFrames*passes/m4Ns);
+  if (errors)
+    printf("%u errors\n", errors);
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "misc.h"
+#include "ccchost.h"
+#include "rls_host.h"
+
+uint64_t g_blobsProfileNs[BL_STAGES];
+static uint8_t g_profileStage = BL_STAGES;
+static uint64_t g_profileStart;
+
+
+// time from one mark to the next goes to the stage of the first
+void blobsProfileMark(uint8_t stage)
+{
+  uint64_t now = hostTimeNs();
+
+  if (g_profileStage<BL_STAGES)
+    g_blobsProfileNs[g_profileStage] += now - g_profileStart;
+  g_profileStage = stage;
+  g_profileStart = now;
+}
+
+void blobsProfileReset()
+{
+  memset(g_blobsProfileNs, 0, sizeof(g_blobsProfileNs));
+  g_profileStage = BL_STAGES;
+}
+
+
+CccHost::CccHost()
+{
+  m_lut = new (std::nothrow) uint8_t[CL_LUT_SIZE];
+  m_qq = new (std::nothrow) Qqueue;
+  m_blobs = new (std::nothrow) Blobs(m_qq, m_lut);
+  m_vectorRLS = false;
+  // same as the firmware's parameter defaults
+  m_blobs->m_clut.setMinBrightness(0.2f);
+  m_blobs->setColorCodeMode(ENABLED);
+}
+
+CccHost::~CccHost()
+{
+  delete m_blobs;
+  delete m_qq;
+  delete [] m_lut;
+}
+
+int CccHost::setSignature(uint8_t signum, const uint8_t *frame, const RectA &region, uint32_t type)
+{
+  Frame8 frame8((uint8_t *)frame, CAM_RES2_WIDTH, CAM_RES2_HEIGHT);
+  ColorSignature *sig;
+
+  if (region.m_width<2 || region.m_height<2 || region.m_xOffset+region.m_width>CAM_RES2_WIDTH ||
+      region.m_yOffset+region.m_height>CAM_RES2_HEIGHT)
+    return -1;
+  if (m_blobs->m_clut.generateSignature(frame8, region, signum)<0)
+    return -1;
+  sig = m_blobs->m_clut.getSignature(signum);
+  sig->m_type = type;
+
+  IterPixel ip(frame8, region);
+  sig->m_rgb = ip.averageRgb();
+  return 0;
+}
+
+void CccHost::generateLUT()
+{
+  m_blobs->m_clut.generateLUT();
+}
+
+int CccHost::produce(const uint8_t *frame)
+{
+  if (m_vectorRLS)
+    return getRLSFrameHostVector(frame, m_lut);
+  return getRLSFrameHost(frame, m_lut);
+}
+
+int CccHost::process()
+{
+  int res;
+
+  res = m_blobs->blobify();
+  hostAdvanceTimer(BL_PERIOD);
+  return res;
+}
+
+int CccHost::setWindows(const RectA *windows, uint8_t numWindows, uint8_t decimation)
+{
+  uint16_t top, bottom;
+
+  if (m_blobs->setWindows(windows, numWindows, decimation)<0)
+    return -1;
+  m_blobs->getRowWindow(&top, &bottom, &decimation);
+  return setRLSWindowHost(top, bottom, decimation);
+}
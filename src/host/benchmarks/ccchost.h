@@ -0,0 +1,61 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Runs the firmware's color connected components pipeline (ColorLUT, Qqueue, Blobs,
+// CBlobAssembler from common/src) on the host, fed by recorded BA81 frames instead of the
+// camera.  getRLSFrameHost() does the M0's part and fills the Qqueue with a whole frame, then
+// Blobs::blobify() runs unchanged.  Link with libccchost.a.
+
+#ifndef _CCCHOST_H
+#define _CCCHOST_H
+
+#include <stdint.h>
+#include "blobs.h"
+#include "cameravals.h"
+#include "pixyhost.h"
+
+#define CCC_FRAME_SIZE    (CAM_RES2_WIDTH*CAM_RES2_HEIGHT)
+
+class CccHost
+{
+public:
+  CccHost();
+  ~CccHost();
+
+  // teach signature signum (1-7) from a region of a frame, like cc_setSigRegion().  type is
+  // CL_MODEL_TYPE_COLORCODE for color code signatures.  Call generateLUT() when done.
+  int setSignature(uint8_t signum, const uint8_t *frame, const RectA &region, uint32_t type=0);
+  void generateLUT();
+
+  // queue the Qvals for frame (the M0's part)
+  int produce(const uint8_t *frame);
+  // blobify the queued frame, then move the clock ahead one frame period
+  int process();
+  // like cc_setWindows() -- Blobs gets the windows and the M0's part gets the rows they cover
+  int setWindows(const RectA *windows, uint8_t numWindows, uint8_t decimation);
+
+  Blobs *m_blobs;
+  Qqueue *m_qq;
+  // produce() with rlsLine() instead of the C version of the M0's code
+  bool m_vectorRLS;
+
+private:
+  uint8_t *m_lut;
+};
+
+// time spent in each stage of blobify() (BL_STAGE_*), accumulated until reset
+extern uint64_t g_blobsProfileNs[BL_STAGES];
+void blobsProfileReset();
+
+#endif
@@ -0,0 +1,332 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Runs a server Chirp and a client Chirp in two threads over a LoopChannel and reports call
+// rate, array throughput in both directions, and what bit errors cost on a stream link where
+// Chirp does its own crc/nak/retry.  Takes the number of seconds per test (default 1).
+// Returns nonzero if any call on an error-free link fails or returns bad data.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <new>
+#include "chirp.hpp"
+#include "looplink.h"
+
+#define CHIRP_BENCH_MAXLEN     0x40000
+#define CHIRP_BENCH_STREAM_LEN 0x1000
+
+class BenchChirp : public Chirp
+{
+public:
+  BenchChirp(bool client, Link *link) : Chirp(false, client, link)
+  {
+  }
+
+  // after a failed call the client considers itself disconnected
+  int reconnect()
+  {
+    return remoteInit(true);
+  }
+};
+
+struct BenchResult
+{
+  uint32_t calls;
+  uint32_t failed;
+  uint32_t bad;
+  double bytes;
+  double seconds;
+};
+
+typedef void (*BenchFunc)(BenchChirp *client, uint32_t len, double seconds, BenchResult *result);
+
+static uint8_t *g_data;
+static bool g_quit;
+static ChirpProc g_nop, g_source, g_sink;
+
+static uint32_t nop(Chirp *chirp)
+{
+  return 0;
+}
+
+static uint32_t source(const uint32_t &len, Chirp *chirp)
+{
+  CRP_RETURN(chirp, UINTS8(len, g_data), END);
+  return len;
+}
+
+static uint32_t sink(const uint32_t &len, const uint8_t *data, Chirp *chirp)
+{
+  // return a checksum so the client can tell if the data got through intact
+  return Chirp::calcCrc((uint8_t *)data, len);
+}
+
+static void *serverThread(void *arg)
+{
+  BenchChirp *server = (BenchChirp *)arg;
+
+  while (!g_quit)
+    server->service(false);
+
+  return NULL;
+}
+
+static double elapsed(uint64_t start)
+{
+  return (loopTimeUs()-start)*1e-6;
+}
+
+static void fail(BenchChirp *client, BenchResult *result)
+{
+  result->failed++;
+  client->reconnect();
+}
+
+static void benchCalls(BenchChirp *client, uint32_t len, double seconds, BenchResult *result)
+{
+  int32_t response;
+  uint64_t start = loopTimeUs();
+
+  while ((result->seconds=elapsed(start))<seconds)
+  {
+    if (client->callSync(g_nop, END_OUT_ARGS, &response, END_IN_ARGS)<0)
+      fail(client, result);
+    else
+      result->calls++;
+  }
+}
+
+// waitUs lets all the responses queue up on the link before the first one is collected
+static void pipeline(BenchChirp *client, uint32_t waitUs, double seconds, BenchResult *result)
+{
+  int i, n, tags[CRP_PIPELINE_DEPTH];
+  int32_t response;
+  uint64_t start = loopTimeUs();
+
+  while ((result->seconds=elapsed(start))<seconds)
+  {
+    for (n=0; n<CRP_PIPELINE_DEPTH; n++)
+    {
+      if ((tags[n]=client->callIssue(g_nop, END_OUT_ARGS))<0)
+        break;
+    }
+    if (waitUs)
+      usleep(waitUs);
+    for (i=0; i<n; i++)
+    {
+      if (client->callCollect(tags[i], &response, END_IN_ARGS)<0)
+        result->failed++;
+      else
+        result->calls++;
+    }
+    if (n<CRP_PIPELINE_DEPTH)
+      fail(client, result);
+  }
+}
+
+static void benchPipelined(BenchChirp *client, uint32_t len, double seconds, BenchResult *result)
+{
+  pipeline(client, 0, seconds, result);
+}
+
+static void benchQueued(BenchChirp *client, uint32_t len, double seconds, BenchResult *result)
+{
+  pipeline(client, 1000, seconds, result);
+}
+
+static void benchSource(BenchChirp *client, uint32_t len, double seconds, BenchResult *result)
+{
+  int32_t response;
+  uint32_t rlen;
+  uint8_t *data;
+  uint64_t start = loopTimeUs();
+
+  while ((result->seconds=elapsed(start))<seconds)
+  {
+    if (client->callSync(g_source, UINT32(len), END_OUT_ARGS, &response, &rlen, &data, END_IN_ARGS)<0)
+      fail(client, result);
+    else
+    {
+      if (rlen!=len || memcmp(data, g_data, len))
+        result->bad++;
+      result->calls++;
+      result->bytes += len;
+    }
+  }
+}
+
+static void benchSink(BenchChirp *client, uint32_t len, double seconds, BenchResult *result)
+{
+  int32_t response;
+  uint16_t crc = Chirp::calcCrc(g_data, len);
+  uint64_t start = loopTimeUs();
+
+  while ((result->seconds=elapsed(start))<seconds)
+  {
+    if (client->callSync(g_sink, UINTS8(len, g_data), END_OUT_ARGS, &response, END_IN_ARGS)<0)
+      fail(client, result);
+    else
+    {
+      if ((uint16_t)response!=crc)
+        result->bad++;
+      result->calls++;
+      result->bytes += len;
+    }
+  }
+}
+
+// queue a transfer that ends on a short block (a full block plus 10 bytes) and a second short one,
+// then read with room for both -- each read has to stop at the end of one transfer
+static uint32_t shortTransfers(const char *name, const LoopLinkConfig *config)
+{
+  LoopChannel channel(config);
+  uint8_t buf[0x100];
+  int first, second;
+  uint32_t len = config->m_blockSize+10;
+
+  channel.m_server.send(g_data, config->m_blockSize, 0);
+  channel.m_server.send(g_data+config->m_blockSize, 10, 0);
+  channel.m_server.send(g_data+len, 20, 0);
+  usleep(1000);
+  first = channel.m_client.receive(buf, sizeof(buf), 100);
+  second = channel.m_client.receive(buf+len, sizeof(buf)-len, 100);
+  channel.close();
+
+  if (first==(int)len && second==20 && memcmp(buf, g_data, len+20)==0)
+  {
+    printf("%-40s ok\n", name);
+    return 0;
+  }
+  printf("%-40s received %d then %d bytes, expected %u then 20\n", name, first, second, len);
+  return 1;
+}
+
+// returns the number of bad or failed calls
+static uint32_t run(const char *name, const LoopLinkConfig *config, BenchFunc func, uint32_t len, double seconds)
+{
+  LoopChannel channel(config);
+  BenchChirp *server, *client;
+  BenchResult result;
+  pthread_t thread;
+
+  memset(&result, 0, sizeof(result));
+  g_quit = false;
+  server = new (std::nothrow) BenchChirp(false, &channel.m_server);
+  server->setProc("nop", (ProcPtr)nop);
+  server->setProc("source", (ProcPtr)source);
+  server->setProc("sink", (ProcPtr)sink);
+  pthread_create(&thread, NULL, serverThread, server);
+
+  client = new (std::nothrow) BenchChirp(true, &channel.m_client);
+  if (!client->connected())
+  {
+    printf("%-40s connect failed\n", name);
+    result.failed = 1;
+  }
+  else
+  {
+    g_nop = client->getProc("nop");
+    g_source = client->getProc("source");
+    g_sink = client->getProc("sink");
+    (*func)(client, len, seconds, &result);
+  }
+
+  // stop the server first, so the client's disconnect doesn't wait on it
+  g_quit = true;
+  channel.close();
+  pthread_join(thread, NULL);
+  delete client;
+  delete server;
+
+  printf("%-40s %9.0f calls/s %9.2f MB/s", name, result.calls/result.seconds, result.bytes/result.seconds/1e6);
+  if (config->m_bitErrorRate>0.0)
+    printf(" %6u flipped %5u failed %3u bad", channel.m_toServer.m_bitErrors+channel.m_toClient.m_bitErrors,
+           result.failed, result.bad);
+  else if (result.failed || result.bad)
+    printf(" %u failed %u bad", result.failed, result.bad);
+  printf("\n");
+
+  return result.failed+result.bad;
+}
+
+int main(int argc, char *argv[])
+{
+  int i, j;
+  uint32_t errors = 0;
+  double seconds = 1.0;
+  char name[64];
+  LoopLinkConfig ideal, usb, usbAsync, stream;
+  static const uint32_t lens[] = {0x100, 0x1000, 0x10000, CHIRP_BENCH_MAXLEN};
+  static const uint32_t blockSizes[] = {16, 64, 256, 1024};
+  static const double bers[] = {0.0, 1e-6, 1e-5, 1e-4};
+
+  if (argc>1)
+    seconds = atof(argv[1]);
+  g_data = (uint8_t *)malloc(CHIRP_BENCH_MAXLEN);
+  if (g_data==NULL)
+    return 1;
+  srand(1);
+  for (i=0; i<CHIRP_BENCH_MAXLEN; i++)
+    g_data[i] = rand();
+
+  // roughly what we see over USB 2.0 bulk transfers
+  usb.m_latencyUs = 125;
+  usb.m_bandwidth = 40000000;
+  // USBLink's async mode -- queued responses are short transfers, and each read has to stop at
+  // the end of one
+  usbAsync = usb;
+  usbAsync.m_coalesce = true;
+
+  errors += run("calls ideal", &ideal, benchCalls, 0, seconds);
+  errors += run("calls usb", &usb, benchCalls, 0, seconds);
+  errors += run("pipelined calls ideal", &ideal, benchPipelined, 0, seconds);
+  errors += run("pipelined calls usb", &usb, benchPipelined, 0, seconds);
+  errors += shortTransfers("short transfers usb async", &usbAsync);
+  errors += run("pipelined calls usb async", &usbAsync, benchPipelined, 0, seconds);
+  errors += run("queued calls usb async", &usbAsync, benchQueued, 0, seconds);
+
+  for (i=0; i<(int)(sizeof(lens)/sizeof(lens[0])); i++)
+  {
+    sprintf(name, "source %u ideal", lens[i]);
+    errors += run(name, &ideal, benchSource, lens[i], seconds);
+    sprintf(name, "source %u usb", lens[i]);
+    errors += run(name, &usb, benchSource, lens[i], seconds);
+    sprintf(name, "sink %u ideal", lens[i]);
+    errors += run(name, &ideal, benchSink, lens[i], seconds);
+    sprintf(name, "sink %u usb", lens[i]);
+    errors += run(name, &usb, benchSink, lens[i], seconds);
+  }
+
+  // stream link -- chirp sends blocks with crc and sequence, and the receiver acks or naks each one
+  stream.m_errorCorrected = false;
+  for (i=0; i<(int)(sizeof(blockSizes)/sizeof(blockSizes[0])); i++)
+  {
+    for (j=0; j<(int)(sizeof(bers)/sizeof(bers[0])); j++)
+    {
+      stream.m_blockSize = blockSizes[i];
+      stream.m_bitErrorRate = bers[j];
+      sprintf(name, "sink %u stream blk=%u ber=%g", CHIRP_BENCH_STREAM_LEN, blockSizes[i], bers[j]);
+      if (bers[j]>0.0)
+        run(name, &stream, benchSink, CHIRP_BENCH_STREAM_LEN, seconds);
+      else
+        errors += run(name, &stream, benchSink, CHIRP_BENCH_STREAM_LEN, seconds);
+    }
+  }
+
+  free(g_data);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Checks ColorLUT::inBounds(), which Blobs::runlengthAnalysis() uses to test each Qval against
+// its signature, against the divide-and-compare it replaced, then times the two.  Then does the
+// same for ColorLUT::generateLUT(), whole and one signature at a time.
+//
+//   classify_benchmark [-n qvals] [-l luts] [-r passes]
+//
+// The check covers every u with |u|<=CLB_EXHAUSTIVE_U at every brightness up to CLB_MAX_Y,
+// then -n random Qvals over the full 16-bit ranges, for a set of signatures that includes
+// empty, inverted and out of range bounds.  Any mismatch is printed and the return is nonzero.
+// The timing uses Qvals shaped like the ones the M0 sends (3 columns of 8-bit pixels).
+// For the LUT, each of -l random sets of signatures (some empty, most overlapping) and minimum
+// brightnesses is generated whole, then one signature of it is changed and generated alone,
+// and both LUTs are compared with the one the old divide-per-sample loop makes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "colorlut.h"
+
+#define CLB_QVALS               10000000
+#define CLB_PASSES              5
+#define CLB_EXHAUSTIVE_U        800
+#define CLB_MAX_Y               1600
+#define CLB_STREAM              (1<<16)
+#define CLB_LUTS                100
+
+struct SigBounds
+{
+  int32_t m_uMin, m_uMax, m_vMin, m_vMax;
+};
+
+// signature bounds are (u<<CL_LUT_ENTRY_SCALE)/y, mostly within +-1<<15
+static const SigBounds g_sigs[] =
+{
+  {0, 0, 0, 0},                                     // cleared
+  {-4000, 9000, -12000, -2500},                     // typical
+  {1, 2, -2, -1},                                   // narrow, around 0
+  {-1, 1, -1, 1},
+  {9000, -4000, 0, 100},                            // inverted
+  {-40000, 40000, -40000, 40000},                   // everything
+  {-2000000000, 2000000000, -1073741824, 1073741824},  // past the range of u/y
+  {1073741000, 2000000000, -2000000000, -1073741000},
+};
+
+#define CLB_SIGS                (int)(sizeof(g_sigs)/sizeof(g_sigs[0]))
+
+static uint32_t g_rand = 0x9e3779b9;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+static uint64_t nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+// what Blobs::runlengthAnalysis() did before, minus the brightness test
+static bool divideBounds(const RuntimeSignature &sig, int32_t u, int32_t v, int32_t y)
+{
+  u <<= CL_LUT_ENTRY_SCALE;
+  v <<= CL_LUT_ENTRY_SCALE;
+  u /= y;
+  v /= y;
+  return sig.m_uMin<u && u<sig.m_uMax && sig.m_vMin<v && v<sig.m_vMax;
+}
+
+static void setSig(ColorLUT *clut, const SigBounds &bounds)
+{
+  ColorSignature sig;
+
+  sig.m_uMin = bounds.m_uMin;
+  sig.m_uMax = bounds.m_uMax;
+  sig.m_vMin = bounds.m_vMin;
+  sig.m_vMax = bounds.m_vMax;
+  clut->setSigRange(1, 1.0f);
+  clut->setSignature(1, sig);
+}
+
+static uint32_t check(const RuntimeSignature &sig, int32_t u, int32_t v, int32_t y)
+{
+  if (ColorLUT::inBounds(sig, u, v, y)==divideBounds(sig, u, v, y))
+    return 0;
+  printf("mismatch: bounds u %d,%d v %d,%d, qval u %d v %d y %d\n", sig.m_uMin, sig.m_uMax,
+    sig.m_vMin, sig.m_vMax, u, v, y);
+  return 1;
+}
+
+// what ColorLUT::generateLUT() did before
+static void divideLUT(ColorLUT *clut, uint8_t *lut)
+{
+  int32_t r, g, b, u, v, y, bin, sig;
+
+  memset(lut, 0, CL_LUT_SIZE);
+  for (r=0; r<1<<8; r+=1<<(8-CL_LUT_COMPONENT_SCALE))
+    for (g=0; g<1<<8; g+=1<<(8-CL_LUT_COMPONENT_SCALE))
+      for (b=0; b<1<<8; b+=1<<(8-CL_LUT_COMPONENT_SCALE))
+      {
+        y = r+g+b;
+        if (y<(int32_t)clut->m_miny)
+          continue;
+        u = ((r-g)<<CL_LUT_ENTRY_SCALE)/y;
+        v = ((b-g)<<CL_LUT_ENTRY_SCALE)/y;
+        for (sig=0; sig<CL_NUM_SIGNATURES; sig++)
+        {
+          if (clut->m_signatures[sig].m_uMin==0 && clut->m_signatures[sig].m_uMax==0)
+            continue;
+          if (clut->m_runtimeSigs[sig].m_uMin<u && u<clut->m_runtimeSigs[sig].m_uMax &&
+            clut->m_runtimeSigs[sig].m_vMin<v && v<clut->m_runtimeSigs[sig].m_vMax)
+          {
+            bin = ((((r-g)>>(9-CL_LUT_COMPONENT_SCALE))&((1<<CL_LUT_COMPONENT_SCALE)-1))<<CL_LUT_COMPONENT_SCALE) |
+              (((b-g)>>(9-CL_LUT_COMPONENT_SCALE))&((1<<CL_LUT_COMPONENT_SCALE)-1));
+            if (lut[bin]==0 || lut[bin]>sig+1)
+              lut[bin] = sig+1;
+          }
+        }
+      }
+}
+
+// a signature around a random color, or an empty one now and then
+static void randomSig(ColorLUT *clut, uint8_t signum)
+{
+  ColorSignature sig;
+
+  if (random32()%5)
+  {
+    sig.m_uMean = (int32_t)(random32()%30000) - 15000;
+    sig.m_vMean = (int32_t)(random32()%30000) - 15000;
+    sig.m_uMin = sig.m_uMean - (int32_t)(random32()%5000) - 1;
+    sig.m_uMax = sig.m_uMean + (int32_t)(random32()%5000) + 1;
+    sig.m_vMin = sig.m_vMean - (int32_t)(random32()%5000) - 1;
+    sig.m_vMax = sig.m_vMean + (int32_t)(random32()%5000) + 1;
+  }
+  clut->setSigRange(signum, 0.5f + (random32()%60)/10.0f);
+  clut->setSignature(signum, sig);
+}
+
+static uint32_t checkLUT(const uint8_t *lut, const uint8_t *ref, const char *desc)
+{
+  if (memcmp(lut, ref, CL_LUT_SIZE)==0)
+    return 0;
+  printf("LUT mismatch (%s)\n", desc);
+  return 1;
+}
+
+static void usage()
+{
+  printf("usage: classify_benchmark [-n qvals] [-l luts] [-r passes]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  static uint8_t lut[CL_LUT_SIZE];
+  ColorLUT clut(lut);
+  const RuntimeSignature &rsig = clut.m_runtimeSigs[0];
+  static uint8_t ref[CL_LUT_SIZE];
+  uint32_t n=CLB_QVALS, luts=CLB_LUTS, passes=CLB_PASSES, i, pass, errors=0, in, divIn, checked=0;
+  int32_t s, u, v, y, *stream;
+  uint8_t signum;
+  uint64_t t, divNs=0, mulNs=0, fullNs=0, sigNs=0;
+
+  for (s=1; s<argc; s++)
+  {
+    if (strcmp(argv[s], "-n")==0 && s+1<argc)
+      n = strtoul(argv[++s], NULL, 0);
+    else if (strcmp(argv[s], "-l")==0 && s+1<argc)
+      luts = strtoul(argv[++s], NULL, 0);
+    else if (strcmp(argv[s], "-r")==0 && s+1<argc)
+      passes = strtoul(argv[++s], NULL, 0);
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  for (s=0; s<CLB_SIGS; s++)
+  {
+    setSig(&clut, g_sigs[s]);
+    // v in the middle of the v bounds, so u decides
+    v = (int32_t)(((int64_t)g_sigs[s].m_vMin + g_sigs[s].m_vMax)/2>>CL_LUT_ENTRY_SCALE);
+    if (v<-0x8000)
+      v = -0x8000;
+    else if (v>0x7fff)
+      v = 0x7fff;
+    for (y=1; y<=CLB_MAX_Y; y++)
+      for (u=-CLB_EXHAUSTIVE_U; u<=CLB_EXHAUSTIVE_U; u++, checked++)
+        errors += check(rsig, u, v, y);
+    for (i=0; i<n; i++, checked++)
+    {
+      u = (int16_t)random32();
+      v = (int16_t)random32();
+      y = (random32()&0xffff) | 1;
+      errors += check(rsig, u, v, y);
+    }
+  }
+  printf("%u qvals checked, %u mismatches\n", checked, errors);
+
+  // time both on a typical signature
+  stream = new int32_t[CLB_STREAM*3];
+  for (i=0; i<CLB_STREAM; i++)
+  {
+    stream[i*3] = (int32_t)(random32()%(3*511)) - 3*255;
+    stream[i*3+1] = (int32_t)(random32()%(3*511)) - 3*255;
+    stream[i*3+2] = random32()%(6*255) + 1;
+  }
+  setSig(&clut, g_sigs[1]);
+  for (pass=0, in=divIn=0; pass<passes; pass++)
+  {
+    t = nowNs();
+    for (i=0; i<CLB_STREAM; i++)
+      divIn += divideBounds(rsig, stream[i*3], stream[i*3+1], stream[i*3+2]);
+    divNs += nowNs() - t;
+    t = nowNs();
+    for (i=0; i<CLB_STREAM; i++)
+      in += ColorLUT::inBounds(rsig, stream[i*3], stream[i*3+1], stream[i*3+2]);
+    mulNs += nowNs() - t;
+  }
+  delete [] stream;
+  if (in!=divIn)
+    errors++;
+  printf("%u qvals x %u passes, %u in\n", CLB_STREAM, passes, in/passes);
+  printf("%-24s %9.2f ns/qval\n", "divide", (double)divNs/CLB_STREAM/passes);
+  printf("%-24s %9.2f ns/qval\n", "inBounds", (double)mulNs/CLB_STREAM/passes);
+
+  for (i=0; i<luts; i++)
+  {
+    for (signum=1; signum<=CL_NUM_SIGNATURES; signum++)
+      randomSig(&clut, signum);
+    clut.setMinBrightness((random32()%50)/100.0f);
+
+    t = nowNs();
+    divideLUT(&clut, ref);
+    divNs += nowNs() - t;
+    t = nowNs();
+    clut.generateLUT();
+    fullNs += nowNs() - t;
+    errors += checkLUT(lut, ref, "whole");
+
+    signum = random32()%CL_NUM_SIGNATURES + 1;
+    if (random32()&1)
+      randomSig(&clut, signum);
+    else // just the range, like the slider in PixyMon
+      clut.setSigRange(signum, 0.5f + (random32()%60)/10.0f);
+    t = nowNs();
+    clut.generateLUT(signum);
+    sigNs += nowNs() - t;
+    divideLUT(&clut, ref);
+    errors += checkLUT(lut, ref, "one signature");
+  }
+  if (luts)
+  {
+    printf("%u LUTs checked\n", luts);
+    printf("%-24s %9.1f us/LUT\n", "divide", divNs/1e3/luts);
+    printf("%-24s %9.1f us/LUT\n", "generateLUT()", fullNs/1e3/luts);
+    printf("%-24s %9.1f us/LUT\n", "generateLUT(signum)", sigNs/1e3/luts);
+  }
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Checks the chirp checksum variants in chirpcrc.h against the original byte loop over random
+// lengths and alignments, then reports the throughput of each.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chirpcrc.h"
+
+#define CRC_BENCH_BUFSIZE     0x10000
+#define CRC_BENCH_TRIALS      20000
+#define CRC_BENCH_ITERATIONS  2000
+
+// original Chirp::calcCrc, kept here as the reference
+static uint16_t crcReference(const uint8_t *buf, uint32_t len)
+{
+  uint32_t i;
+  uint16_t crc;
+
+  for (i=0, crc=0; i<len; i++)
+    crc += buf[i];
+  crc += len;
+
+  return crc;
+}
+
+typedef uint16_t (*CrcFunc)(const uint8_t *buf, uint32_t len);
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static int verify(const uint8_t *buf)
+{
+  int i;
+  uint32_t offset, len;
+
+  for (i=0; i<CRC_BENCH_TRIALS; i++)
+  {
+    offset = rand()&7;
+    // mostly small messages, like chirp traffic, with the odd large one
+    len = i&1 ? rand()%300 : rand()%(CRC_BENCH_BUFSIZE-8);
+    if (crcCompact(buf+offset, len)!=crcReference(buf+offset, len) ||
+        crcSliced(buf+offset, len)!=crcReference(buf+offset, len))
+    {
+      printf("mismatch: offset=%u len=%u\n", offset, len);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void bench(const char *name, CrcFunc func, const uint8_t *buf, uint32_t len)
+{
+  int i;
+  uint32_t sink;
+  double start, elapsed;
+
+  start = now();
+  for (i=0, sink=0; i<CRC_BENCH_ITERATIONS; i++)
+    sink += func(buf+(i&3), len);
+  elapsed = now() - start;
+
+  printf("%-10s %6u bytes: %8.1f MB/s (%04x)\n", name, len,
+         (double)len*CRC_BENCH_ITERATIONS/elapsed/1e6, sink&0xffff);
+}
+
+int main(int argc, char *argv[])
+{
+  int i;
+  uint8_t *buf;
+  static const uint32_t lens[] = {16, 64, 256, 4096, CRC_BENCH_BUFSIZE-4};
+
+  buf = (uint8_t *)malloc(CRC_BENCH_BUFSIZE);
+  if (buf==NULL)
+    return 1;
+  srand(1);
+  for (i=0; i<CRC_BENCH_BUFSIZE; i++)
+    buf[i] = rand();
+
+  if (verify(buf)<0)
+  {
+    free(buf);
+    return 1;
+  }
+  // all-0xff is the worst case for lane overflow
+  memset(buf, 0xff, CRC_BENCH_BUFSIZE);
+  if (verify(buf)<0)
+  {
+    free(buf);
+    return 1;
+  }
+  printf("all variants match reference\n");
+  for (i=0; i<CRC_BENCH_BUFSIZE; i++)
+    buf[i] = rand();
+
+  for (i=0; i<(int)(sizeof(lens)/sizeof(lens[0])); i++)
+  {
+    bench("reference", crcReference, buf, lens[i]);
+    bench("compact", crcCompact, buf, lens[i]);
+    bench("sliced", crcSliced, buf, lens[i]);
+  }
+
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,177 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include "edges_host.h"
+#include "equeue.h"
+#include "pixyvals.h"
+#include "cameravals.h"
+
+static struct EqueueFields *g_eq = (struct EqueueFields *)EQ_LOC;
+
+static uint16_t g_dist = 4;
+static uint16_t g_thresh = 20;
+static uint16_t g_hThresh = 20*3/5;
+
+static uint16_t eqFree(void)
+{
+  uint16_t len = g_eq->produced - g_eq->consumed;
+  return EQ_MEM_SIZE-len;
+}
+
+static void eqEnqueue(uint16_t val)
+{
+  g_eq->data[g_eq->writeIndex++] = val;
+  g_eq->produced++;
+  if (g_eq->writeIndex==EQ_MEM_SIZE)
+    g_eq->writeIndex = 0;
+}
+
+// hScan() -- edges along the line, a state machine so each edge is reported once
+static int hScan(const uint8_t *memy)
+{
+  int16_t i, end, diff;
+
+  if (eqFree()<CAM_RES3_WIDTH/2+CAM_RES3_HEIGHT)
+    return -1;
+  eqEnqueue(EQ_HSCAN_LINE_START);
+
+  i = -1;
+  end = CAM_RES3_WIDTH - g_dist;
+
+  // state 0, looking for either edge
+loop0:
+  i++;
+  if (i>=end)
+    return 0;
+  diff = memy[i+g_dist]-memy[i];
+  if (-g_thresh>=diff)
+    goto edge0;
+  if (diff>=g_thresh)
+    goto edge1;
+  goto loop0;
+
+  // found neg edge
+edge0:
+  eqEnqueue(i | EQ_NEGATIVE);
+  i+=2;
+
+  // state 1, looking for end of edge or pos edge
+loop1:
+  i++;
+  if (i>=end)
+    return 0;
+  diff = memy[i+g_dist]-memy[i];
+  if (-g_hThresh<diff)
+    goto loop0;
+  if (diff>=g_thresh)
+    goto edge1;
+  goto loop1;
+
+  // found pos edge
+edge1:
+  eqEnqueue(i);
+  i+=2;
+
+  // state 2, looking for end of edge or neg edge
+loop2:
+  i++;
+  if (i>=end)
+    return 0;
+  diff = memy[i+g_dist]-memy[i];
+  if (diff<g_hThresh)
+    goto loop0;
+  if (-g_thresh>=diff)
+    goto edge0;
+  goto loop2;
+}
+
+// vScan() -- edges between this line and one a little above it, every 4th column
+static int vScan(const uint8_t *memy)
+{
+  int16_t i, diff;
+  const uint8_t *line0;
+
+  if (eqFree()<CAM_RES3_WIDTH/2+CAM_RES3_HEIGHT)
+    return -1;
+  eqEnqueue(EQ_VSCAN_LINE_START);
+
+  line0 = memy - ((g_dist+5)>>2)*CAM_RES3_WIDTH;
+  for (i=0; i<CAM_RES3_WIDTH; i+=4)
+  {
+    diff = memy[i]-line0[i];
+    if (-g_thresh>=diff)
+      eqEnqueue(i | EQ_NEGATIVE);
+    else if (diff>=g_thresh)
+      eqEnqueue(i);
+  }
+  return 0;
+}
+
+int32_t getEdgesHost(const uint8_t *frame)
+{
+  uint32_t line;
+  const uint8_t *memy;
+
+  for (line=0, memy=frame; line<CAM_RES3_HEIGHT; line++, memy+=CAM_RES3_WIDTH)
+  {
+    if (hScan(memy)<0 || (line>=(g_dist+5)>>2 && vScan(memy)<0))
+    {
+      if (eqFree())
+        eqEnqueue(EQ_ERROR);
+      return -1;
+    }
+  }
+  if (eqFree()==0)
+    return -1;
+  eqEnqueue(EQ_FRAME_END);
+
+  return 0;
+}
+
+int32_t putEdgesHost(const uint16_t *edges, uint32_t len)
+{
+  uint32_t i;
+
+  if (len>eqFree())
+    return -1;
+  for (i=0; i<len; i++)
+    eqEnqueue(edges[i]);
+
+  return 0;
+}
+
+uint32_t peekEdgesHost(uint16_t *edges, uint32_t size)
+{
+  uint32_t i, j;
+  uint16_t len = g_eq->produced - g_eq->consumed;
+
+  for (i=0, j=g_eq->readIndex; i<len && i<size; i++)
+  {
+    edges[i] = g_eq->data[j++];
+    if (j==EQ_MEM_SIZE)
+      j = 0;
+  }
+
+  return i;
+}
+
+int32_t setEdgeParamsHost(uint16_t dist, uint16_t thresh, uint16_t hThresh)
+{
+  g_dist = dist;
+  g_thresh = thresh;
+  g_hThresh = hThresh;
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// C version of the M0's getEdges() (device/libpixy_m0/src/frame_m0.c) that reads a recorded
+// frame instead of the camera port, and a way to queue recorded edges instead.
+
+#ifndef _EDGES_HOST_H
+#define _EDGES_HOST_H
+
+#include <stdint.h>
+#include "cameravals.h"
+
+#define EDGES_FRAME_SIZE    (CAM_RES3_WIDTH*CAM_RES3_HEIGHT)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// frame is CAM_RES3_HEIGHT lines of CAM_RES3_WIDTH luminance values, what lineM0R3() leaves
+// in memory.  Enqueues one frame of edges in the Equeue, hScan() and vScan() of every line,
+// ending with EQ_FRAME_END.  Pixy skips scans when the M0 falls behind the camera, this never
+// does.  Returns -1 if the queue fills.
+int32_t getEdgesHost(const uint8_t *frame);
+
+// enqueues len recorded words, a frame ending with EQ_FRAME_END.  Returns -1 if they don't fit.
+int32_t putEdgesHost(const uint16_t *edges, uint32_t len);
+
+// copies what's queued, up to size words, without dequeuing it.  Returns the number copied.
+uint32_t peekEdgesHost(uint16_t *edges, uint32_t size);
+
+// setEdgeParams()
+int32_t setEdgeParamsHost(uint16_t dist, uint16_t thresh, uint16_t hThresh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
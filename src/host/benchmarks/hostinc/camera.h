@@ -0,0 +1,27 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for device/libpixy_m4/inc/camera.h -- just what line.cpp needs.  There's no
+// camera and no frame to send, so cam_sendFrame() does nothing.
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "chirp.hpp"
+#include "pixytypes.h"
+#include "cameravals.h"
+
+int32_t cam_sendFrame(Chirp *chirp, uint16_t xWidth, uint16_t yWidth, uint8_t renderFlags=RENDER_FLAG_FLUSH, uint32_t fourcc=FOURCC('B','A','8','1'));
+
+#endif
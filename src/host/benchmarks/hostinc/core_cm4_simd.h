@@ -0,0 +1,45 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for the CMSIS SIMD intrinsics (device/libpixy_m4/inc/core_cm4_simd.h and
+// __ROR from core_cmInstr.h), in plain C, so code written for the M4's SIMD instructions can be
+// checked on the host.  Only the ones the CCC modules use are here.
+
+#ifndef __CORE_CM4_SIMD_H
+#define __CORE_CM4_SIMD_H
+
+#include <stdint.h>
+
+// rotate right
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+  op2 &= 31;
+  return op2 ? (op1>>op2) | (op1<<(32-op2)) : op1;
+}
+
+// bytes 0 and 2, zero-extended into the low and high halfwords
+static inline uint32_t __UXTB16(uint32_t op1)
+{
+  return op1&0x00ff00ffUL;
+}
+
+// halfword-wise signed subtract, op1-op2
+static inline uint32_t __SSUB16(uint32_t op1, uint32_t op2)
+{
+  uint32_t lo = (uint16_t)((int16_t)op1 - (int16_t)op2);
+  uint32_t hi = (uint16_t)((int16_t)(op1>>16) - (int16_t)(op2>>16));
+  return lo | (hi<<16);
+}
+
+#endif
@@ -0,0 +1,44 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for device/libpixy_m4/inc/misc.h.  The timers run on a simulated clock that
+// only moves when hostAdvanceTimer() is called, so tracking gives the same results no matter
+// how fast the host is.
+
+#ifndef _MISC_H
+#define _MISC_H
+
+#include <inttypes.h>
+
+// for stringification of preprocessor values
+#define STR(s)           #s
+#define STRINGIFY(s)     STR(s)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void setTimer(uint32_t *timer);
+uint32_t getTimer(uint32_t timer);
+void setTimerMs(uint16_t *timer);
+uint16_t getTimerMs(uint16_t timer);
+
+void hostAdvanceTimer(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for device/libpixy_m4/inc/pixy_init.h -- just what the firmware modules in
+// common/src and device/main_m4/src need.  g_chirpUsb and g_chirpM0 are Chirps on a link that
+// never receives anything, so calls to the M0 fail.
+
+#ifndef PIXY_INIT_H
+#define PIXY_INIT_H
+
+#include <stdio.h>
+#include "chirp.hpp"
+#include "pixyvals.h"
+
+void cprintf(uint32_t flags, const char *format, ...);
+
+extern Chirp *g_chirpUsb;
+extern Chirp *g_chirpM0;
+extern uint8_t g_debug;
+
+#define DBG(...)            if (g_debug) cprintf(0, __VA_ARGS__)
+#define DBGL(level, ...)    if (g_debug>=level) cprintf(0, __VA_ARGS__)
+#define DBGE(n, ...)        if (g_debug==n) cprintf(0, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,35 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for device/common/inc/pixyvals.h.  The Qval and edge queues that the M0 and M4
+// share at a fixed address are an ordinary array here (see pixyhost.cpp).
+
+#ifndef PIXYVALS_H
+#define PIXYVALS_H
+
+#include <stdint.h>
+
+// big enough for a whole frame of Qvals or edges -- QQ_SIZE and EQ_SIZE in the Makefile
+#define HOST_SRAM4_SIZE          0x20000
+#define SRAM4_LOC                g_hostSram4
+// only passed to the M0, which isn't there
+#define SRAM1_LOC                0x10080000
+
+#ifdef __cplusplus
+extern "C" uint32_t g_hostSram4[];
+#else
+extern uint32_t g_hostSram4[];
+#endif
+
+#endif
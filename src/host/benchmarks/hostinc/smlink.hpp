@@ -0,0 +1,36 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Host stand-in for device/libpixy_m4/inc/smlink.hpp.  The M0 and M4 share SmMap at a fixed
+// address on Pixy, here it's an ordinary struct (see linehost.cpp) that nothing else writes.
+
+#ifndef SMLINK_HPP
+#define SMLINK_HPP
+
+#include <stdint.h>
+
+struct SmMap
+{
+	volatile uint8_t stream;
+	volatile uint8_t streamState;
+	volatile uint16_t currentLine;
+	volatile uint16_t frameTime;
+	volatile uint16_t blankTime;
+};
+
+extern SmMap g_hostSm;
+
+#define SM_OBJECT       (&g_hostSm)
+
+#endif
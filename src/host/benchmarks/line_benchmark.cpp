@@ -0,0 +1,534 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Replays a corpus of frames through the firmware's line tracking engine (see linehost.h) and
+// reports the time per frame of each stage of line_processMain(), with percentiles and a
+// histogram, since a line follower cares about its slowest frames as much as the average.
+//
+//   line_benchmark [-r passes] [-g resolution] [-o file] [file...]
+//
+// Files hold recorded Equeue words, little-endian uint16's, each frame ending with
+// EQ_FRAME_END -- the same words line.cpp sends PixyMon as EDGS with LINE_DEBUG_LAYERS.  With
+// no files, a synthetic corpus of CAM_RES3_WIDTH x CAM_RES3_HEIGHT luminance frames is made --
+// a slanted line that wanders, a crossing line that comes and goes and a barcode -- and
+// getEdgesHost() makes the edges, so the M0's part is timed too.  -o saves the synthetic
+// corpus's edges in the same format, to replay later.  -g picks the grid (LINE_RES_*).  The checksum covers what
+// line_getAllFrame() returns for each frame of the first pass, so it shouldn't change unless
+// the detection results do.  Returns nonzero if any frame fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "linehost.h"
+
+#define LINE_BENCH_FRAMES        300
+#define LINE_BENCH_PASSES        5
+#define LINE_BENCH_MAX_FILE      (EQ_MEM_SIZE*2*10000)
+#define LINE_BENCH_BUCKETS       11     // <1us, then powers of 2 up to 512us and more
+
+// synthetic scene
+#define SYNTH_BACKGROUND         150
+#define SYNTH_DARK               40
+#define SYNTH_LINE_WIDTH         40
+#define SYNTH_LINE_MIN           260    // columns the main line's ends wander in
+#define SYNTH_LINE_RANGE         260
+#define SYNTH_CROSS_LEFT         200
+#define SYNTH_CROSS_RIGHT        620
+#define SYNTH_CROSS_HEIGHT       6
+#define SYNTH_CODE_LEFT          40
+#define SYNTH_CODE_TOP           10
+#define SYNTH_CODE_BOTTOM        30
+#define SYNTH_CODE_HALF          8      // columns in a narrow bar
+
+// a barcode as bars -- m_halves[i] narrow widths, dark for even i, starting with the start bar
+struct SynthCode
+{
+  uint8_t m_val;
+  uint8_t m_n;
+  uint8_t m_halves[LINE_MMC_MAX_EDGES];
+};
+
+static uint32_t g_rand;
+static SynthCode g_codes[1<<LINE_MMC_BITS];
+static uint8_t g_numCodes;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+// position along one axis, bouncing between 0 and range
+static int32_t bounce(int32_t start, int32_t v, uint32_t frame, int32_t range)
+{
+  int32_t pos;
+
+  if (range<=0)
+    return 0;
+  range *= 16;
+  pos = (start*16 + v*(int32_t)frame)%(2*range);
+  if (pos<0)
+    pos += 2*range;
+  if (pos>range)
+    pos = 2*range - pos;
+  return pos/16;
+}
+
+// The bars of val, the way decodeCode() reads them: a narrow dark start bar, then each bit
+// (dark is 1), MSB first.  The level changes after each bit, so a bit of the level that's
+// next is one wide bar, and a bit of the other level is a narrow bar of the level that's next,
+// then a narrow bar of the bit's level.  A code ending in a light bar gets a dark stop bar.
+// Returns false if decodeCode() can't read val this way -- too many or too few bars, or all
+// of them the same width.
+static bool encodeCode(uint8_t val, SynthCode *code)
+{
+  uint8_t i, bit, level, narrow, wide;
+
+  code->m_val = val;
+  code->m_n = 0;
+  code->m_halves[code->m_n++] = 1;
+  for (i=0, level=0, narrow=0, wide=0; i<LINE_MMC_BITS; i++)
+  {
+    bit = (val>>(LINE_MMC_BITS-1-i))&1;
+    if (code->m_n+2>LINE_MMC_MAX_EDGES)
+      return false;
+    if (bit==level)
+    {
+      code->m_halves[code->m_n++] = 2;
+      wide++;
+    }
+    else
+    {
+      code->m_halves[code->m_n++] = 1;
+      code->m_halves[code->m_n++] = 1;
+      narrow++;
+    }
+    level = !bit;
+  }
+  if (level) // last bar is light
+  {
+    if (code->m_n>=LINE_MMC_MAX_EDGES)
+      return false;
+    code->m_halves[code->m_n++] = 1;
+  }
+  return code->m_n>=LINE_MMC_MIN_EDGES-1 && code->m_n<=LINE_MMC_MAX_EDGES-1 && narrow && wide;
+}
+
+static void synthCodes()
+{
+  uint8_t val;
+
+  for (val=0, g_numCodes=0; val<1<<LINE_MMC_BITS; val++)
+  {
+    if (encodeCode(val, &g_codes[g_numCodes]))
+      g_numCodes++;
+  }
+}
+
+static void darken(uint8_t *frame, int32_t x0, int32_t x1, int32_t y)
+{
+  int32_t x;
+
+  if (x0<0)
+    x0 = 0;
+  if (x1>CAM_RES3_WIDTH)
+    x1 = CAM_RES3_WIDTH;
+  for (x=x0; x<x1; x++)
+    frame[y*CAM_RES3_WIDTH + x] = SYNTH_DARK + (random32()&0x07);
+}
+
+static void synthFrame(uint8_t *frame, uint32_t n)
+{
+  int32_t x, y, x0, x1, top, bottom;
+  uint8_t i;
+  const SynthCode *code;
+
+  g_rand = n*2654435761u + 1;
+
+  // background -- a gradient
+  for (y=0; y<CAM_RES3_HEIGHT; y++)
+  {
+    for (x=0; x<CAM_RES3_WIDTH; x++)
+      frame[y*CAM_RES3_WIDTH + x] = SYNTH_BACKGROUND + x*40/CAM_RES3_WIDTH + (random32()&0x07);
+  }
+
+  // the line being followed, its ends wandering independently
+  top = SYNTH_LINE_MIN + bounce(60, 9, n, SYNTH_LINE_RANGE-SYNTH_LINE_WIDTH);
+  bottom = SYNTH_LINE_MIN + bounce(200, -6, n, SYNTH_LINE_RANGE-SYNTH_LINE_WIDTH);
+  for (y=0; y<CAM_RES3_HEIGHT; y++)
+  {
+    x0 = top + (bottom-top)*y/(CAM_RES3_HEIGHT-1);
+    darken(frame, x0, x0+SYNTH_LINE_WIDTH, y);
+  }
+
+  // a crossing line, 2 periods of 3
+  if ((n/45)%3!=2)
+  {
+    top = 20 + bounce(0, 5, n, CAM_RES3_HEIGHT-40);
+    for (y=top; y<top+SYNTH_CROSS_HEIGHT; y++)
+      darken(frame, SYNTH_CROSS_LEFT, SYNTH_CROSS_RIGHT, y);
+  }
+
+  // a barcode, every other period, a different one each time
+  if ((n/60)%2==0)
+  {
+    code = &g_codes[(n/120)*5%g_numCodes];
+    for (y=SYNTH_CODE_TOP; y<SYNTH_CODE_BOTTOM; y++)
+    {
+      for (i=0, x=SYNTH_CODE_LEFT; i<code->m_n; i++)
+      {
+        x1 = x + code->m_halves[i]*SYNTH_CODE_HALF;
+        if ((i&1)==0)
+          darken(frame, x, x1, y);
+        x = x1;
+      }
+    }
+  }
+}
+
+// checks one recorded frame of len words, the last EQ_FRAME_END.  line_processMain() can't
+// take a record -- a start code and its edges -- that's longer than its line buffer.
+static int checkFrame(const uint16_t *edges, uint32_t len)
+{
+  uint32_t i, start;
+
+  if (len>EQ_MEM_SIZE)
+    return -1;
+  for (i=0, start=0; i<len; i++)
+  {
+    if (edges[i]==EQ_HSCAN_LINE_START || edges[i]==EQ_VSCAN_LINE_START || edges[i]==EQ_FRAME_END)
+    {
+      if (i-start>CAM_RES3_WIDTH/2-1)
+        return -1;
+      start = i;
+    }
+  }
+  return 0;
+}
+
+// appends the frames in filename to *edges, and where each frame ends to *ends
+static int loadFrames(const char *filename, uint16_t **edges, uint32_t *numEdges, uint32_t **ends, uint32_t *numFrames)
+{
+  FILE *file;
+  long len;
+  uint32_t i, n, start, frames;
+  uint8_t *bytes;
+  uint16_t *mem;
+  uint32_t *mem2;
+
+  file = fopen(filename, "rb");
+  if (file==NULL)
+  {
+    printf("can't open %s\n", filename);
+    return -1;
+  }
+  fseek(file, 0, SEEK_END);
+  len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (len<2 || len>LINE_BENCH_MAX_FILE)
+  {
+    printf("%s isn't recorded edges\n", filename);
+    fclose(file);
+    return -1;
+  }
+  n = len/2;
+  bytes = (uint8_t *)malloc(len);
+  mem = (uint16_t *)realloc(*edges, (size_t)(*numEdges + n)*sizeof(uint16_t));
+  if (bytes==NULL || mem==NULL)
+  {
+    free(bytes);
+    fclose(file);
+    return -1;
+  }
+  *edges = mem;
+  if (fread(bytes, 1, len, file)!=(size_t)len)
+  {
+    printf("error reading %s\n", filename);
+    free(bytes);
+    fclose(file);
+    return -1;
+  }
+  fclose(file);
+  mem += *numEdges;
+  for (i=0, frames=0; i<n; i++)
+  {
+    mem[i] = bytes[2*i] | (bytes[2*i+1]<<8);
+    if (mem[i]==EQ_FRAME_END)
+      frames++;
+  }
+  free(bytes);
+  if (frames==0)
+  {
+    printf("no frames in %s\n", filename);
+    return -1;
+  }
+
+  mem2 = (uint32_t *)realloc(*ends, (*numFrames + frames)*sizeof(uint32_t));
+  if (mem2==NULL)
+    return -1;
+  *ends = mem2;
+  for (i=0, start=0; i<n; i++)
+  {
+    if (mem[i]!=EQ_FRAME_END)
+      continue;
+    if (checkFrame(mem+start, i+1-start)<0)
+    {
+      printf("%s frame %u can't be queued\n", filename, *numFrames);
+      return -1;
+    }
+    mem2[(*numFrames)++] = *numEdges + i+1;
+    start = i+1;
+  }
+  if (start<n)
+    printf("ignoring %u words at the end of %s\n", n-start, filename);
+  *numEdges += start;
+  return 0;
+}
+
+static int saveEdges(FILE *file, const uint16_t *edges, uint32_t len)
+{
+  uint32_t i;
+  uint8_t bytes[2];
+
+  for (i=0; i<len; i++)
+  {
+    bytes[0] = edges[i]&0xff;
+    bytes[1] = edges[i]>>8;
+    if (fwrite(bytes, 2, 1, file)!=1)
+      return -1;
+  }
+  return 0;
+}
+
+static int compareU32(const void *a, const void *b)
+{
+  uint32_t a0 = *(const uint32_t *)a, b0 = *(const uint32_t *)b;
+
+  return a0<b0 ? -1 : a0>b0;
+}
+
+// sorts samples and prints its mean, percentiles and max in microseconds
+static void printStats(const char *name, uint32_t *samples, uint32_t n)
+{
+  uint32_t i;
+  uint64_t sum;
+
+  qsort(samples, n, sizeof(uint32_t), compareU32);
+  for (i=0, sum=0; i<n; i++)
+    sum += samples[i];
+  printf("%-20s %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, sum/1e3/n, samples[n/2]/1e3,
+         samples[(uint64_t)n*90/100]/1e3, samples[(uint64_t)n*99/100]/1e3, samples[n-1]/1e3);
+}
+
+static void printHistogram(const char *name, const uint32_t *samples, uint32_t n)
+{
+  uint32_t i, us, buckets[LINE_BENCH_BUCKETS];
+  uint8_t b;
+
+  memset(buckets, 0, sizeof(buckets));
+  for (i=0; i<n; i++)
+  {
+    for (b=0, us=samples[i]/1000; us && b<LINE_BENCH_BUCKETS-1; b++, us>>=1);
+    buckets[b]++;
+  }
+  printf("%-20s", name);
+  for (b=0; b<LINE_BENCH_BUCKETS; b++)
+    printf(" %6u", buckets[b]);
+  printf("\n");
+}
+
+static void usage()
+{
+  printf("usage: line_benchmark [-r passes] [-g resolution] [-o file] [file...]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  int i, len, pass, passes = LINE_BENCH_PASSES, resolution = LINE_RES_STANDARD;
+  uint32_t f, n, p, s, numFrames = 0, numEdges = 0, errors = 0, checksum = 2166136261u;
+  uint32_t lines = 0, intersections = 0, codes = 0, codeVals = 0;
+  uint64_t t0, t1, t2, m0Ns = 0;
+  uint8_t *frames = NULL;
+  uint16_t *edges = NULL, *queued = NULL;
+  uint32_t *ends = NULL, *samples = NULL;
+  const char *outName = NULL;
+  FILE *out = NULL;
+  uint8_t frameBuf[0x400];
+  uint16_t poolUsage[LINE_POOLS*2], highWater[LINE_POOLS] = {0};
+  LineHost *host;
+  static const char *stageNames[LINE_STAGES+1] = {"grid", "equeue", "hline", "vline", "codes",
+    "segments", "nadirs", "intersections", "tracking", "line_process"};
+  static const char *poolNames[LINE_POOLS] = {"lines", "nodes", "nadirs", "intersections",
+    "barcodes", "clusters"};
+
+  for (i=1; i<argc; i++)
+  {
+    if (strcmp(argv[i], "-r")==0 && i+1<argc)
+      passes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-o")==0 && i+1<argc)
+      outName = argv[++i];
+    else if (strcmp(argv[i], "-g")==0 && i+1<argc)
+    {
+      resolution = atoi(argv[++i]);
+      if (resolution<0 || resolution>=LINE_RES_PROFILES)
+      {
+        usage();
+        return 1;
+      }
+    }
+    else if (argv[i][0]=='-')
+    {
+      usage();
+      return 1;
+    }
+    else if (loadFrames(argv[i], &edges, &numEdges, &ends, &numFrames)<0)
+      return 1;
+  }
+  if (passes<1)
+    passes = 1;
+
+  if (numFrames==0)
+  {
+    numFrames = LINE_BENCH_FRAMES;
+    frames = (uint8_t *)malloc((size_t)numFrames*EDGES_FRAME_SIZE);
+    if (frames==NULL)
+      return 1;
+    synthCodes();
+    for (f=0; f<numFrames; f++)
+      synthFrame(frames + (size_t)f*EDGES_FRAME_SIZE, f);
+    if (outName)
+    {
+      out = fopen(outName, "wb");
+      queued = (uint16_t *)malloc(EQ_MEM_SIZE*sizeof(uint16_t));
+      if (out==NULL || queued==NULL)
+      {
+        printf("can't open %s\n", outName);
+        return 1;
+      }
+    }
+  }
+  else if (outName)
+  {
+    printf("-o saves the synthetic corpus only\n");
+    return 1;
+  }
+
+  // a sample for each stage and line_process() itself, for each frame
+  n = numFrames*passes;
+  samples = (uint32_t *)malloc((size_t)n*(LINE_STAGES+1)*sizeof(uint32_t));
+  if (samples==NULL)
+    return 1;
+
+  for (pass=0, s=0; pass<passes; pass++)
+  {
+    // start each pass with no lines tracked
+    host = new (std::nothrow) LineHost(resolution);
+    if (host==NULL)
+      return 1;
+    for (f=0; f<numFrames; f++, s++)
+    {
+      lineProfileReset();
+      t0 = hostTimeNs();
+      if (frames)
+        len = host->produce(frames + (size_t)f*EDGES_FRAME_SIZE);
+      else
+        len = host->replay(edges + (f ? ends[f-1] : 0), ends[f] - (f ? ends[f-1] : 0));
+      if (len<0)
+        errors++;
+      if (out && pass==0 && saveEdges(out, queued, peekEdgesHost(queued, EQ_MEM_SIZE))<0)
+        errors++;
+      t1 = hostTimeNs();
+      if (host->process()<0)
+        errors++;
+      t2 = hostTimeNs();
+      m0Ns += t1-t0;
+      for (i=0; i<LINE_STAGES; i++)
+        samples[i*n + s] = g_lineProfileNs[i];
+      samples[LINE_STAGES*n + s] = t2-t1;
+
+      len = line_getAllFrame(0xff, frameBuf, sizeof(frameBuf));
+      if (pass==0 && len>0)
+      {
+        // FNV-1a
+        for (i=0; i<len; i++)
+          checksum = (checksum^frameBuf[i])*16777619u;
+        // sections are type, length, then the features
+        for (i=0; i+2<=len; i+=2+frameBuf[i+1])
+        {
+          if (frameBuf[i]==LINE_FR_VECTOR_LINES)
+            lines += frameBuf[i+1]/sizeof(FrameLine);
+          else if (frameBuf[i]==LINE_FR_INTERSECTION)
+            intersections += frameBuf[i+1]/sizeof(FrameIntersection);
+          else if (frameBuf[i]==LINE_FR_BARCODE)
+          {
+            for (p=0; p<frameBuf[i+1]; p+=sizeof(FrameCode))
+            {
+              codes++;
+              codeVals |= 1<<((FrameCode *)(frameBuf+i+2+p))->m_code;
+            }
+          }
+        }
+      }
+    }
+    line_getPoolUsage(poolUsage);
+    for (i=0; i<LINE_POOLS; i++)
+    {
+      if (poolUsage[i*2+1]>highWater[i])
+        highWater[i] = poolUsage[i*2+1];
+    }
+    delete host;
+  }
+  if (out)
+    fclose(out);
+
+  printf("%ux%u grid, ", LINE_GRID_WIDTH, LINE_GRID_HEIGHT);
+  printf("%u frames x %d passes, %.2f lines, %.2f intersections, %.2f barcodes/frame, checksum %08x\n",
+         numFrames, passes, (double)lines/numFrames, (double)intersections/numFrames,
+         (double)codes/numFrames, checksum);
+  if (codeVals)
+  {
+    printf("barcodes seen:");
+    for (i=0; i<32; i++)
+    {
+      if (codeVals&(1<<i))
+        printf(" %d", i);
+    }
+    printf("\n");
+  }
+  printf("pools (high water/size):");
+  for (i=0; i<LINE_POOLS; i++)
+    printf(" %s %u/%u", poolNames[i], highWater[i], poolUsage[i*2]);
+  printf("\n");
+  printf("%-20s %9.1f us/frame\n", frames ? "edges (M0, emulated)" : "edges (replayed)", m0Ns/1e3/n);
+  printf("%-20s %9s %9s %9s %9s %9s (us)\n", "", "mean", "p50", "p90", "p99", "max");
+  for (i=0; i<=LINE_STAGES; i++)
+    printStats(stageNames[i], samples + i*n, n);
+  printf("%-20s %6s %6s %6s %6s %6s %6s %6s %6s %6s %6s %6s (frames, us)\n", "", "<1", "1", "2",
+         "4", "8", "16", "32", "64", "128", "256", "512+");
+  for (i=0; i<=LINE_STAGES; i++)
+    printHistogram(stageNames[i], samples + i*n, n);
+  if (errors)
+    printf("%u errors\n", errors);
+
+  free(samples);
+  free(frames);
+  free(edges);
+  free(ends);
+  free(queued);
+
+  return errors ? 1 : 0;
+}
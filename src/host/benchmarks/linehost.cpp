@@ -0,0 +1,191 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "pixy_init.h"
+#include "misc.h"
+#include "camera.h"
+#include "param.h"
+#include "exec.h"
+#include "smlink.hpp"
+#include "linehost.h"
+
+#define PRM_HOST_PARAMS     64
+#define PRM_HOST_ID_LEN     32
+#define PRM_HOST_DATA_LEN   64
+
+// a parameter as prm_add() left it -- the value is Chirp-serialized, like in flash
+struct HostParam
+{
+  char m_id[PRM_HOST_ID_LEN];
+  uint8_t m_data[PRM_HOST_DATA_LEN];
+  int m_len;
+};
+
+static HostParam g_params[PRM_HOST_PARAMS];
+static uint32_t g_numParams;
+
+SmMap g_hostSm;
+
+uint64_t g_lineProfileNs[LINE_STAGES];
+static uint8_t g_profileStage = LINE_STAGES;
+static uint64_t g_profileStart;
+
+
+static HostParam *prm_find(const char *id)
+{
+  uint32_t i;
+
+  for (i=0; i<g_numParams; i++)
+  {
+    if (strcmp(g_params[i].m_id, id)==0)
+      return &g_params[i];
+  }
+  return NULL;
+}
+
+int prm_add(const char *id, uint32_t flags, uint32_t priority, const char *desc, ...)
+{
+  va_list args;
+  HostParam *param;
+
+  if (prm_find(id))
+    return -2;
+  if (g_numParams>=PRM_HOST_PARAMS || strlen(id)>=PRM_HOST_ID_LEN)
+    return -3;
+  param = &g_params[g_numParams];
+  strcpy(param->m_id, id);
+  va_start(args, desc);
+  param->m_len = Chirp::vserialize(NULL, param->m_data, PRM_HOST_DATA_LEN, &args);
+  va_end(args);
+  if (param->m_len<0)
+    return -3;
+  g_numParams++;
+
+  return 0;
+}
+
+int32_t prm_get(const char *id, ...)
+{
+  va_list args;
+  HostParam *param;
+  int res;
+
+  param = prm_find(id);
+  if (param==NULL)
+    return -1;
+  va_start(args, id);
+  res = Chirp::vdeserialize(param->m_data, param->m_len, &args);
+  va_end(args);
+
+  return res;
+}
+
+int32_t prm_set(const char *id, ...)
+{
+  va_list args;
+  HostParam *param;
+  int len;
+
+  param = prm_find(id);
+  if (param==NULL)
+    return -1;
+  va_start(args, id);
+  len = Chirp::vserialize(NULL, param->m_data, PRM_HOST_DATA_LEN, &args);
+  va_end(args);
+  if (len<0)
+    return -3;
+  param->m_len = len;
+
+  return 0;
+}
+
+// nothing changes the parameters here
+int prm_setShadowCallback(const char *id, ShadowCallback callback)
+{
+  return 0;
+}
+
+int32_t cam_sendFrame(Chirp *chirp, uint16_t xWidth, uint16_t yWidth, uint8_t renderFlags, uint32_t fourcc)
+{
+  return 0;
+}
+
+void exec_sendEvent(Chirp *chirp, uint32_t event)
+{
+}
+
+
+LineHost::LineHost(uint8_t resolution)
+{
+  uint16_t dist, thresh;
+
+  // add the parameters, like exec_loadParams() does when Pixy starts, so the resolution can be
+  // set before line_open()
+  line_loadParams(0);
+  prm_set("Line resolution", UINT8(resolution), END);
+  // line_open() ends by sending the edge parameters to the M0, which fails here.  They go to
+  // getEdgesHost() instead.
+  line_open(0);
+  line_setRenderMode(LINE_RM_MINIMAL);
+  prm_get("Edge distance", &dist, END);
+  prm_get("Edge threshold", &thresh, END);
+  if (dist>g_lineResProfiles[resolution].m_maxDist)
+    dist = g_lineResProfiles[resolution].m_maxDist;
+  setEdgeParamsHost(dist, thresh, thresh*LINE_HTHRESH_RATIO);
+}
+
+LineHost::~LineHost()
+{
+  line_close();
+}
+
+int LineHost::produce(const uint8_t *frame)
+{
+  return getEdgesHost(frame);
+}
+
+int LineHost::replay(const uint16_t *edges, uint32_t len)
+{
+  return putEdgesHost(edges, len);
+}
+
+int LineHost::process()
+{
+  int res;
+
+  res = line_process();
+  hostAdvanceTimer(LINE_HOST_PERIOD);
+  return res;
+}
+
+// time from one mark to the next goes to the stage of the first
+void lineProfileMark(uint8_t stage)
+{
+  uint64_t now = hostTimeNs();
+
+  if (g_profileStage<LINE_STAGES)
+    g_lineProfileNs[g_profileStage] += now - g_profileStart;
+  g_profileStage = stage;
+  g_profileStart = now;
+}
+
+void lineProfileReset()
+{
+  memset(g_lineProfileNs, 0, sizeof(g_lineProfileNs));
+  g_profileStage = LINE_STAGES;
+}
@@ -0,0 +1,55 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Runs the firmware's line tracking engine (device/main_m4/src/line.cpp, Equeue) on the host,
+// fed by recorded frames instead of the camera.  Frames are either luminance frames, which
+// getEdgesHost() turns into edges the way the M0 does, or recorded edges.  Then
+// line_process() runs unchanged.  The parameters are line.cpp's defaults.  Link with
+// liblinehost.a.
+
+#ifndef _LINEHOST_H
+#define _LINEHOST_H
+
+#include <stdint.h>
+#include "chirp.hpp"
+#include "pixytypes.h"
+#include "cameravals.h"
+#include "line.h"
+#include "edges_host.h"
+#include "pixyhost.h"
+
+#define LINE_HOST_PERIOD    16200  // microseconds per frame, the same as BL_PERIOD
+
+class LineHost
+{
+public:
+  // line_open() with the grid of resolution (LINE_RES_*), and LINE_RM_MINIMAL rendering, like
+  // a robot with no PixyMon
+  LineHost(uint8_t resolution=LINE_RES_STANDARD);
+  // line_close()
+  ~LineHost();
+
+  // queue the edges in frame (the M0's part), see getEdgesHost()
+  int produce(const uint8_t *frame);
+  // queue a recorded frame of edges, see putEdgesHost()
+  int replay(const uint16_t *edges, uint32_t len);
+  // line_process() the queued frame, then move the clock ahead one frame period
+  int process();
+};
+
+// time spent in each stage of line_processMain() (LINE_STAGE_*), accumulated until reset
+extern uint64_t g_lineProfileNs[LINE_STAGES];
+void lineProfileReset();
+
+#endif
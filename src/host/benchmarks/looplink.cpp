@@ -0,0 +1,297 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <new>
+#include "looplink.h"
+
+struct LoopMessage
+{
+  LoopMessage *m_next;
+  uint64_t m_deliverUs; // can't be read before this
+  uint32_t m_len;
+  uint32_t m_offset;    // how much has been read
+  uint8_t m_data[1];
+};
+
+uint64_t loopTimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static void loopDeadline(struct timespec *ts, uint64_t us)
+{
+  ts->tv_sec = us/1000000;
+  ts->tv_nsec = (us%1000000)*1000;
+}
+
+
+LoopPipe::LoopPipe()
+{
+  pthread_condattr_t attr;
+
+  pthread_mutex_init(&m_mutex, NULL);
+  // wait against the monotonic clock, same as loopTimeUs()
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&m_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  m_head = m_tail = NULL;
+  m_closed = false;
+  m_busyUntil = 0;
+  m_bytes = m_transfers = m_bitErrors = m_corrupted = 0;
+  configure(&m_config);
+}
+
+LoopPipe::~LoopPipe()
+{
+  LoopMessage *msg;
+
+  while (m_head)
+  {
+    msg = m_head;
+    m_head = msg->m_next;
+    free(msg);
+  }
+  pthread_cond_destroy(&m_cond);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+void LoopPipe::configure(const LoopLinkConfig *config)
+{
+  m_config = *config;
+  m_rand = config->m_seed ? config->m_seed : 1;
+  m_errorBits = nextError();
+}
+
+uint32_t LoopPipe::random()
+{
+  // xorshift32 -- repeatable for a given seed, and independent of rand()
+  m_rand ^= m_rand<<13;
+  m_rand ^= m_rand>>17;
+  m_rand ^= m_rand<<5;
+  return m_rand;
+}
+
+uint32_t LoopPipe::nextError()
+{
+  double u, bits;
+
+  if (m_config.m_bitErrorRate<=0.0)
+    return 0xffffffff;
+  // distance to the next flipped bit is geometric, so we don't need a random number per bit
+  u = (random()+1.0)/4294967297.0;
+  bits = floor(log(u)/log(1.0-m_config.m_bitErrorRate));
+  return bits<0xffffffff ? (uint32_t)bits : 0xffffffff;
+}
+
+void LoopPipe::corrupt(uint8_t *data, uint32_t len)
+{
+  uint64_t bits = (uint64_t)len*8;
+  bool corrupted = false;
+
+  if (m_config.m_bitErrorRate<=0.0)
+    return;
+  while (m_errorBits<bits)
+  {
+    data[m_errorBits>>3] ^= 1<<(m_errorBits&7);
+    m_bitErrors++;
+    corrupted = true;
+    m_errorBits += (uint64_t)nextError() + 1;
+  }
+  m_errorBits -= bits;
+  if (corrupted)
+    m_corrupted++;
+}
+
+int LoopPipe::write(const uint8_t *data, uint32_t len)
+{
+  LoopMessage *msg;
+  uint64_t now;
+
+  if (len==0)
+    return 0;
+  msg = (LoopMessage *)malloc(sizeof(LoopMessage)+len);
+  if (msg==NULL)
+    return LINK_RESULT_ERROR;
+  msg->m_next = NULL;
+  msg->m_len = len;
+  msg->m_offset = 0;
+  memcpy(msg->m_data, data, len);
+
+  pthread_mutex_lock(&m_mutex);
+  if (m_closed)
+  {
+    pthread_mutex_unlock(&m_mutex);
+    free(msg);
+    return LINK_RESULT_ERROR;
+  }
+  corrupt(msg->m_data, len);
+  // transfers go out one after the other at m_bandwidth, then take m_latencyUs to arrive
+  now = loopTimeUs();
+  if (m_busyUntil<now)
+    m_busyUntil = now;
+  if (m_config.m_bandwidth)
+    m_busyUntil += (uint64_t)len*1000000/m_config.m_bandwidth;
+  msg->m_deliverUs = m_busyUntil + m_config.m_latencyUs;
+
+  if (m_tail)
+    m_tail->m_next = msg;
+  else
+    m_head = msg;
+  m_tail = msg;
+  m_bytes += len;
+  m_transfers++;
+  pthread_cond_broadcast(&m_cond);
+  pthread_mutex_unlock(&m_mutex);
+
+  return len;
+}
+
+int LoopPipe::read(uint8_t *data, uint32_t len, uint16_t timeoutMs, bool stream)
+{
+  LoopMessage *msg;
+  uint64_t now, deadline, wake;
+  uint32_t n, recvd = 0;
+  bool ended;
+  struct timespec ts;
+
+  deadline = timeoutMs ? loopTimeUs() + (uint64_t)timeoutMs*1000 : 0;
+
+  pthread_mutex_lock(&m_mutex);
+  while (recvd<len)
+  {
+    if (m_closed)
+      break;
+    now = loopTimeUs();
+    msg = m_head;
+    if (msg && msg->m_deliverUs<=now)
+    {
+      n = msg->m_len - msg->m_offset;
+      if (n>len-recvd)
+        n = len-recvd;
+      memcpy(data+recvd, msg->m_data+msg->m_offset, n);
+      msg->m_offset += n;
+      recvd += n;
+      ended = false;
+      if (msg->m_offset==msg->m_len)
+      {
+        ended = msg->m_len%m_config.m_blockSize!=0;
+        m_head = msg->m_next;
+        if (m_head==NULL)
+          m_tail = NULL;
+        free(msg);
+      }
+      if (!stream && (!m_config.m_coalesce || ended))
+        break;
+      continue;
+    }
+    if (recvd && !stream) // coalescing, and nothing else has arrived yet
+      break;
+    if (deadline && now>=deadline)
+      break;
+    // sleep until the next transfer arrives, or the deadline, whichever is first
+    wake = msg ? msg->m_deliverUs : 0;
+    if (deadline && (wake==0 || deadline<wake))
+      wake = deadline;
+    if (wake)
+    {
+      loopDeadline(&ts, wake);
+      pthread_cond_timedwait(&m_cond, &m_mutex, &ts);
+    }
+    else
+      pthread_cond_wait(&m_cond, &m_mutex);
+  }
+  pthread_mutex_unlock(&m_mutex);
+
+  if (recvd)
+    return recvd;
+  if (m_closed)
+    return LINK_RESULT_ERROR;
+  return LINK_RESULT_ERROR_RECV_TIMEOUT;
+}
+
+void LoopPipe::close()
+{
+  pthread_mutex_lock(&m_mutex);
+  m_closed = true;
+  pthread_cond_broadcast(&m_cond);
+  pthread_mutex_unlock(&m_mutex);
+}
+
+
+LoopLink::LoopLink()
+{
+  m_tx = m_rx = NULL;
+  m_stream = false;
+  m_timer = 0;
+}
+
+void LoopLink::connect(LoopPipe *tx, LoopPipe *rx, const LoopLinkConfig *config)
+{
+  m_tx = tx;
+  m_rx = rx;
+  m_blockSize = config->m_blockSize;
+  m_stream = !config->m_errorCorrected;
+  // a stream link needs acks in lockstep, so calls can't be pipelined over it
+  if (config->m_errorCorrected)
+    m_flags = LINK_FLAG_ERROR_CORRECTED | LINK_FLAG_BUFFERED_RECEIVE;
+  else
+    m_flags = 0;
+}
+
+int LoopLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+  return m_tx->write(data, len);
+}
+
+int LoopLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+  return m_rx->read(data, len, timeoutMs, m_stream);
+}
+
+void LoopLink::setTimer()
+{
+  m_timer = loopTimeUs();
+}
+
+uint32_t LoopLink::getTimer()
+{
+  return (loopTimeUs() - m_timer)/1000;
+}
+
+
+LoopChannel::LoopChannel(const LoopLinkConfig *config)
+{
+  LoopLinkConfig reverse = *config;
+
+  // errors in the two directions shouldn't line up
+  reverse.m_seed = config->m_seed*2654435761u + 1;
+  m_toServer.configure(config);
+  m_toClient.configure(&reverse);
+  m_client.connect(&m_toServer, &m_toClient, config);
+  m_server.connect(&m_toClient, &m_toServer, config);
+}
+
+void LoopChannel::close()
+{
+  m_toServer.close();
+  m_toClient.close();
+}
@@ -0,0 +1,126 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// In-process Link for running two Chirps against each other without hardware.  A LoopChannel
+// is a pair of one-way pipes with a LoopLink on each end.  Each pipe can add latency, limit
+// bandwidth and flip bits.
+
+#ifndef _LOOPLINK_H
+#define _LOOPLINK_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "link.h"
+
+#define LOOPLINK_BLOCK_SIZE        64
+
+struct LoopLinkConfig
+{
+  LoopLinkConfig()
+  {
+    m_latencyUs = 0;
+    m_bandwidth = 0;
+    m_bitErrorRate = 0.0;
+    m_blockSize = LOOPLINK_BLOCK_SIZE;
+    m_errorCorrected = true;
+    m_coalesce = false;
+    m_seed = 1;
+  }
+
+  uint32_t m_latencyUs;   // delay before sent data can be received
+  uint32_t m_bandwidth;   // bytes/s, 0 is unlimited
+  double m_bitErrorRate;  // chance that any one bit is flipped
+  uint32_t m_blockSize;
+  // true: each send() arrives as one transfer, like USB (LINK_FLAG_ERROR_CORRECTED).
+  // false: a byte stream, like UART, so Chirp uses its own crc/ack protocol.
+  bool m_errorCorrected;
+  // true: a receive runs on into the transfers queued behind the first one and only stops after
+  // a short block, like USBLink's async mode (libusb bulk reads into a big buffer).
+  bool m_coalesce;
+  uint32_t m_seed;
+};
+
+struct LoopMessage;
+
+// one direction of a LoopChannel
+class LoopPipe
+{
+public:
+  LoopPipe();
+  ~LoopPipe();
+
+  void configure(const LoopLinkConfig *config);
+  int write(const uint8_t *data, uint32_t len);
+  // stream=false returns what's left of the next transfer (at most len bytes), stream=true waits
+  // for len bytes.  timeoutMs=0 waits forever (same as libusb).
+  int read(uint8_t *data, uint32_t len, uint16_t timeoutMs, bool stream);
+  void close();
+
+  uint32_t m_bytes;
+  uint32_t m_transfers;
+  uint32_t m_bitErrors;
+  uint32_t m_corrupted; // transfers with at least one bit error
+
+private:
+  void corrupt(uint8_t *data, uint32_t len);
+  uint32_t nextError();
+  uint32_t random();
+
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_cond;
+  LoopMessage *m_head;
+  LoopMessage *m_tail;
+  bool m_closed;
+  LoopLinkConfig m_config;
+  uint64_t m_busyUntil; // us, when the pipe is done "transmitting" what's been written
+  uint64_t m_errorBits; // bits until the next error
+  uint32_t m_rand;
+};
+
+class LoopLink : public Link
+{
+public:
+  LoopLink();
+
+  void connect(LoopPipe *tx, LoopPipe *rx, const LoopLinkConfig *config);
+
+  virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
+  virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+  virtual void setTimer();
+  virtual uint32_t getTimer();
+
+private:
+  LoopPipe *m_tx;
+  LoopPipe *m_rx;
+  bool m_stream;
+  uint64_t m_timer;
+};
+
+class LoopChannel
+{
+public:
+  LoopChannel(const LoopLinkConfig *config);
+
+  // wakes up anyone waiting in receive(), which returns an error from then on
+  void close();
+
+  LoopLink m_client;
+  LoopLink m_server;
+  LoopPipe m_toServer;
+  LoopPipe m_toClient;
+};
+
+uint64_t loopTimeUs();
+
+#endif
@@ -0,0 +1,357 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Checks BlobMerge (common/src/blobs.cpp), which merges blobs for Blobs::blobify(), against the
+// test-every-pair combine() and combine2() it replaced, then times the two.
+//
+//   merge_benchmark [-n sets] [-r passes]
+//
+// For each blob count, -n random sets of boxes -- some scattered, some in clumps that merge,
+// some enclosing others, a few past the edges of the grid -- go through blobify()'s sequence:
+// combine2() until nothing merges, then combine().  The boxes, models and counts after each
+// call have to match exactly.  Returns nonzero if anything differs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ccchost.h"
+#include "blobs.h"
+
+#define MB_SETS                 2000
+#define MB_PASSES               5
+
+static const uint16_t g_counts[] = {4, 10, 20, 50, MAX_BLOBS};
+
+#define MB_COUNTS               (int)(sizeof(g_counts)/sizeof(g_counts[0]))
+
+static uint32_t g_rand = 0x6d2b79f5;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+// what Blobs::merge() was, and still is in BlobMerge
+static uint16_t pairMerge(uint16_t mergeDist, uint16_t *M1, uint16_t *A0, uint16_t *B0, uint16_t *C0, uint16_t *D0,
+  uint16_t *A1, uint16_t *B1, uint16_t *C1, uint16_t *D1)
+{
+  bool c0, c1, c2, c3;
+  uint16_t invalid = 0;
+
+  c0 = (*A0 <= *B1 && *B1 <= *B0) || (*A0 >= *B1 && *A0 - *B1 <= mergeDist);
+  c1 = *A0 >= *A1;
+  if (c0 && c1)
+  {
+    c2 = *C0 <= *C1 && *C1 <= *D0;
+    c3 = *C0 <= *D1 && *D1 <= *D0;
+    if (c2 && !c3)
+    {
+      *A0 = *A1;
+      *D0 = *D1;
+      *M1 = 0;
+      invalid++;
+    }
+    else if (!c2 && c3)
+    {
+      *A0 = *A1;
+      *C0 = *C1;
+      *M1 = 0;
+      invalid++;
+    }
+    else if (c2 && c3)
+    {
+      *A0 = *A1;
+      *M1 = 0;
+      invalid++;
+    }
+    else
+    {
+      c2 = *C1 <= *C0 && *C0 <= *D1;
+      c3 = *C1 <= *D0 && *D0 <= *D1;
+      if (c2 && c3)
+      {
+        *A0 = *A1;
+        *C0 = *C1;
+        *D0 = *D1;
+        *M1 = 0;
+        invalid++;
+      }
+    }
+  }
+  else
+  {
+    c0 = (*A1 <= *B0 && *B0 <= *B1) || (*A1 >= *B0 && *A1 - *B0 <= mergeDist);
+    c1 = *A1 >= *A0;
+    if (c0 && c1)
+    {
+      c2 = *C1 <= *C0 && *C0 <= *D1;
+      c3 = *C1 <= *D0 && *D0 <= *D1;
+      if (c2 && !c3)
+      {
+        *B0 = *B1;
+        *C0 = *C1;
+        *M1 = 0;
+        invalid++;
+      }
+      else if (!c2 && c3)
+      {
+        *B0 = *B1;
+        *D0 = *D1;
+        *M1 = 0;
+        invalid++;
+      }
+      else if (c2 && c3)
+      {
+        *B0 = *B1;
+        *C0 = *C1;
+        *D0 = *D1;
+        *M1 = 0;
+        invalid++;
+      }
+      else
+      {
+        c2 = *C0 <= *C1 && *C1 <= *D0;
+        c3 = *C0 <= *D1 && *D1 <= *D0;
+        if (c2 && c3)
+        {
+          *B0 = *B1;
+          *M1 = 0;
+          invalid++;
+        }
+      }
+    }
+  }
+  return invalid;
+}
+
+// what Blobs::combine2() did before
+static uint16_t pairCombine2(uint16_t mergeDist, BlobA *blobs, uint16_t numBlobs)
+{
+  uint16_t i, j, invalid;
+
+  for (i=0, invalid=0; i<numBlobs; i++)
+  {
+    if (blobs[i].m_model==0)
+      continue;
+    for (j=i+1; j<numBlobs; j++)
+    {
+      if (blobs[j].m_model==0)
+        continue;
+      invalid += pairMerge(mergeDist, &blobs[j].m_model, &blobs[i].m_left, &blobs[i].m_right, &blobs[i].m_top,
+        &blobs[i].m_bottom, &blobs[j].m_left, &blobs[j].m_right, &blobs[j].m_top, &blobs[j].m_bottom);
+      invalid += pairMerge(mergeDist, &blobs[j].m_model, &blobs[i].m_top, &blobs[i].m_bottom, &blobs[i].m_left,
+        &blobs[i].m_right, &blobs[j].m_top, &blobs[j].m_bottom, &blobs[j].m_left, &blobs[j].m_right);
+    }
+  }
+  return invalid;
+}
+
+// what Blobs::combine() did before
+static uint16_t pairCombine(BlobA *blobs, uint16_t numBlobs)
+{
+  uint16_t i, j, invalid;
+  BlobA *b0, *b1;
+
+  for (i=0, invalid=0; i<numBlobs; i++)
+  {
+    b0 = blobs + i;
+    if (b0->m_model==0)
+      continue;
+    // b0 can be invalidated below and still enclose the blobs after it, like before
+    BlobA box0 = *b0;
+    for (j=i+1; j<numBlobs; j++)
+    {
+      b1 = blobs + j;
+      if (b1->m_model==0)
+        continue;
+      if (box0.m_left<=b1->m_left && box0.m_right>=b1->m_right && box0.m_top<=b1->m_top && box0.m_bottom>=b1->m_bottom)
+      {
+        b1->m_model = 0;
+        invalid++;
+      }
+      else if (b1->m_left<=box0.m_left && b1->m_right>=box0.m_right && b1->m_top<=box0.m_top && b1->m_bottom>=box0.m_bottom)
+      {
+        b0->m_model = 0;
+        invalid++;
+      }
+    }
+  }
+  return invalid;
+}
+
+// boxes are in blobify()'s units: x is 2*column, so even, y is the row
+static void randomBox(BlobA *blob, uint16_t x, uint16_t y, uint16_t maxSize)
+{
+  blob->m_model = 1 + random32()%7;
+  blob->m_left = x&~1;
+  blob->m_right = blob->m_left + ((random32()%maxSize)&~1);
+  blob->m_top = y;
+  blob->m_bottom = y + 2 + random32()%maxSize;
+}
+
+static void randomSet(BlobA *blobs, uint16_t numBlobs)
+{
+  uint16_t i, x=0, y=0, size;
+  uint32_t kind;
+
+  size = 4 + random32()%60;
+  for (i=0; i<numBlobs; i++)
+  {
+    kind = random32()%10;
+    if (kind<4 || i==0) // scattered
+    {
+      x = random32()%316;
+      y = random32()%206;
+      randomBox(blobs+i, x, y, size);
+    }
+    else if (kind<8) // next to the one before
+      randomBox(blobs+i, x + random32()%24, y<8 ? y + random32()%16 : y + random32()%24 - 8, size);
+    else if (kind<9) // inside an earlier one
+    {
+      blobs[i] = blobs[random32()%i];
+      if (blobs[i].m_right-blobs[i].m_left>=4)
+        blobs[i].m_left += 2;
+      if (blobs[i].m_bottom-blobs[i].m_top>=2)
+        blobs[i].m_bottom--;
+      if (blobs[i].m_model==0)
+        blobs[i].m_model = 1;
+    }
+    else // off the grid
+      randomBox(blobs+i, 256 + random32()%600, 192 + random32()%300, size);
+    if (random32()%50==0)
+      blobs[i].m_model = 0;
+    x = blobs[i].m_left;
+    y = blobs[i].m_top;
+  }
+}
+
+// combine2() until nothing merges, then combine(), like Blobs::blobify(), recording each count
+static uint16_t combineAll(BlobMerge *merge, uint16_t mergeDist, BlobA *blobs, uint16_t numBlobs, uint16_t *counts)
+{
+  uint16_t n=0, invalid;
+
+  while(1)
+  {
+    invalid = merge ? merge->combine2(blobs, numBlobs) : pairCombine2(mergeDist, blobs, numBlobs);
+    counts[n++] = invalid;
+    if (invalid==0)
+      break;
+  }
+  counts[n++] = merge ? merge->combine(blobs, numBlobs) : pairCombine(blobs, numBlobs);
+  return n;
+}
+
+static bool sameBlobs(const BlobA *blobs0, const BlobA *blobs1, uint16_t numBlobs)
+{
+  uint16_t i;
+
+  for (i=0; i<numBlobs; i++)
+  {
+    if (blobs0[i].m_model!=blobs1[i].m_model || blobs0[i].m_left!=blobs1[i].m_left ||
+      blobs0[i].m_right!=blobs1[i].m_right || blobs0[i].m_top!=blobs1[i].m_top ||
+      blobs0[i].m_bottom!=blobs1[i].m_bottom)
+      return false;
+  }
+  return true;
+}
+
+static void usage()
+{
+  printf("usage: merge_benchmark [-n sets] [-r passes]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  static BlobA sets[MB_SETS][MAX_BLOBS];
+  static BlobA pairBlobs[MAX_BLOBS], gridBlobs[MAX_BLOBS];
+  static uint16_t mergeDists[MB_SETS];
+  uint16_t pairCounts[MAX_BLOBS+2], gridCounts[MAX_BLOBS+2], pairN, gridN, numBlobs;
+  uint32_t i, s, numSets=MB_SETS, passes=MB_PASSES, pass, errors=0, merged;
+  uint64_t t, pairNs, gridNs;
+  int c;
+  BlobMerge merge;
+
+  for (i=1; i<(uint32_t)argc; i++)
+  {
+    if (strcmp(argv[i], "-n")==0 && i+1<(uint32_t)argc)
+      numSets = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-r")==0 && i+1<(uint32_t)argc)
+      passes = strtoul(argv[++i], NULL, 0);
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+  if (numSets==0)
+    numSets = 1;
+  else if (numSets>MB_SETS)
+    numSets = MB_SETS;
+
+  for (c=0; c<MB_COUNTS; c++)
+  {
+    numBlobs = g_counts[c];
+    for (s=0; s<numSets; s++)
+    {
+      randomSet(sets[s], numBlobs);
+      mergeDists[s] = random32()%4 ? MAX_MERGE_DIST : random32()%40;
+    }
+
+    // check
+    for (s=0, merged=0; s<numSets; s++)
+    {
+      memcpy(pairBlobs, sets[s], numBlobs*sizeof(BlobA));
+      memcpy(gridBlobs, sets[s], numBlobs*sizeof(BlobA));
+      merge.setMergeDist(mergeDists[s]);
+      pairN = combineAll(NULL, mergeDists[s], pairBlobs, numBlobs, pairCounts);
+      gridN = combineAll(&merge, mergeDists[s], gridBlobs, numBlobs, gridCounts);
+      if (pairN!=gridN || memcmp(pairCounts, gridCounts, pairN*sizeof(uint16_t))!=0 ||
+        !sameBlobs(pairBlobs, gridBlobs, numBlobs))
+      {
+        printf("%u blobs, set %u (merge distance %u): results differ\n", numBlobs, s, mergeDists[s]);
+        errors++;
+      }
+      for (i=0; i<numBlobs; i++)
+        merged += sets[s][i].m_model!=0 && pairBlobs[i].m_model==0;
+    }
+
+    // time
+    for (pass=0, pairNs=gridNs=0; pass<passes; pass++)
+    {
+      for (s=0; s<numSets; s++)
+      {
+        memcpy(pairBlobs, sets[s], numBlobs*sizeof(BlobA));
+        t = hostTimeNs();
+        combineAll(NULL, mergeDists[s], pairBlobs, numBlobs, pairCounts);
+        pairNs += hostTimeNs() - t;
+        memcpy(gridBlobs, sets[s], numBlobs*sizeof(BlobA));
+        merge.setMergeDist(mergeDists[s]);
+        t = hostTimeNs();
+        combineAll(&merge, mergeDists[s], gridBlobs, numBlobs, gridCounts);
+        gridNs += hostTimeNs() - t;
+      }
+    }
+
+    printf("%u blobs: %u sets x %u passes, %.1f blobs removed/set\n", numBlobs, numSets, passes, (double)merged/numSets);
+    printf("  %-22s %9.2f us/set\n", "every pair", pairNs/1e3/numSets/passes);
+    printf("  %-22s %9.2f us/set\n", "BlobMerge", gridNs/1e3/numSets/passes);
+  }
+
+  if (errors)
+    printf("%u errors\n", errors);
+  return errors ? 1 : 0;
+}
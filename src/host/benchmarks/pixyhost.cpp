@@ -0,0 +1,98 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include "pixy_init.h"
+#include "misc.h"
+#include "pixyhost.h"
+
+// the Qval and edge queues, which live in SRAM4 on Pixy
+uint32_t g_hostSram4[HOST_SRAM4_SIZE/sizeof(uint32_t)];
+
+static uint32_t g_hostUs;
+
+uint8_t g_debug = 0;
+
+// Blobs services USB every few lines and line.cpp calls the M0 -- there's never anything to
+// receive here
+class IdleLink : public Link
+{
+public:
+  virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+  {
+    return len;
+  }
+  virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+  {
+    return LINK_RESULT_ERROR_RECV_TIMEOUT;
+  }
+  virtual void setTimer()
+  {
+  }
+  virtual uint32_t getTimer()
+  {
+    return 0;
+  }
+};
+
+static IdleLink g_idleLink;
+static Chirp g_chirp(false, false, &g_idleLink);
+static Chirp g_chirp0(false, false, &g_idleLink);
+Chirp *g_chirpUsb = &g_chirp;
+Chirp *g_chirpM0 = &g_chirp0;
+
+
+void cprintf(uint32_t flags, const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+void setTimer(uint32_t *timer)
+{
+  *timer = g_hostUs;
+}
+
+uint32_t getTimer(uint32_t timer)
+{
+  return g_hostUs - timer;
+}
+
+void setTimerMs(uint16_t *timer)
+{
+  *timer = g_hostUs/1000;
+}
+
+uint16_t getTimerMs(uint16_t timer)
+{
+  return (uint16_t)(g_hostUs/1000) - timer;
+}
+
+void hostAdvanceTimer(uint32_t us)
+{
+  g_hostUs += us;
+}
+
+uint64_t hostTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,26 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// What the firmware modules built for the host get in place of Pixy: the shared memory, the
+// timers, cprintf() and the Chirps of hostinc/.  Link with libccchost.a or liblinehost.a.
+
+#ifndef _PIXYHOST_H
+#define _PIXYHOST_H
+
+#include <stdint.h>
+
+// monotonic host time, for measuring
+uint64_t hostTimeNs();
+
+#endif
@@ -0,0 +1,185 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Checks that rlsLine() (common/src/rlsline.cpp) makes the same Qvals as the C version of the
+// M0's run-length code, and compares their throughput.
+//
+//   rls_benchmark [-n frames] [-r passes]
+//
+// Each of the LUTs below is run over -n synthetic frames -- colored rectangles on a noisy
+// background -- once with getRLSFrameHost() and once with getRLSFrameHostVector(), and the
+// Qval streams have to match exactly.  Build with "make RLS_FLAGS=-DRLS_DSP" to check the M4
+// code instead of the host's SIMD code.  Returns nonzero if anything differs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ccchost.h"
+#include "rls_host.h"
+#include "colorlut.h"
+
+#define RLS_BENCH_FRAMES        100
+#define RLS_BENCH_PASSES        5
+#define RLS_BENCH_RECTS         24
+
+static uint32_t g_rand = 0x2545f491;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+// BA81: even lines are blue/green, odd lines green/red
+static void makeFrame(uint8_t *frame)
+{
+  int x, y, i, x0, y0, w, h, noise;
+  uint8_t rgb[3];
+
+  for (i=0; i<CCC_FRAME_SIZE; i++)
+    frame[i] = 40 + random32()%40;
+  for (i=0; i<RLS_BENCH_RECTS; i++)
+  {
+    x0 = random32()%CAM_RES2_WIDTH;
+    y0 = random32()%CAM_RES2_HEIGHT;
+    w = 4 + random32()%80;
+    h = 4 + random32()%60;
+    rgb[0] = random32();
+    rgb[1] = random32();
+    rgb[2] = random32();
+    noise = 1 + random32()%24;
+    for (y=y0; y<y0+h && y<CAM_RES2_HEIGHT; y++)
+      for (x=x0; x<x0+w && x<CAM_RES2_WIDTH; x++)
+      {
+        if (y&1)
+          i = x&1 ? rgb[0] : rgb[1];
+        else
+          i = x&1 ? rgb[1] : rgb[2];
+        i += (int)(random32()%noise) - noise/2;
+        frame[y*CAM_RES2_WIDTH+x] = i<0 ? 0 : i>255 ? 255 : i;
+      }
+  }
+}
+
+// LUT kinds: blotches of signatures over the (u, v) plane, like a taught LUT but busier, then
+// every entry random, then every entry the same signature, so every pair of columns matches
+static void makeLUT(uint8_t *lut, int kind)
+{
+  int u, v;
+  uint8_t cells[16][16];
+
+  for (u=0; u<16; u++)
+    for (v=0; v<16; v++)
+      cells[u][v] = random32()%5<2 ? random32()%CL_NUM_SIGNATURES + 1 : 0;
+  for (u=0; u<1<<CL_LUT_COMPONENT_SCALE; u++)
+    for (v=0; v<1<<CL_LUT_COMPONENT_SCALE; v++)
+    {
+      if (kind==0)
+        lut[(u<<CL_LUT_COMPONENT_SCALE) | v] = cells[u>>2][v>>2];
+      else if (kind==1)
+        lut[(u<<CL_LUT_COMPONENT_SCALE) | v] = random32()%(CL_NUM_SIGNATURES+1);
+      else
+        lut[(u<<CL_LUT_COMPONENT_SCALE) | v] = 1;
+    }
+}
+
+static void usage()
+{
+  printf("usage: rls_benchmark [-n frames] [-r passes]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  static const char *lutNames[] = {"blotches", "random", "all"};
+  static Qval scalarQvals[QQ_MEM_SIZE], vectorQvals[QQ_MEM_SIZE];
+  static uint8_t lut[CL_LUT_SIZE];
+  uint32_t i, f, numFrames=RLS_BENCH_FRAMES, passes=RLS_BENCH_PASSES, pass, errors=0, qvals;
+  uint32_t scalarN, vectorN;
+  uint64_t t, scalarNs, vectorNs;
+  int kind;
+  uint8_t *frames;
+  CccHost host;
+
+  for (i=1; i<(uint32_t)argc; i++)
+  {
+    if (strcmp(argv[i], "-n")==0 && i+1<(uint32_t)argc)
+      numFrames = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-r")==0 && i+1<(uint32_t)argc)
+      passes = strtoul(argv[++i], NULL, 0);
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+  if (numFrames==0)
+    numFrames = 1;
+
+  frames = new uint8_t[(size_t)numFrames*CCC_FRAME_SIZE];
+  for (f=0; f<numFrames; f++)
+    makeFrame(frames + (size_t)f*CCC_FRAME_SIZE);
+
+  for (kind=0; kind<3; kind++)
+  {
+    makeLUT(lut, kind);
+
+    // check
+    for (f=0, qvals=0; f<numFrames; f++)
+    {
+      host.m_qq->reset();
+      if (getRLSFrameHost(frames + (size_t)f*CCC_FRAME_SIZE, lut)<0)
+        errors++;
+      scalarN = host.m_qq->readAll(scalarQvals, QQ_MEM_SIZE);
+      if (getRLSFrameHostVector(frames + (size_t)f*CCC_FRAME_SIZE, lut)<0)
+        errors++;
+      vectorN = host.m_qq->readAll(vectorQvals, QQ_MEM_SIZE);
+      if (scalarN!=vectorN || memcmp(scalarQvals, vectorQvals, scalarN*sizeof(Qval))!=0)
+      {
+        printf("%s LUT, frame %u: Qvals differ\n", lutNames[kind], f);
+        errors++;
+      }
+      qvals += scalarN;
+    }
+
+    // time
+    for (pass=0, scalarNs=vectorNs=0; pass<passes; pass++)
+    {
+      for (f=0; f<numFrames; f++)
+      {
+        host.m_qq->reset();
+        t = hostTimeNs();
+        getRLSFrameHost(frames + (size_t)f*CCC_FRAME_SIZE, lut);
+        scalarNs += hostTimeNs() - t;
+        host.m_qq->reset();
+        t = hostTimeNs();
+        getRLSFrameHostVector(frames + (size_t)f*CCC_FRAME_SIZE, lut);
+        vectorNs += hostTimeNs() - t;
+      }
+    }
+
+    printf("%s LUT: %u frames x %u passes, %.0f Qvals/frame\n", lutNames[kind], numFrames, passes,
+           (double)qvals/numFrames);
+    printf("  %-22s %9.1f us/frame %9.1f Mpixels/s\n", "M0, emulated", scalarNs/1e3/numFrames/passes,
+           (double)CCC_FRAME_SIZE*numFrames*passes/(scalarNs/1e3));
+    printf("  %-22s %9.1f us/frame %9.1f Mpixels/s\n", "rlsLine", vectorNs/1e3/numFrames/passes,
+           (double)CCC_FRAME_SIZE*numFrames*passes/(vectorNs/1e3));
+  }
+  delete [] frames;
+
+  if (errors)
+    printf("%u errors\n", errors);
+  return errors ? 1 : 0;
+}
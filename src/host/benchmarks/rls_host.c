@@ -0,0 +1,150 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include "rls_host.h"
+#include "rlsline.h"
+#include "rls_m0.h"
+#include "qqueue.h"
+#include "pixyvals.h"
+#include "cameravals.h"
+
+#define RLS_COLS   (CAM_RES2_WIDTH/2)
+
+static uint16_t g_rlsTop = 0;
+static uint16_t g_rlsBottom = CAM_RES2_HEIGHT;
+static uint8_t g_rlsDecimation = 1;
+
+// what lineProcessedRL0A() leaves in the line store for each column of the blue/green line
+static uint16_t g_vIndex[RLS_COLS]; // b-g, reduced to 6 bits, low half of the LUT index
+static uint16_t g_bgSum[RLS_COLS];  // b+g of this column and the one before
+static int16_t g_vSum[RLS_COLS];    // b-g of this column and the one before
+
+static void lineRL0(const uint8_t *line)
+{
+  int32_t col, b, g, bg, v, lastBg=0, lastV=0;
+
+  for (col=0; col<RLS_COLS; col++)
+  {
+    b = line[col*2];
+    g = line[col*2+1];
+    bg = b+g;
+    v = b-g;
+    g_bgSum[col] = bg+lastBg;
+    g_vSum[col] = v+lastV;
+    g_vIndex[col] = (v>>3)&0x3f;
+    lastBg = bg;
+    lastV = v;
+  }
+}
+
+static uint32_t lutSig(const uint8_t *lut, int32_t u, int32_t col)
+{
+  return lut[(((u>>3)&0x3f)<<6) | g_vIndex[col]];
+}
+
+// lineProcessedRL1A() -- the green/red line.  A Qval is emitted when two neighboring columns
+// map to the same signature, and the two columns after it are skipped.
+static void lineRL1(const uint8_t *line, const uint8_t *lut)
+{
+  int32_t col, u, usum, rsum;
+  uint32_t sig;
+  Qval qval;
+
+  for (col=0; col<RLS_COLS; col++)
+  {
+    u = line[col*2+1] - line[col*2];
+    sig = lutSig(lut, u, col);
+    if (sig==0)
+      continue;
+    usum = u;
+    rsum = line[col*2+1];
+
+    if (++col>=RLS_COLS)
+      break;
+    u = line[col*2+1] - line[col*2];
+    if (lutSig(lut, u, col)!=sig)
+      continue;
+    usum += u;
+    rsum += line[col*2+1];
+
+    qval.m_u = usum;
+    qval.m_v = g_vSum[col];
+    qval.m_y = g_bgSum[col] + rsum;
+    qval.m_col = (col<<3) | sig;
+    qq_enqueue(&qval);
+    col += 2;
+  }
+}
+
+static int32_t getFrame(const uint8_t *frame, const uint8_t *lut, int vector)
+{
+  uint32_t line, i, n;
+  const uint8_t *pixels;
+  Qval lineBegin, frameEnd, qvals[MAX_NEW_QVALS_PER_LINE];
+  lineBegin.m_col = lineBegin.m_u = lineBegin.m_v = lineBegin.m_y = 0;
+  frameEnd.m_col = 0xffff;
+  frameEnd.m_u = frameEnd.m_v = frameEnd.m_y = 0;
+  lineBegin.m_v = g_rlsDecimation;
+
+  for (line=g_rlsTop; line<g_rlsBottom; line+=g_rlsDecimation)
+  {
+    // not enough space--- return error
+    if (qq_free()<MAX_NEW_QVALS_PER_LINE)
+    {
+      frameEnd.m_col = 0xfffe;
+      qq_enqueue(&frameEnd);
+      return -1;
+    }
+    lineBegin.m_u = line;
+    qq_enqueue(&lineBegin);
+    // The M0 sees twice as many lines as a BA81 frame has (BA81 averages pairs of sensor
+    // lines of the same color), so each pair of BA81 lines stands in for two line pairs.
+    pixels = frame + (line&~1)*CAM_RES2_WIDTH;
+    if (vector)
+    {
+      n = rlsLine(pixels, pixels+CAM_RES2_WIDTH, lut, qvals, RLS_COLS);
+      for (i=0; i<n; i++)
+        qq_enqueue(qvals+i);
+    }
+    else
+    {
+      lineRL0(pixels);
+      lineRL1(pixels+CAM_RES2_WIDTH, lut);
+    }
+  }
+  qq_enqueue(&frameEnd);
+
+  return 0;
+}
+
+int32_t getRLSFrameHost(const uint8_t *frame, const uint8_t *lut)
+{
+  return getFrame(frame, lut, 0);
+}
+
+int32_t getRLSFrameHostVector(const uint8_t *frame, const uint8_t *lut)
+{
+  return getFrame(frame, lut, 1);
+}
+
+int32_t setRLSWindowHost(uint16_t top, uint16_t bottom, uint8_t decimation)
+{
+  if (top>=bottom || bottom>CAM_RES2_HEIGHT || decimation<1 || decimation>RLS_MAX_DECIMATION)
+    return -1;
+  g_rlsTop = top;
+  g_rlsBottom = bottom;
+  g_rlsDecimation = decimation;
+  return 0;
+}
@@ -0,0 +1,44 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// C version of the M0's getRLSFrame() (device/libpixy_m0/src/rls_m0.c) that reads a recorded
+// frame instead of the camera port.
+
+#ifndef _RLS_HOST_H
+#define _RLS_HOST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// frame is a CAM_RES2_WIDTH x CAM_RES2_HEIGHT BA81 (Bayer) frame, the same as cam_getFrame()
+// returns, and lut is the CL_LUT_SIZE byte LUT from ColorLUT::generateLUT().  Enqueues one
+// frame of Qvals with qq_enqueue().  Returns -1 if the queue fills, like the M0 does.
+int32_t getRLSFrameHost(const uint8_t *frame, const uint8_t *lut);
+
+// The same, with rlsLine() (common/src/rlsline.cpp) doing each line instead of the C version of
+// the M0's code.  The Qvals are the same.
+int32_t getRLSFrameHostVector(const uint8_t *frame, const uint8_t *lut);
+
+// setRLSWindow() -- the rows of the frames after this, see rls_m0.h
+int32_t setRLSWindowHost(uint16_t top, uint16_t bottom, uint8_t decimation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
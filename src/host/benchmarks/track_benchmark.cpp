@@ -0,0 +1,389 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Compares TrackAssociation (device/main_m4/inc/trackassoc.h), which Blobs and the line tracker
+// use to match trackers to objects, with the search-and-swap loop it replaced.
+//
+//   track_benchmark [-n frames] [-r passes]
+//
+// Boxes move over the frame at random speeds, bouncing off the edges and crossing each other,
+// or crowd together slowly, all of one model.  Each frame's detections are their boxes, a
+// little noisy, shuffled, with a few missing.  Both ways of matching run the same tracker life
+// cycle as Blobs::handleBlobTracking().  The report is the time to match per frame and how
+// often a tracker's object changed (an ID switch) or a new tracker had to be started.
+// TrackAssociation also runs with the trackers' constant-velocity prediction (Tracker::predict())
+// gating the matches, and for that run, the error of the valid trackers' positions against
+// where their objects are a frame later is reported, as reported (the last match) and as
+// predicted a frame ahead.  Returns nonzero if a tracker or a box is ever matched twice.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ccchost.h"
+#include "blobs.h"
+
+#define TB_FRAMES               600
+#define TB_PASSES               3
+#define TB_MAX_OBJECTS          MAX_BLOBS
+
+static const uint16_t g_counts[] = {5, 20, 50, MAX_BLOBS};
+
+#define TB_COUNTS               (int)(sizeof(g_counts)/sizeof(g_counts[0]))
+
+// m_angle is borrowed for the id of the object a box came from
+struct TbObject
+{
+  int32_t m_x, m_y;     // 1/16 pixels
+  int32_t m_vx, m_vy;
+  uint16_t m_width, m_height;
+  uint16_t m_model;
+};
+
+typedef SimpleList<Tracker<BlobA> > TrackerList;
+
+static uint32_t g_rand = 0x1b873593;
+
+static uint32_t random32()
+{
+  g_rand ^= g_rand<<13;
+  g_rand ^= g_rand>>17;
+  g_rand ^= g_rand<<5;
+  return g_rand;
+}
+
+// Blobs::compareBlobs() at the nominal frame period
+static uint32_t compareBlobs(const BlobA &b0, const BlobA &b1, int32_t dx=0, int32_t dy=0)
+{
+  int32_t xcenter, ycenter, left, right, top, bottom;
+
+  if (b0.m_model!=b1.m_model)
+    return TR_MAXVAL;
+  xcenter = ((b0.m_left+b0.m_right)>>1) - ((b1.m_left+b1.m_right)>>1) + dx;
+  ycenter = ((b0.m_top+b0.m_bottom)>>1) - ((b1.m_top+b1.m_bottom)>>1) + dy;
+  if (((xcenter*xcenter + ycenter*ycenter)>>1)>BL_MAX_TRACKING_DIST*BL_MAX_TRACKING_DIST)
+    return TR_MAXVAL;
+  left = b0.m_left - b1.m_left + dx;
+  right = b0.m_right - b1.m_right + dx;
+  top = b0.m_top - b1.m_top + dy;
+  bottom = b0.m_bottom - b1.m_bottom + dy;
+  return (left*left + right*right + top*top + bottom*bottom)>>2;
+}
+
+// what Blobs::handleBlobTracking2() did before, called until it returns 0
+static uint16_t searchAndSwap(TrackerList *trackers, BlobA *blobs, uint16_t numBlobs)
+{
+  uint32_t val, min;
+  uint16_t n=0, j;
+  SimpleListNode<Tracker<BlobA> > *i;
+  BlobA *minBlob;
+
+  for (i=trackers->m_first; i!=NULL; i=i->m_next)
+  {
+    if (i->m_object.m_minVal!=TR_MAXVAL)
+      continue;
+    for (j=0, min=TR_MAXVAL, minBlob=NULL; j<numBlobs; j++)
+    {
+      val = compareBlobs(i->m_object.m_object, blobs[j]);
+      if (val<min && i->m_object.swappable(val, &blobs[j]))
+      {
+        min = val;
+        minBlob = &blobs[j];
+      }
+    }
+    if (minBlob)
+    {
+      if (minBlob->m_tracker)
+        minBlob->m_tracker->resetMin();
+      minBlob->m_tracker = &i->m_object;
+      i->m_object.setMin(minBlob, min);
+      n++;
+    }
+  }
+  return n;
+}
+
+static uint16_t associate(TrackAssociation<BlobA, BL_TRACKING_TRACKERS, MAX_BLOBS> *assoc, TrackerList *trackers,
+  BlobA *blobs, uint16_t numBlobs, bool prediction)
+{
+  SimpleListNode<Tracker<BlobA> > *i;
+  uint16_t j;
+  int32_t dx, dy;
+
+  assoc->begin();
+  for (i=trackers->m_first; i!=NULL; i=i->m_next)
+  {
+    dx = dy = 0;
+    if (prediction)
+      i->m_object.predict(&dx, &dy);
+    assoc->addTracker(&i->m_object);
+    for (j=0; j<numBlobs; j++)
+      assoc->add(&blobs[j], j, compareBlobs(i->m_object.m_object, blobs[j], dx, dy));
+  }
+  return assoc->assign();
+}
+
+struct TbStats
+{
+  uint64_t m_ns;
+  uint32_t m_switches;
+  uint32_t m_starts;
+  uint32_t m_errors;
+  uint64_t m_reportedError;  // pixels, summed over the valid trackers
+  uint64_t m_predictedError;
+  uint32_t m_reports;
+};
+
+static int32_t centerX(const BlobA &blob)
+{
+  return (blob.m_left+blob.m_right)>>1;
+}
+
+static int32_t centerY(const BlobA &blob)
+{
+  return (blob.m_top+blob.m_bottom)>>1;
+}
+
+// how far the valid trackers are from their objects, which have moved a frame on
+static void measure(TrackerList *trackers, const TbObject *objects, TbStats *stats)
+{
+  SimpleListNode<Tracker<BlobA> > *i;
+  const TbObject *object;
+  int32_t x, y, dx, dy;
+
+  for (i=trackers->m_first; i!=NULL; i=i->m_next)
+  {
+    if (i->m_object.get()==NULL)
+      continue;
+    object = &objects[i->m_object.m_object.m_angle];
+    x = (object->m_x>>4) + (object->m_width>>1);
+    y = (object->m_y>>4) + (object->m_height>>1);
+    i->m_object.predict(&dx, &dy, BL_PERIOD);
+    stats->m_reportedError += abs(centerX(i->m_object.m_object) - x) + abs(centerY(i->m_object.m_object) - y);
+    stats->m_predictedError += abs(centerX(i->m_object.m_object) + dx - x) + abs(centerY(i->m_object.m_object) + dy - y);
+    stats->m_reports++;
+  }
+}
+
+// one frame of Blobs::handleBlobTracking(), with assoc or the old loop
+static void track(TrackerList *trackers, TrackAssociation<BlobA, BL_TRACKING_TRACKERS, MAX_BLOBS> *assoc, BlobA *blobs,
+  uint16_t numBlobs, uint8_t *index, TbStats *stats, bool prediction=false)
+{
+  SimpleListNode<Tracker<BlobA> > *i, *inext;
+  uint16_t j;
+  int16_t id;
+  uint64_t t;
+
+  for (j=0; j<numBlobs; j++)
+    blobs[j].m_tracker = NULL;
+  for (i=trackers->m_first; i!=NULL; i=i->m_next)
+  {
+    i->m_object.resetMin();
+    i->m_object.addTime(BL_PERIOD);
+  }
+
+  t = hostTimeNs();
+  if (assoc)
+    associate(assoc, trackers, blobs, numBlobs, prediction);
+  else
+    while(searchAndSwap(trackers, blobs, numBlobs));
+  stats->m_ns += hostTimeNs() - t;
+
+  for (i=trackers->m_first; i!=NULL; i=inext)
+  {
+    inext = i->m_next;
+    if (i->m_object.m_minVal!=TR_MAXVAL)
+    {
+      if (i->m_object.m_minObject->m_tracker!=&i->m_object)
+        stats->m_errors++;
+      i->m_object.motion(centerX(*i->m_object.m_minObject) - centerX(i->m_object.m_object),
+        centerY(*i->m_object.m_minObject) - centerY(i->m_object.m_object));
+      id = i->m_object.m_object.m_angle;
+      if (i->m_object.update()&TR_EVENT_INVALIDATED)
+        trackers->remove(i);
+      else if (i->m_object.m_object.m_angle!=id)
+        stats->m_switches++;
+    }
+    else if (i->m_object.update()&TR_EVENT_INVALIDATED)
+      trackers->remove(i);
+  }
+
+  for (j=0; j<numBlobs; j++)
+  {
+    if (blobs[j].m_tracker==NULL)
+    {
+      SimpleListNode<Tracker<BlobA> > *n;
+      n = trackers->add(Tracker<BlobA>(blobs[j], (*index)++, 0, 1000));
+      if (n==NULL)
+        break;
+      blobs[j].m_tracker = &n->m_object;
+      stats->m_starts++;
+    }
+  }
+}
+
+// spread over the frame, or a crowd of slow objects of one model, all in each other's gates
+static void initObjects(TbObject *objects, uint16_t numObjects, bool crowd)
+{
+  uint16_t i;
+
+  for (i=0; i<numObjects; i++)
+  {
+    objects[i].m_width = 6 + random32()%30;
+    objects[i].m_height = 6 + random32()%30;
+    if (crowd)
+    {
+      objects[i].m_x = (100 + random32()%80)<<4;
+      objects[i].m_y = (60 + random32()%80)<<4;
+      objects[i].m_vx = (int32_t)(random32()%7) - 3;
+      objects[i].m_vy = (int32_t)(random32()%7) - 3;
+      objects[i].m_model = 1;
+    }
+    else
+    {
+      objects[i].m_x = (random32()%(CAM_RES2_WIDTH-objects[i].m_width))<<4;
+      objects[i].m_y = (random32()%(CAM_RES2_HEIGHT-objects[i].m_height))<<4;
+      objects[i].m_vx = (int32_t)(random32()%97) - 48;
+      objects[i].m_vy = (int32_t)(random32()%97) - 48;
+      objects[i].m_model = 1 + random32()%3; // few models, so lots of crossings that matter
+    }
+  }
+}
+
+static void moveObjects(TbObject *objects, uint16_t numObjects)
+{
+  uint16_t i;
+
+  for (i=0; i<numObjects; i++)
+  {
+    objects[i].m_x += objects[i].m_vx;
+    objects[i].m_y += objects[i].m_vy;
+    if (objects[i].m_x<0 || objects[i].m_x>(CAM_RES2_WIDTH-objects[i].m_width)<<4)
+    {
+      objects[i].m_vx = -objects[i].m_vx;
+      objects[i].m_x += 2*objects[i].m_vx;
+    }
+    if (objects[i].m_y<0 || objects[i].m_y>(CAM_RES2_HEIGHT-objects[i].m_height)<<4)
+    {
+      objects[i].m_vy = -objects[i].m_vy;
+      objects[i].m_y += 2*objects[i].m_vy;
+    }
+  }
+}
+
+// noisy boxes of the objects in random order, about 1 in 20 missing
+static uint16_t detect(const TbObject *objects, uint16_t numObjects, BlobA *blobs)
+{
+  uint16_t i, j, n;
+  int32_t x, y;
+  BlobA temp;
+
+  for (i=0, n=0; i<numObjects; i++)
+  {
+    if (random32()%20==0)
+      continue;
+    x = (objects[i].m_x>>4) + (int32_t)(random32()%3) - 1;
+    y = (objects[i].m_y>>4) + (int32_t)(random32()%3) - 1;
+    x = x<0 ? 0 : x;
+    y = y<0 ? 0 : y;
+    blobs[n] = BlobA(objects[i].m_model, x, x + objects[i].m_width + random32()%3, y, y + objects[i].m_height + random32()%3);
+    blobs[n].m_angle = i;
+    n++;
+  }
+  for (i=n; i>1; i--)
+  {
+    j = random32()%i;
+    temp = blobs[i-1];
+    blobs[i-1] = blobs[j];
+    blobs[j] = temp;
+  }
+  return n;
+}
+
+static void usage()
+{
+  printf("usage: track_benchmark [-n frames] [-r passes]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  static TbObject objects[TB_MAX_OBJECTS];
+  static BlobA oldBlobs[MAX_BLOBS], newBlobs[MAX_BLOBS], predBlobs[MAX_BLOBS];
+  static TrackAssociation<BlobA, BL_TRACKING_TRACKERS, MAX_BLOBS> assoc;
+  uint32_t i, f, numFrames=TB_FRAMES, passes=TB_PASSES, pass, errors=0, seed;
+  uint16_t numObjects, numBlobs;
+  uint8_t oldIndex, newIndex, predIndex;
+  TbStats oldStats, newStats, predStats;
+  int c, crowd;
+  static const char *sceneNames[] = {"spread", "crowd"};
+
+  for (i=1; i<(uint32_t)argc; i++)
+  {
+    if (strcmp(argv[i], "-n")==0 && i+1<(uint32_t)argc)
+      numFrames = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-r")==0 && i+1<(uint32_t)argc)
+      passes = strtoul(argv[++i], NULL, 0);
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  for (crowd=0; crowd<2; crowd++)
+  {
+    for (c=0; c<TB_COUNTS; c++)
+    {
+      numObjects = g_counts[c];
+      memset(&oldStats, 0, sizeof(oldStats));
+      memset(&newStats, 0, sizeof(newStats));
+      memset(&predStats, 0, sizeof(predStats));
+      for (pass=0; pass<passes; pass++)
+      {
+        TrackerList oldTrackers, newTrackers, predTrackers;
+
+        seed = 0x85ebca6b + pass*0x9e3779b9 + c + crowd*TB_COUNTS;
+        g_rand = seed;
+        initObjects(objects, numObjects, crowd);
+        oldIndex = newIndex = predIndex = 0;
+        for (f=0; f<numFrames; f++)
+        {
+          moveObjects(objects, numObjects);
+          measure(&predTrackers, objects, &predStats);
+          numBlobs = detect(objects, numObjects, oldBlobs);
+          memcpy(newBlobs, oldBlobs, sizeof(oldBlobs));
+          memcpy(predBlobs, oldBlobs, sizeof(oldBlobs));
+          track(&oldTrackers, NULL, oldBlobs, numBlobs, &oldIndex, &oldStats);
+          track(&newTrackers, &assoc, newBlobs, numBlobs, &newIndex, &newStats);
+          track(&predTrackers, &assoc, predBlobs, numBlobs, &predIndex, &predStats, true);
+        }
+      }
+      errors += oldStats.m_errors + newStats.m_errors + predStats.m_errors;
+
+      printf("%u objects, %s: %u frames x %u passes\n", numObjects, sceneNames[crowd], numFrames, passes);
+      printf("  %-22s %9.2f us/frame %7u ID switches %7u new trackers\n", "search and swap",
+             oldStats.m_ns/1e3/numFrames/passes, oldStats.m_switches, oldStats.m_starts);
+      printf("  %-22s %9.2f us/frame %7u ID switches %7u new trackers\n", "TrackAssociation",
+             newStats.m_ns/1e3/numFrames/passes, newStats.m_switches, newStats.m_starts);
+      printf("  %-22s %9.2f us/frame %7u ID switches %7u new trackers\n", "predicted",
+             predStats.m_ns/1e3/numFrames/passes, predStats.m_switches, predStats.m_starts);
+      if (predStats.m_reports)
+        printf("  %-22s %9.2f pixels reported %9.2f pixels predicted\n", "error a frame later",
+               (double)predStats.m_reportedError/predStats.m_reports, (double)predStats.m_predictedError/predStats.m_reports);
+    }
+  }
+
+  if (errors)
+    printf("%u errors\n", errors);
+  return errors ? 1 : 0;
+}
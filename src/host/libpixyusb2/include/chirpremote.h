@@ -0,0 +1,212 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+// Typed handles for procedures on the other end of a Chirp link.  The procedure is looked up
+// once, and its argument types are template arguments, so a call needs no name lookup and the
+// CRP_* type codes always agree with the values passed:
+//
+//   ChirpRemote<ChirpArgs<uint32_t> > ledSet;    // sends one uint32_t, receives the int32_t result
+//   int32_t response;
+//
+//   ledSet.resolve(chirp, "led_set");
+//   ledSet.call(0x00ff00, &response);
+//
+// Sent values are given first, then pointers for the received values, starting with the result.
+// The types can be int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, float, const char *
+// (string) and ChirpArray<> of the integer types or float -- anything else won't compile.
+// Received values are checked against the types Pixy actually sent, and the call fails with
+// CRP_RES_ERROR_PARSE if they don't match.  Received strings and arrays point into Chirp's
+// receive buffer, which is valid until the next call.
+
+#ifndef _CHIRPREMOTE_H
+#define _CHIRPREMOTE_H
+
+#include "chirp.hpp"
+
+template <typename T> struct ChirpArray
+{
+  ChirpArray() : m_len(0), m_data(NULL) {}
+  ChirpArray(uint32_t len, const T *data) : m_len(len), m_data(data) {}
+
+  uint32_t m_len;
+  const T *m_data;
+};
+
+template <typename... Types> struct ChirpArgs
+{
+};
+
+// type code of a received value, as we'd declare it
+static inline uint8_t chirpRemoteType(const void *arg)
+{
+  uint8_t type = Chirp::getType(arg);
+
+  if (type==CRP_TYPE_HINT) // 32-bit type hint, e.g. a fourcc
+    return CRP_INT32;
+  return type&~CRP_HINT;
+}
+
+template <typename... Flat> struct ChirpFlat;
+
+// Each supported type knows its code, how to add itself to the arguments of Chirp::call(),
+// and how to pick itself out of the received values.  There's no generic ChirpType<T>, so
+// unsupported types don't compile.
+template <typename T> struct ChirpType;
+
+template <typename T, uint8_t Code, typename Passed> struct ChirpScalar
+{
+  typedef Passed Element; // arrays of scalars are allowed
+  enum {code = Code};
+
+  template <typename... Flat> struct Add
+  {
+    template <typename... Rest>
+    static int call(Chirp *chirp, ChirpProc proc, void **recvArgs, Flat... flat, const T &arg, const Rest &... rest)
+    {
+      return ChirpFlat<Flat..., int, Passed>::call(chirp, proc, recvArgs, flat..., (int)Code, (Passed)arg, rest...);
+    }
+  };
+
+  static int get(void **recvArgs, int i, T *val)
+  {
+    if (i<0 || recvArgs[i]==NULL || chirpRemoteType(recvArgs[i])!=Code)
+      return CRP_RES_ERROR_PARSE;
+    *val = *(T *)recvArgs[i];
+    return i+1;
+  }
+};
+
+template <> struct ChirpType<int8_t> : ChirpScalar<int8_t, CRP_INT8, int> {};
+template <> struct ChirpType<uint8_t> : ChirpScalar<uint8_t, CRP_UINT8, int> {};
+template <> struct ChirpType<int16_t> : ChirpScalar<int16_t, CRP_INT16, int> {};
+template <> struct ChirpType<uint16_t> : ChirpScalar<uint16_t, CRP_UINT16, int> {};
+template <> struct ChirpType<int32_t> : ChirpScalar<int32_t, CRP_INT32, int32_t> {};
+template <> struct ChirpType<uint32_t> : ChirpScalar<uint32_t, CRP_UINT32, uint32_t> {};
+template <> struct ChirpType<float> : ChirpScalar<float, CRP_FLT32, double> {};
+
+template <> struct ChirpType<const char *>
+{
+  enum {code = CRP_STRING};
+
+  template <typename... Flat> struct Add
+  {
+    template <typename... Rest>
+    static int call(Chirp *chirp, ChirpProc proc, void **recvArgs, Flat... flat, const char *arg, const Rest &... rest)
+    {
+      return ChirpFlat<Flat..., int, const char *>::call(chirp, proc, recvArgs, flat..., (int)CRP_STRING, arg, rest...);
+    }
+  };
+
+  static int get(void **recvArgs, int i, const char **val)
+  {
+    if (i<0 || recvArgs[i]==NULL || chirpRemoteType(recvArgs[i])!=CRP_STRING)
+      return CRP_RES_ERROR_PARSE;
+    *val = (const char *)recvArgs[i];
+    return i+1;
+  }
+};
+
+template <typename T> struct ChirpType<ChirpArray<T> >
+{
+  typedef typename ChirpType<T>::Element Scalar; // only arrays of scalars compile
+  enum {code = ChirpType<T>::code | CRP_ARRAY};
+
+  template <typename... Flat> struct Add
+  {
+    template <typename... Rest>
+    static int call(Chirp *chirp, ChirpProc proc, void **recvArgs, Flat... flat, const ChirpArray<T> &arg, const Rest &... rest)
+    {
+      return ChirpFlat<Flat..., int, uint32_t, const T *>::call(chirp, proc, recvArgs, flat..., (int)code, arg.m_len, arg.m_data, rest...);
+    }
+  };
+
+  // arrays are received as two values, length and data
+  static int get(void **recvArgs, int i, ChirpArray<T> *val)
+  {
+    if (i<0 || recvArgs[i]==NULL || recvArgs[i+1]==NULL || chirpRemoteType(recvArgs[i])!=code)
+      return CRP_RES_ERROR_PARSE;
+    val->m_len = *(uint32_t *)recvArgs[i];
+    val->m_data = (const T *)recvArgs[i+1];
+    return i+2;
+  }
+};
+
+// Adds the sent values to the argument list of Chirp::call() one at a time (Flat is what's been
+// added so far), then makes the call.
+template <typename... Flat> struct ChirpFlat
+{
+  static int call(Chirp *chirp, ChirpProc proc, void **recvArgs, Flat... flat)
+  {
+    return chirp->callSyncArray(proc, flat..., END_OUT_ARGS, recvArgs, END_IN_ARGS);
+  }
+
+  template <typename T, typename... Rest>
+  static int call(Chirp *chirp, ChirpProc proc, void **recvArgs, Flat... flat, const T &arg, const Rest &... rest)
+  {
+    return ChirpType<T>::template Add<Flat...>::call(chirp, proc, recvArgs, flat..., arg, rest...);
+  }
+};
+
+template <typename Out, typename In=ChirpArgs<int32_t> > class ChirpRemote;
+
+template <typename... Out, typename... In> class ChirpRemote<ChirpArgs<Out...>, ChirpArgs<In...> >
+{
+public:
+  ChirpRemote()
+  {
+    m_chirp = NULL;
+    m_proc = -1;
+  }
+
+  int resolve(Chirp *chirp, const char *procName)
+  {
+    set(chirp, chirp->getProc(procName));
+    return m_proc<0 ? CRP_RES_ERROR_INVALID_COMMAND : CRP_RES_OK;
+  }
+
+  // for procs that were already looked up
+  void set(Chirp *chirp, ChirpProc proc)
+  {
+    m_chirp = chirp;
+    m_proc = proc;
+  }
+
+  bool resolved()
+  {
+    return m_chirp!=NULL && m_proc>=0;
+  }
+
+  int call(const Out &... out, In *... in)
+  {
+    int i, res;
+    void *recvArgs[CRP_MAX_ARGS+1];
+
+    if (!resolved())
+      return CRP_RES_ERROR_INVALID_COMMAND;
+    if ((res=ChirpFlat<>::call(m_chirp, m_proc, recvArgs, out...))<0)
+      return res;
+
+    // pick out the received values in order, the first failure sticks
+    i = 0;
+    int unused[] = {0, (i = ChirpType<In>::get(recvArgs, i, in))...};
+    (void)unused;
+    return i<0 ? i : CRP_RES_OK;
+  }
+
+private:
+  Chirp *m_chirp;
+  ChirpProc m_proc;
+};
+
+#endif
@@ -0,0 +1,79 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef _FRAMEQUEUE_H
+#define _FRAMEQUEUE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define FRAMEQUEUE_MAX_DEPTH            16
+
+// what to do when a frame arrives and the queue is full
+#define FRAMEQUEUE_DROP_OLDEST          0x00 // replace the oldest queued frame (lowest latency)
+#define FRAMEQUEUE_DROP_NEWEST          0x01 // discard the frame that just arrived (no gaps in what's queued)
+
+#define FRAMEQUEUE_RESULT_OK            0
+#define FRAMEQUEUE_RESULT_ERROR         -1
+#define FRAMEQUEUE_RESULT_TIMEOUT       -2
+#define FRAMEQUEUE_RESULT_CLOSED        -3
+#define FRAMEQUEUE_RESULT_DROPPED       -4
+
+struct Pixy2Frame
+{
+  uint32_t m_fourcc;      // e.g. FOURCC('B','A','8','1') for raw Bayer
+  uint8_t m_renderFlags;
+  uint16_t m_width;
+  uint16_t m_height;
+  uint32_t m_length;
+  uint8_t *m_data;
+  uint32_t m_index;       // increments with every frame received, including dropped ones
+};
+
+// Bounded, thread-safe queue of frames.  push() copies the frame into a preallocated slot,
+// pop() hands the consumer a slot by swapping it out of the ring, so the frame pop() returns
+// stays valid until the next pop() (or close()).
+class FrameQueue
+{
+public:
+    FrameQueue();
+    ~FrameQueue();
+
+    int open(uint8_t depth, uint8_t policy);
+    void close();
+
+    int push(uint32_t fourcc, uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t length, const uint8_t *data);
+    int pop(Pixy2Frame **frame, uint16_t timeoutMs);
+    uint32_t dropped();
+
+private:
+    int reserve(Pixy2Frame *frame, uint32_t length);
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    Pixy2Frame m_frames[FRAMEQUEUE_MAX_DEPTH+1];
+    uint32_t m_bufSizes[FRAMEQUEUE_MAX_DEPTH+1];
+    Pixy2Frame *m_slots[FRAMEQUEUE_MAX_DEPTH];
+    Pixy2Frame *m_out;
+    uint8_t m_depth;
+    uint8_t m_policy;
+    uint8_t m_head;
+    uint8_t m_count;
+    uint32_t m_index;
+    uint32_t m_dropped;
+    bool m_open;
+};
+
+#endif
@@ -19,18 +19,68 @@
 #include <stdio.h>
 #include "../../../common/inc/chirp.hpp"
 
-#define RBUF_LEN      0x200
+// Pixy sends responses of up to 0x600 bytes if we ask, which Link2USB splits back 
+// into packets of up to 0xff bytes (4-byte header each) for TPixy2.
+#define PIXY_BUFFERSIZE         0x604
+#define RBUF_LEN                0x800
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "usblink.h"
+#include "framequeue.h"
+#include "chirpremote.h"
 #include "util.h"
 #include "TPixy2.h"
 
 #define PIXY2_RAW_FRAME_WIDTH   316
 #define PIXY2_RAW_FRAME_HEIGHT  208
 
+// flags for the init()/open() argument
+#define LINK2USB_ARG_ASYNC      0x01 // keep several bulk reads in flight (see USBLINK_MODE_ASYNC)
+
+#define LINK2USB_STREAM_DEPTH   4 // default number of frames queued by startStream()
+#define LINK2USB_STOP_POLL_MAX  16 // longest wait (ms) between polls in stop()
+#define LINK2USB_SERVICE_WAIT   100 // longest wait (ms) for data before the service thread checks stopStream()
+#define LINK2USB_SERVICE_POLL   4   // how long (ms) the service thread holds m_chirp waiting for data in sync mode
+#define LINK2USB_MAX_DEVICES    16
+#define LINK2USB_PROC_CACHE     16 // number of procs callChirp() remembers
+#define LINK2USB_PROC_NAME      32 // longest proc name callChirp() remembers
+
+// a proc looked up by callChirp()
+struct Link2USBProc
+{
+  char m_name[LINK2USB_PROC_NAME];
+  ChirpProc m_proc;
+};
+
+// an attached Pixy, as returned by Link2USB::enumerate()
+struct Pixy2Device
+{
+  uint32_t m_uid;                 // 0 if it couldn't be queried (e.g. it's open in another process)
+  char m_path[USBLINK_MAX_PATH];  // USB bus and ports, e.g. "1-2.4"
+};
+
+typedef void (*Link2USBFrameCallback)(const Pixy2Frame *frame, void *data);
+
+// Chirp that can tell Pixy it wants the frames (and other hint data) it sends to PixyMon
+// while the program is running, and queues the frames as they arrive
+class Chirp2USB : public Chirp
+{
+public:
+  Chirp2USB();
+
+  int setHinterested(bool hinterested);
+  void setQueue(FrameQueue *queue);
+
+protected:
+  virtual void handleXdata(const void *data[]);
+
+private:
+  FrameQueue *m_queue;
+};
+
 class Link2USB
 {
 public:
@@ -39,26 +89,120 @@ public:
   
   int8_t open (uint32_t arg);
   void close ();
+
+  // multiple Pixys -- select the device for the next open()/init() by UID (see enumerate()) or
+  // by USB path.  Without either, the first Pixy found is opened.  Each open Link2USB can be
+  // used from its own thread, the async links share one libusb event thread.
+  static int enumerate (Pixy2Device *devices, uint8_t maxDevices);
+  void setUID (uint32_t uid);
+  void setPath (const char *path);
+  uint32_t getUID ();
+  const char *getPath ();
     
   int16_t recv (uint8_t *buf, uint8_t len, uint16_t *cs=NULL);
   int16_t send (uint8_t *buf, uint8_t len);
   
   int callChirp (const char *func, ...);
   int callChirp (const char *func, va_list  args);
+  // typed calls (see chirpremote.h) -- resolve the proc once after open()/init(), then call
+  // it without a name lookup, e.g.
+  //   ChirpRemote<ChirpArgs<uint32_t> > ledSet;
+  //   pixy.m_link.resolve(ledSet, "led_set");
+  //   pixy.m_link.callRemote(ledSet, 0x00ff00, &response);
+  template <typename Remote> int resolve (Remote &remote, const char *func);
+  template <typename Remote, typename... Args> int callRemote (Remote &remote, Args... args);
+  // pipelined calls -- issueChirp() returns a tag to pass to collectChirp().  Several calls
+  // can be issued before collecting (open with LINK2USB_ARG_ASYNC so the firmware can pipeline).
+  int issueChirp (const char *func, ...);
+  int collectChirp (uint8_t tag, ...);
   int stop();
   int resume();
   int getRawFrame(uint8_t **bayerFrame);
+  // zero-copy (LINK2USB_ARG_ASYNC) -- keep the buffer the last response was received into,
+  // e.g. the frame from getRawFrame(), until releaseBuffer() instead of the next call
+  uint8_t *keepBuffer();
+  void releaseBuffer(uint8_t *buf);
+  // frame streaming -- frames are received on a background thread while the program keeps
+  // running (unlike stop()/getRawFrame()).  With a callback, it's called on another background
+  // thread for each frame, otherwise getFrame() returns the next queued frame, which stays valid
+  // until the next getFrame() or stopStream().  When the queue is full, policy decides which
+  // frame is dropped (FRAMEQUEUE_DROP_OLDEST or FRAMEQUEUE_DROP_NEWEST).  Open with
+  // LINK2USB_ARG_ASYNC to keep up with the full frame rate.  Pixy only sends frames when the
+  // program renders video (e.g. the default "Blocks, video" view of color_connected_components).
+  // While streaming, the service thread can receive into the buffer that array/string results of
+  // callChirp() point to, so copy them before the next call.
+  int startStream(uint8_t depth=LINK2USB_STREAM_DEPTH, uint8_t policy=FRAMEQUEUE_DROP_OLDEST,
+                  Link2USBFrameCallback callback=NULL, void *data=NULL);
+  int getFrame(Pixy2Frame **frame, uint16_t timeoutMs=0);
+  int stopStream();
+  uint32_t droppedFrames();
   
 private:
-  Chirp *m_chirp;
+  int8_t openPath(const char *path, uint8_t mode);
+  ChirpProc getProc(const char *func);
+  void acquire(bool priority=true);
+  void release();
+  static void *serviceThread(void *arg);
+  static void *deliverThread(void *arg);
+
+  Chirp2USB *m_chirp;
   USBLink *m_link;
   ChirpProc m_packet;
+  Link2USBProc m_procs[LINK2USB_PROC_CACHE];
+  uint8_t m_numProcs;
+  uint8_t m_nextProc;
+  ChirpRemote<ChirpArgs<> > m_stopProc;
+  ChirpRemote<ChirpArgs<> > m_runProc;
+  ChirpRemote<ChirpArgs<>, ChirpArgs<int32_t, const char *> > m_runningProc;
+  ChirpRemote<ChirpArgs<uint8_t, uint16_t, uint16_t, uint16_t, uint16_t>,
+              ChirpArgs<int32_t, uint32_t, uint8_t, uint16_t, uint16_t, ChirpArray<uint8_t> > > m_getFrameProc;
   uint8_t m_rbuf[RBUF_LEN];
   uint16_t m_rbufIndex;
   uint16_t m_rbufLen;
   bool m_stopped;
+  uint32_t m_uid;
+  char m_path[USBLINK_MAX_PATH];
+
+  // the service thread and callers share m_chirp, callers go first (see acquire())
+  pthread_mutex_t m_lockMutex;
+  pthread_cond_t m_lockCond;
+  bool m_busy;
+  uint32_t m_waiting;
+
+  FrameQueue m_queue;
+  bool m_streaming;
+  bool m_streamStopping;
+  pthread_t m_serviceThread;
+  pthread_t m_deliverThread;
+  Link2USBFrameCallback m_callback;
+  void *m_callbackData;
 };
 
+template <typename Remote> int Link2USB::resolve(Remote &remote, const char *func)
+{
+  ChirpProc proc;
+
+  if (m_chirp==NULL)
+    return CRP_RES_ERROR_NOT_CONNECTED;
+  acquire();
+  proc = getProc(func);
+  remote.set(m_chirp, proc);
+  release();
+
+  return proc<0 ? CRP_RES_ERROR_INVALID_COMMAND : CRP_RES_OK;
+}
+
+template <typename Remote, typename... Args> int Link2USB::callRemote(Remote &remote, Args... args)
+{
+  int res;
+
+  acquire();
+  res = remote.call(args...);
+  release();
+
+  return res;
+}
+
 typedef TPixy2<Link2USB> Pixy2;
 
 #endif
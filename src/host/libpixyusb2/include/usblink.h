@@ -16,9 +16,49 @@
 #ifndef _USBLINK_H
 #define _USBLINK_H
 
+#include <pthread.h>
 #include "link.h"
 #include <libusb.h>
 
+// link modes
+#define USBLINK_MODE_SYNC               0x00 // one blocking libusb_bulk_transfer per receive()
+#define USBLINK_MODE_ASYNC              0x01 // ring of bulk-IN transfers kept in flight by an event thread
+
+// async mode configuration
+#define USBLINK_ASYNC_TRANSFERS         8
+#define USBLINK_ASYNC_TRANSFER_SIZE     0x20000 // big enough to receive a raw frame in one transfer (see getBuffer())
+// transfers are queued without a timeout, and a short packet completes the one that's receiving.
+// If receive() has found nothing after this many milliseconds, only that transfer is cancelled to
+// flush what it has, so a payload that happens to be a multiple of the packet size isn't held back.
+#define USBLINK_ASYNC_FLUSH_TIMEOUT     10
+#define USBLINK_ASYNC_EVENT_TIMEOUT     100
+
+#define USBLINK_POLL_TIMEOUT            100 // default for what a receive timeout of 0 means (see setPollTimeout())
+
+#define USBLINK_MAX_PATH                32 // "bus-port.port...", e.g. "1-2.4"
+#define USBLINK_MAX_PORTS               7  // USB 3.0 allows a chain of 7 hubs
+
+
+// All USBLinks share one libusb context, and the async links share one event thread, so
+// several Pixys can be serviced from one process without a libusb thread per camera.
+class USBContext
+{
+public:
+    static libusb_context *acquire();
+    static void release();
+    static int startEvents();
+    static void stopEvents();
+
+private:
+    static void *eventThread(void *arg);
+
+    static pthread_mutex_t s_mutex;
+    static libusb_context *s_context;
+    static uint32_t s_refs;
+    static uint32_t s_eventRefs;
+    static volatile bool s_eventsRunning;
+    static pthread_t s_eventThread;
+};
 
 class USBLink : public Link
 {
@@ -26,18 +66,65 @@ public:
     USBLink();
     virtual ~USBLink();
 
-    int open();
+    // path selects the device by its USB path (see enumerate()), NULL opens the first Pixy found
+    int open(uint8_t mode=USBLINK_MODE_SYNC, const char *path=NULL);
     void close();
+    const char *getPath();
+    // list the USB paths of the attached Pixys, returns how many there are
+    static int enumerate(char paths[][USBLINK_MAX_PATH], uint8_t maxDevices);
     virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
     virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
     virtual void setTimer();
     virtual uint32_t getTimer();
+    virtual int getBuffer(uint8_t **buf, uint32_t *len, uint16_t timeoutMs=0);
+    virtual void releaseBuffer(uint8_t *buf);
+    // Chirp passes a timeout of 0 when it only wants to see if anything has arrived
+    void setPollTimeout(uint16_t timeoutMs);
+    // wait until receive() has data without taking any of it, returns 0 when it does.  Only async
+    // mode can tell, sync mode returns 0 right away.
+    int waitReceive(uint16_t timeoutMs);
 
 private:
-    int openDevice();
+    int openDevice(const char *path);
+    static void devicePath(libusb_device *device, char *path);
+
+    int startAsync();
+    void stopAsync();
+    int receiveAsync(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    int waitCompleted(uint16_t timeoutMs);
+    void flushActive();
+    void consume(uint32_t len);
+    int submitTransfer(uint8_t index);
+    static void LIBUSB_CALL transferCallback(libusb_transfer *transfer);
+
     libusb_context *m_context;
     libusb_device_handle *m_handle;
     uint32_t m_timer;
+    uint16_t m_pollTimeout;
+    char m_path[USBLINK_MAX_PATH];
+
+    // async state -- everything below is guarded by m_mutex
+    uint8_t m_mode;
+    bool m_eventsRunning; // we hold a reference to the shared event thread
+    bool m_stopping;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    libusb_transfer *m_transfers[USBLINK_ASYNC_TRANSFERS];
+    uint8_t *m_transferBufs[USBLINK_ASYNC_TRANSFERS]; // LINK_BUFFER_HEADROOM bytes, then the transfer buffer
+    bool m_transferActive[USBLINK_ASYNC_TRANSFERS];
+    uint8_t m_transferLeases[USBLINK_ASYNC_TRANSFERS]; // getBuffer() leases outstanding -- resubmit when 0
+    bool m_transferDrained[USBLINK_ASYNC_TRANSFERS];
+    bool m_transferEnded[USBLINK_ASYNC_TRANSFERS]; // ended on a short packet -- receive() stops there, like a bulk read
+    int m_maxPacket; // of the IN endpoint
+    uint32_t m_transferSeq[USBLINK_ASYNC_TRANSFERS]; // when it was submitted -- the oldest in flight is the one receiving
+    uint32_t m_submitSeq;
+    uint8_t m_activeCount;
+    // completed transfers, in completion order (which is also submission order for a single endpoint)
+    uint8_t m_completed[USBLINK_ASYNC_TRANSFERS];
+    uint8_t m_completedHead;
+    uint8_t m_completedCount;
+    uint32_t m_completedOffset; // bytes already consumed from the transfer at m_completedHead
+    int m_asyncError;
 };
 #endif
 
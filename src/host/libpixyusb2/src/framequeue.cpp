@@ -0,0 +1,204 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <new>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include "framequeue.h"
+
+FrameQueue::FrameQueue()
+{
+    int i;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+    for (i=0; i<FRAMEQUEUE_MAX_DEPTH+1; i++)
+    {
+        memset(&m_frames[i], 0, sizeof(Pixy2Frame));
+        m_bufSizes[i] = 0;
+    }
+    m_out = NULL;
+    m_depth = 0;
+    m_policy = FRAMEQUEUE_DROP_OLDEST;
+    m_head = 0;
+    m_count = 0;
+    m_index = 0;
+    m_dropped = 0;
+    m_open = false;
+}
+
+FrameQueue::~FrameQueue()
+{
+    int i;
+
+    close();
+    for (i=0; i<FRAMEQUEUE_MAX_DEPTH+1; i++)
+        delete [] m_frames[i].m_data;
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int FrameQueue::open(uint8_t depth, uint8_t policy)
+{
+    int i;
+
+    if (depth==0 || depth>FRAMEQUEUE_MAX_DEPTH)
+        return FRAMEQUEUE_RESULT_ERROR;
+
+    pthread_mutex_lock(&m_mutex);
+    // the extra frame is the one the consumer is holding
+    for (i=0; i<depth; i++)
+        m_slots[i] = &m_frames[i];
+    m_out = &m_frames[depth];
+    m_depth = depth;
+    m_policy = policy;
+    m_head = 0;
+    m_count = 0;
+    m_index = 0;
+    m_dropped = 0;
+    m_open = true;
+    pthread_mutex_unlock(&m_mutex);
+
+    return FRAMEQUEUE_RESULT_OK;
+}
+
+void FrameQueue::close()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_open = false;
+    m_count = 0;
+    pthread_cond_broadcast(&m_cond); // wake up anyone waiting in pop()
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// make sure frame can hold length bytes -- the buffers only grow, so we allocate once per slot
+int FrameQueue::reserve(Pixy2Frame *frame, uint32_t length)
+{
+    uint32_t index = frame - m_frames;
+
+    if (m_bufSizes[index]<length)
+    {
+        delete [] frame->m_data;
+        frame->m_data = new (std::nothrow) uint8_t[length];
+        if (frame->m_data==NULL)
+        {
+            m_bufSizes[index] = 0;
+            return FRAMEQUEUE_RESULT_ERROR;
+        }
+        m_bufSizes[index] = length;
+    }
+    return FRAMEQUEUE_RESULT_OK;
+}
+
+int FrameQueue::push(uint32_t fourcc, uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t length, const uint8_t *data)
+{
+    Pixy2Frame *frame;
+
+    pthread_mutex_lock(&m_mutex);
+    if (!m_open)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return FRAMEQUEUE_RESULT_CLOSED;
+    }
+    m_index++;
+    if (m_count==m_depth)
+    {
+        m_dropped++;
+        if (m_policy==FRAMEQUEUE_DROP_NEWEST)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return FRAMEQUEUE_RESULT_DROPPED;
+        }
+        // drop oldest
+        m_head = (m_head+1)%m_depth;
+        m_count--;
+    }
+
+    frame = m_slots[(m_head+m_count)%m_depth];
+    if (reserve(frame, length)<0)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return FRAMEQUEUE_RESULT_ERROR;
+    }
+    frame->m_fourcc = fourcc;
+    frame->m_renderFlags = renderFlags;
+    frame->m_width = width;
+    frame->m_height = height;
+    frame->m_length = length;
+    frame->m_index = m_index-1;
+    memcpy(frame->m_data, data, length);
+    m_count++;
+
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    return FRAMEQUEUE_RESULT_OK;
+}
+
+int FrameQueue::pop(Pixy2Frame **frame, uint16_t timeoutMs)
+{
+    Pixy2Frame *out;
+    struct timeval now;
+    struct timespec deadline;
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec = now.tv_sec + timeoutMs/1000;
+    deadline.tv_nsec = now.tv_usec*1000 + (timeoutMs%1000)*1000000;
+    if (deadline.tv_nsec>=1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_count==0)
+    {
+        if (!m_open)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return FRAMEQUEUE_RESULT_CLOSED;
+        }
+        if (timeoutMs==0) // 0 equals infinity
+            pthread_cond_wait(&m_cond, &m_mutex);
+        else if (pthread_cond_timedwait(&m_cond, &m_mutex, &deadline)==ETIMEDOUT && m_count==0)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return FRAMEQUEUE_RESULT_TIMEOUT;
+        }
+    }
+
+    // swap the head slot with the one the consumer was holding
+    out = m_slots[m_head];
+    m_slots[m_head] = m_out;
+    m_out = out;
+    m_head = (m_head+1)%m_depth;
+    m_count--;
+    *frame = out;
+    pthread_mutex_unlock(&m_mutex);
+
+    return FRAMEQUEUE_RESULT_OK;
+}
+
+uint32_t FrameQueue::dropped()
+{
+    uint32_t dropped;
+
+    pthread_mutex_lock(&m_mutex);
+    dropped = m_dropped;
+    pthread_mutex_unlock(&m_mutex);
+
+    return dropped;
+}
@@ -1,40 +1,203 @@
+#include <unistd.h>
 #include "libpixyusb2.h"
 
+Chirp2USB::Chirp2USB() : Chirp(false, true)
+{
+  m_queue = NULL;
+}
+
+int Chirp2USB::setHinterested(bool hinterested)
+{
+  // Pixy decides whether to send us xdata when we init, so init again
+  m_hinterested = hinterested;
+  return remoteInit(true);
+}
+
+void Chirp2USB::setQueue(FrameQueue *queue)
+{
+  m_queue = queue;
+}
+
+void Chirp2USB::handleXdata(const void *data[])
+{
+  int n;
+
+  if (m_queue==NULL || data[0]==NULL || getType(data[0])!=CRP_TYPE_HINT)
+    return;
+
+  // frames look like cam_sendFrame(): fourcc, renderFlags, width, height, length, pixels
+  for (n=0; data[n]!=NULL; n++);
+  if (n!=6 || getType(data[4])!=CRP_UINTS8)
+    return;
+
+  m_queue->push(*(uint32_t *)data[0], *(uint8_t *)data[1], *(uint16_t *)data[2], *(uint16_t *)data[3],
+                *(uint32_t *)data[4], (uint8_t *)data[5]);
+}
+
 Link2USB::Link2USB()
 {
   m_link = NULL;
   m_chirp = NULL;
+  m_numProcs = m_nextProc = 0;
   m_stopped = false;
+  m_uid = 0;
+  m_path[0] = '\0';
+  pthread_mutex_init(&m_lockMutex, NULL);
+  pthread_cond_init(&m_lockCond, NULL);
+  m_busy = false;
+  m_waiting = 0;
+  m_streaming = false;
+  m_streamStopping = false;
+  m_callback = NULL;
+  m_callbackData = NULL;
 }
 
 Link2USB::~Link2USB()
 {
   close();
+  pthread_cond_destroy(&m_lockCond);
+  pthread_mutex_destroy(&m_lockMutex);
 }
   
 int8_t Link2USB::open(uint32_t arg)
 {
-  int8_t res;
+  int i, count;
+  uint8_t mode = USBLINK_MODE_SYNC;
+  char paths[LINK2USB_MAX_DEVICES][USBLINK_MAX_PATH];
 
   if (m_link!=NULL)
     return -1;
 
+  if (arg!=PIXY_DEFAULT_ARGVAL && (arg&LINK2USB_ARG_ASYNC))
+    mode = USBLINK_MODE_ASYNC;
+
+  if (m_uid==0)
+    return openPath(m_path[0] ? m_path : NULL, mode);
+
+  // the UID is only known to the firmware, so we need to open each Pixy and ask
+  count = USBLink::enumerate(paths, LINK2USB_MAX_DEVICES);
+  for (i=0; i<count; i++)
+  {
+    if (openPath(paths[i], mode)==0 && getUID()==m_uid)
+      return 0;
+    close();
+  }
+  return -1;
+}
+
+int8_t Link2USB::openPath(const char *path, uint8_t mode)
+{
+  int8_t res;
+
   m_link = new USBLink();
-  res = m_link->open();
+  res = m_link->open(mode, path);
   if (res<0)
     return res;
-  m_chirp = new Chirp(false, true);
+  m_chirp = new Chirp2USB();
   res = m_chirp->setLink(m_link);
   if (res<0)
     return res;
+  if (mode==USBLINK_MODE_ASYNC)
+    m_chirp->setZeroCopy(true);
+  m_numProcs = m_nextProc = 0;
   m_packet = m_chirp->getProc("ser_packet");
   if (m_packet<0)
     return -1;
+  // procs we call a lot -- if the firmware doesn't have one, calling it fails like callChirp() would
+  m_stopProc.set(m_chirp, getProc("stop"));
+  m_runProc.set(m_chirp, getProc("run"));
+  m_runningProc.set(m_chirp, getProc("running"));
+  m_getFrameProc.set(m_chirp, getProc("cam_getFrame"));
   return 0;
 }
+
+// Remote procs don't change while we're connected, so look each one up once.  Chirp::getProc()
+// asks Pixy every time.
+ChirpProc Link2USB::getProc(const char *func)
+{
+  int i;
+  ChirpProc proc;
+
+  for (i=0; i<m_numProcs; i++)
+  {
+    if (strcmp(m_procs[i].m_name, func)==0)
+      return m_procs[i].m_proc;
+  }
+
+  proc = m_chirp->getProc(func);
+  if (proc<0 || strlen(func)>=LINK2USB_PROC_NAME)
+    return proc;
+
+  // replace the oldest entry when we're full
+  if (m_numProcs<LINK2USB_PROC_CACHE)
+    i = m_numProcs++;
+  else
+  {
+    i = m_nextProc;
+    m_nextProc = (m_nextProc+1)%LINK2USB_PROC_CACHE;
+  }
+  strcpy(m_procs[i].m_name, func);
+  m_procs[i].m_proc = proc;
+  return proc;
+}
 	
+int Link2USB::enumerate(Pixy2Device *devices, uint8_t maxDevices)
+{
+  int i, count;
+  char paths[LINK2USB_MAX_DEVICES][USBLINK_MAX_PATH];
+  Link2USB link;
+
+  count = USBLink::enumerate(paths, maxDevices<LINK2USB_MAX_DEVICES ? maxDevices : LINK2USB_MAX_DEVICES);
+  for (i=0; i<count; i++)
+  {
+    strcpy(devices[i].m_path, paths[i]);
+    link.setPath(paths[i]);
+    devices[i].m_uid = link.open(PIXY_DEFAULT_ARGVAL)==0 ? link.getUID() : 0;
+    link.close();
+  }
+  return count;
+}
+
+void Link2USB::setUID(uint32_t uid)
+{
+  m_uid = uid;
+}
+
+void Link2USB::setPath(const char *path)
+{
+  if (path==NULL)
+    m_path[0] = '\0';
+  else
+  {
+    strncpy(m_path, path, USBLINK_MAX_PATH-1);
+    m_path[USBLINK_MAX_PATH-1] = '\0';
+  }
+}
+
+uint32_t Link2USB::getUID()
+{
+  int32_t res, response;
+
+  if (m_link==NULL)
+    return 0;
+  res = callChirp("getUID", END_OUT_ARGS, &response, END_IN_ARGS);
+  if (res<0)
+    return 0;
+  return response;
+}
+
+const char *Link2USB::getPath()
+{
+  return m_link ? m_link->getPath() : m_path;
+}
+
 void Link2USB::close()
 {
+  stopStream();
+  m_stopProc.set(NULL, -1);
+  m_runProc.set(NULL, -1);
+  m_runningProc.set(NULL, -1);
+  m_getFrameProc.set(NULL, -1);
   if (m_chirp)
   {
     delete m_chirp;
@@ -67,21 +230,41 @@ int16_t Link2USB::send(uint8_t *buf, uint8_t len)
   uint32_t length;
   uint8_t *data;
   int i, res;
+  uint16_t sync, chunk;
     
+  acquire();
   res = m_chirp->callSync(m_packet, UINT8(buf[2]), UINTS8(buf[3], buf+4), END_OUT_ARGS,
      &response, &type, &length, &data, END_IN_ARGS);
-  if (res<0)
-    return res;
-  if (response<0)
-    return response;
+  if (res<0 || response<0)
+  {
+    release();
+    return res<0 ? res : response;
+  }
 
+  // The response comes in one chirp message, but TPixy2 expects the packets Pixy would 
+  // send over the other interfaces, so split it up the same way: start flag on the first 
+  // packet, end flag on the last.
   m_rbufIndex = 0;
-  m_rbufLen = length+4;
-  *(uint16_t *)m_rbuf = PIXY_NO_CHECKSUM_SYNC;
-  m_rbuf[2] = type;
-  m_rbuf[3] = length;
-  for (i=0; i<(int)length && i<RBUF_LEN-4; i++)
-    m_rbuf[i+4] = data[i];
+  m_rbufLen = 0;
+  i = 0;
+  do
+  {
+    chunk = length-i>PIXY_MAX_PACKET ? PIXY_MAX_PACKET : length-i;
+    if (m_rbufLen+chunk+4>RBUF_LEN)
+      break;
+    sync = PIXY_SYNC_BASE;
+    if (i==0)
+      sync |= PIXY_SYNC_START_FLAG;
+    if (i+chunk==(int)length)
+      sync |= PIXY_SYNC_END_FLAG;
+    *(uint16_t *)(m_rbuf+m_rbufLen) = sync;
+    m_rbuf[m_rbufLen+2] = type;
+    m_rbuf[m_rbufLen+3] = chunk;
+    memcpy(m_rbuf+m_rbufLen+4, data+i, chunk);
+    m_rbufLen += chunk+4;
+    i += chunk;
+  } while (i<(int)length);
+  release();
     
   return 0;
 }
@@ -106,12 +289,14 @@ int Link2USB::callChirp (const char *  func, va_list  args)
 
   va_copy (arguments, args);
 
+  acquire();
   // Request chirp function id for 'func'. //
-  function_id = m_chirp->getProc (func);
+  function_id = getProc (func);
 
   // Was there an error requesting function id? //
   if (function_id < 0) {
     // Request error //
+    release();
     va_end (arguments);
 
     return CRP_RES_ERROR_INVALID_COMMAND;
@@ -119,22 +304,60 @@ int Link2USB::callChirp (const char *  func, va_list  args)
 
   // Execute chirp synchronous remote function call //
   return_value = m_chirp->call (SYNC, function_id, arguments);
+  release();
   va_end (arguments);
 
   return return_value;
 }
 
+int Link2USB::issueChirp(const char *func, ...)
+{
+  ChirpProc  function_id;
+  int        return_value;
+  va_list    arguments;
+
+  acquire();
+  function_id = getProc (func);
+  if (function_id < 0)
+  {
+    release();
+    return CRP_RES_ERROR_INVALID_COMMAND;
+  }
+
+  va_start (arguments, func);
+  return_value = m_chirp->issue (function_id, arguments);
+  va_end (arguments);
+  release();
+
+  return return_value;
+}
+
+int Link2USB::collectChirp(uint8_t tag, ...)
+{
+  int      return_value;
+  va_list  arguments;
+
+  acquire();
+  va_start (arguments, tag);
+  return_value = m_chirp->collect (tag, arguments);
+  va_end (arguments);
+  release();
+
+  return return_value;
+}
+
 int Link2USB::stop()
 {
   int res, response;
-  char *status;
+  const char *status;
+  uint32_t delayMs;
   
-  res = callChirp("stop", END_OUT_ARGS, &response, END_IN_ARGS);
+  res = callRemote(m_stopProc, &response);
   if (res<0)
     return res;
-  while(1)
+  for (delayMs=1; true; )
   {
-    res = callChirp("running", END_OUT_ARGS, &response, &status, END_IN_ARGS);
+    res = callRemote(m_runningProc, &response, &status);
     if (res<0)
       return res;
     if (response==0)
@@ -142,6 +365,10 @@ int Link2USB::stop()
       m_stopped = true;
       return 0;
     }
+    // the program can take a frame or two to exit, back off instead of flooding Pixy with calls
+    usleep(delayMs*1000);
+    if (delayMs<LINK2USB_STOP_POLL_MAX)
+      delayMs *= 2;
   }
 }
 
@@ -149,7 +376,7 @@ int Link2USB::resume()
 {
   int res, response;
   
-  res = callChirp("run", END_OUT_ARGS, &response, END_IN_ARGS);
+  res = callRemote(m_runProc, &response);
   if (res<0)
     return res;
 
@@ -159,31 +386,200 @@ int Link2USB::resume()
 
 int Link2USB::getRawFrame(uint8_t **bayerFrame)
 {
-  int32_t res, response, fourcc, length;
+  int32_t res, response;
+  uint32_t fourcc;
   uint8_t renderflags;
   uint16_t width, height; 
+  ChirpArray<uint8_t> frame;
 
   if (!m_stopped)
     return -10; // call stop() before getting frame!
+  if (m_streaming)
+    return -11; // call stopStream() before getting frame (or use getFrame())
 
-  res = callChirp("cam_getFrame", // String id for remote procedure
-		  UINT8(0x21), // mode
-		  UINT16(0), // xoffset
-		  UINT16(0), // yoffset
-		  UINT16(PIXY2_RAW_FRAME_WIDTH), // width
-		  UINT16(PIXY2_RAW_FRAME_HEIGHT), // height
-		  END_OUT_ARGS, // separator
-		  &response, // return value
-		  &fourcc,
-		  &renderflags,
-		  &width,
-		  &height,
-		  &length,
-		  bayerFrame, // frame pointer
-		  END_IN_ARGS);
+  res = callRemote(m_getFrameProc,
+                   0x21, // mode
+                   0, // xoffset
+                   0, // yoffset
+                   PIXY2_RAW_FRAME_WIDTH, // width
+                   PIXY2_RAW_FRAME_HEIGHT, // height
+                   &response, // return value
+                   &fourcc,
+                   &renderflags,
+                   &width,
+                   &height,
+                   &frame);
   if (res<0)
     return res;
+  *bayerFrame = (uint8_t *)frame.m_data;
   return response;
 }
-	     
 
+uint8_t *Link2USB::keepBuffer()
+{
+  uint8_t *buf;
+
+  acquire();
+  buf = m_chirp->keepLease();
+  release();
+
+  return buf;
+}
+
+void Link2USB::releaseBuffer(uint8_t *buf)
+{
+  acquire();
+  m_chirp->releaseLease(buf);
+  release();
+}
+
+int Link2USB::startStream(uint8_t depth, uint8_t policy, Link2USBFrameCallback callback, void *data)
+{
+  int res;
+
+  if (m_chirp==NULL || m_streaming)
+    return -1;
+
+  if ((res=m_queue.open(depth, policy))<0)
+    return res;
+  m_callback = callback;
+  m_callbackData = data;
+  m_streamStopping = false;
+  m_chirp->setQueue(&m_queue);
+  m_link->setPollTimeout(LINK2USB_SERVICE_POLL);
+
+  acquire();
+  res = m_chirp->setHinterested(true);
+  release();
+  if (res<0)
+    goto error;
+
+  if (pthread_create(&m_serviceThread, NULL, serviceThread, this)!=0)
+  {
+    res = -1;
+    goto error;
+  }
+  if (m_callback && pthread_create(&m_deliverThread, NULL, deliverThread, this)!=0)
+  {
+    acquire();
+    m_streamStopping = true;
+    release();
+    pthread_join(m_serviceThread, NULL);
+    res = -1;
+    goto error;
+  }
+
+  m_streaming = true;
+  return 0;
+
+error:
+  acquire();
+  m_chirp->setHinterested(false);
+  m_chirp->setQueue(NULL);
+  release();
+  m_link->setPollTimeout(USBLINK_POLL_TIMEOUT);
+  m_queue.close();
+  return res;
+}
+
+int Link2USB::getFrame(Pixy2Frame **frame, uint16_t timeoutMs)
+{
+  if (!m_streaming || m_callback)
+    return -1; // call startStream() without a callback first
+
+  return m_queue.pop(frame, timeoutMs);
+}
+
+int Link2USB::stopStream()
+{
+  int res;
+
+  if (!m_streaming)
+    return 0;
+
+  // tell Pixy to stop sending, the service thread exits when it gets its next turn
+  acquire();
+  m_streamStopping = true;
+  res = m_chirp->setHinterested(false);
+  m_chirp->setQueue(NULL);
+  release();
+  pthread_join(m_serviceThread, NULL);
+  m_link->setPollTimeout(USBLINK_POLL_TIMEOUT);
+
+  // closing the queue wakes up the deliver thread and anyone in getFrame()
+  m_queue.close();
+  if (m_callback)
+    pthread_join(m_deliverThread, NULL);
+
+  m_streaming = false;
+  return res<0 ? res : 0;
+}
+
+uint32_t Link2USB::droppedFrames()
+{
+  return m_queue.dropped();
+}
+
+// Callers (priority) get m_chirp ahead of the service thread, which would otherwise grab it
+// again as soon as it lets go and starve them.
+void Link2USB::acquire(bool priority)
+{
+  pthread_mutex_lock(&m_lockMutex);
+  if (priority)
+  {
+    m_waiting++;
+    while (m_busy)
+      pthread_cond_wait(&m_lockCond, &m_lockMutex);
+    m_waiting--;
+  }
+  else
+  {
+    while (m_busy || m_waiting)
+      pthread_cond_wait(&m_lockCond, &m_lockMutex);
+  }
+  m_busy = true;
+  pthread_mutex_unlock(&m_lockMutex);
+}
+
+void Link2USB::release()
+{
+  pthread_mutex_lock(&m_lockMutex);
+  m_busy = false;
+  pthread_cond_broadcast(&m_lockCond);
+  pthread_mutex_unlock(&m_lockMutex);
+}
+
+// receives whatever Pixy sends between calls -- frames end up in m_queue via Chirp2USB::handleXdata()
+void *Link2USB::serviceThread(void *arg)
+{
+  Link2USB *link = (Link2USB *)arg;
+  int res;
+
+  while(1)
+  {
+    // wait for Pixy to send something without holding m_chirp, so callers aren't kept waiting.
+    // Sync mode can't tell without receiving, so there service() waits, for LINK2USB_SERVICE_POLL.
+    res = link->m_link->waitReceive(LINK2USB_SERVICE_WAIT);
+    link->acquire(false);
+    if (link->m_streamStopping)
+    {
+      link->release();
+      break;
+    }
+    if (res==0)
+      link->m_chirp->service(false);
+    link->release();
+  }
+  return NULL;
+}
+
+void *Link2USB::deliverThread(void *arg)
+{
+  Link2USB *link = (Link2USB *)arg;
+  Pixy2Frame *frame;
+
+  while (link->m_queue.pop(&frame, 0)==FRAMEQUEUE_RESULT_OK)
+    (*link->m_callback)(frame, link->m_callbackData);
+
+  return NULL;
+}
@@ -15,35 +15,152 @@
 
 
 #include <stdio.h>
+#include <string.h>
+#include <new>
+#include <errno.h>
+#include <sys/time.h>
 #include "pixydefs.h"
 #include "usblink.h"
 #include "debuglog.h"
 #include "util.h"
 
+pthread_mutex_t USBContext::s_mutex = PTHREAD_MUTEX_INITIALIZER;
+libusb_context *USBContext::s_context = NULL;
+uint32_t USBContext::s_refs = 0;
+uint32_t USBContext::s_eventRefs = 0;
+volatile bool USBContext::s_eventsRunning = false;
+pthread_t USBContext::s_eventThread;
+
+libusb_context *USBContext::acquire()
+{
+    libusb_context *context;
+
+    pthread_mutex_lock(&s_mutex);
+    if (s_refs==0 && libusb_init(&s_context)<0)
+        s_context = NULL;
+    if (s_context)
+        s_refs++;
+    context = s_context;
+    pthread_mutex_unlock(&s_mutex);
+
+    return context;
+}
+
+void USBContext::release()
+{
+    pthread_mutex_lock(&s_mutex);
+    if (s_refs && --s_refs==0)
+    {
+        libusb_exit(s_context);
+        s_context = NULL;
+    }
+    pthread_mutex_unlock(&s_mutex);
+}
+
+int USBContext::startEvents()
+{
+    int res = 0;
+
+    pthread_mutex_lock(&s_mutex);
+    if (s_eventRefs==0)
+    {
+        s_eventsRunning = true;
+        if (pthread_create(&s_eventThread, NULL, eventThread, NULL)!=0)
+        {
+            s_eventsRunning = false;
+            res = LIBUSB_ERROR_OTHER;
+        }
+    }
+    if (res==0)
+        s_eventRefs++;
+    pthread_mutex_unlock(&s_mutex);
+
+    return res;
+}
+
+void USBContext::stopEvents()
+{
+    pthread_mutex_lock(&s_mutex);
+    if (s_eventRefs && --s_eventRefs==0)
+    {
+        // the event thread doesn't take s_mutex, so we can hold it while joining
+        s_eventsRunning = false;
+        pthread_join(s_eventThread, NULL);
+    }
+    pthread_mutex_unlock(&s_mutex);
+}
+
+// services the transfers of every async link -- callbacks find their link through user_data
+void *USBContext::eventThread(void *arg)
+{
+    struct timeval tv;
+
+    while (s_eventsRunning)
+    {
+        tv.tv_sec = 0;
+        tv.tv_usec = USBLINK_ASYNC_EVENT_TIMEOUT*1000;
+        libusb_handle_events_timeout_completed(s_context, &tv, NULL);
+    }
+    return NULL;
+}
+
+
 USBLink::USBLink()
 {
     m_handle = 0;
     m_context = 0;
+    m_path[0] = '\0';
+    m_pollTimeout = USBLINK_POLL_TIMEOUT;
     m_blockSize = 64;
     m_flags = LINK_FLAG_ERROR_CORRECTED;
+    m_mode = USBLINK_MODE_SYNC;
+    m_eventsRunning = false;
+    m_stopping = false;
+    m_activeCount = 0;
+    m_submitSeq = 0;
+    m_completedHead = 0;
+    m_completedCount = 0;
+    m_completedOffset = 0;
+    m_asyncError = 0;
+    memset(m_transfers, 0, sizeof(m_transfers));
+    memset(m_transferBufs, 0, sizeof(m_transferBufs));
+    memset(m_transferActive, 0, sizeof(m_transferActive));
+    memset(m_transferLeases, 0, sizeof(m_transferLeases));
+    memset(m_transferDrained, 0, sizeof(m_transferDrained));
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
 }
 
 USBLink::~USBLink()
 {
     close();
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
 }
 
-int USBLink::open()
+int USBLink::open(uint8_t mode, const char *path)
 {
+    int res;
+
     close();
 
-    libusb_init(&m_context);
+    if ((m_context=USBContext::acquire())==NULL)
+        return -1;
 
-    return openDevice();
+    if ((res=openDevice(path))<0)
+        return res;
+
+    m_mode = mode;
+    if (m_mode==USBLINK_MODE_ASYNC)
+        return startAsync();
+
+    return 0;
 }
 
 void USBLink::close()
 {
+    stopAsync();
+
     if (m_handle)
     {
         libusb_close(m_handle);
@@ -51,17 +168,61 @@ void USBLink::close()
     }
     if (m_context)
     {
-        libusb_exit(m_context);
+        USBContext::release();
         m_context = 0;
     }
+    m_path[0] = '\0';
+}
+
+const char *USBLink::getPath()
+{
+    return m_path;
+}
+
+int USBLink::enumerate(char paths[][USBLINK_MAX_PATH], uint8_t maxDevices)
+{
+    libusb_context *context;
+    libusb_device **list = NULL;
+    int i, count, n;
+    libusb_device_descriptor desc;
+
+    if ((context=USBContext::acquire())==NULL)
+        return -1;
+
+    count = libusb_get_device_list(context, &list);
+
+    for (i=0, n=0; i<count && n<maxDevices; i++)
+    {
+        libusb_get_device_descriptor(list[i], &desc);
+        if (desc.idVendor==PIXY_VID && desc.idProduct==PIXY_PID)
+            devicePath(list[i], paths[n++]);
+    }
+    if (count>=0)
+        libusb_free_device_list(list, 1);
+    USBContext::release();
+
+    return n;
 }
 
-int USBLink::openDevice()
+// the path stays the same as long as Pixy is plugged into the same port, unlike the device address
+void USBLink::devicePath(libusb_device *device, char *path)
+{
+    uint8_t ports[USBLINK_MAX_PORTS];
+    int i, n, len;
+
+    len = sprintf(path, "%d", libusb_get_bus_number(device));
+    n = libusb_get_port_numbers(device, ports, USBLINK_MAX_PORTS);
+    for (i=0; i<n; i++)
+        len += sprintf(path+len, "%c%d", i==0 ? '-' : '.', ports[i]);
+}
+
+int USBLink::openDevice(const char *path)
 {
     libusb_device **list = NULL;
     int i, count = 0;
     libusb_device *device;
     libusb_device_descriptor desc;
+    char devPath[USBLINK_MAX_PATH];
 
     count = libusb_get_device_list(m_context, &list);
 
@@ -72,6 +233,9 @@ int USBLink::openDevice()
 
         if (desc.idVendor==PIXY_VID && desc.idProduct==PIXY_PID)
         {
+            devicePath(device, devPath);
+            if (path && strcmp(path, devPath))
+                continue;
             if (libusb_open(device, &m_handle)==0)
             {
             #ifdef __MACOS__
@@ -92,6 +256,7 @@ int USBLink::openDevice()
 #ifdef __LINUX__
                 libusb_reset_device(m_handle);
 #endif
+                strcpy(m_path, devPath);
                 break;
             }
         }
@@ -126,8 +291,11 @@ int USBLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
 {
     int res, transferred;
 
-    if (timeoutMs==0) // 0 equals infinity
-        timeoutMs = 100;
+    if (m_mode==USBLINK_MODE_ASYNC)
+        return receiveAsync(data, len, timeoutMs);
+
+    if (timeoutMs==0) // 0 means poll (see setPollTimeout())
+        timeoutMs = m_pollTimeout;
 
     // Note: if this call is taking more time than than expected, check to see if we're connected as USB 2.0.  Bad USB cables can
     // cause us to revert to a 1.0 connection.
@@ -155,5 +323,331 @@ uint32_t USBLink::getTimer()
 }
 
 
+int USBLink::startAsync()
+{
+    int i, res;
+
+    m_completedHead = 0;
+    m_completedCount = 0;
+    m_completedOffset = 0;
+    m_asyncError = 0;
+    m_stopping = false;
+    m_maxPacket = libusb_get_max_packet_size(libusb_get_device(m_handle), 0x82);
+    if (m_maxPacket<=0)
+        m_maxPacket = 64;
+
+    for (i=0; i<USBLINK_ASYNC_TRANSFERS; i++)
+    {
+        m_transfers[i] = libusb_alloc_transfer(0);
+        m_transferBufs[i] = new (std::nothrow) uint8_t[LINK_BUFFER_HEADROOM+USBLINK_ASYNC_TRANSFER_SIZE];
+        if (m_transfers[i]==NULL || m_transferBufs[i]==NULL)
+        {
+            stopAsync();
+            return LIBUSB_ERROR_NO_MEM;
+        }
+        m_transferLeases[i] = 0;
+        m_transferDrained[i] = false;
+        libusb_fill_bulk_transfer(m_transfers[i], m_handle, 0x82, m_transferBufs[i]+LINK_BUFFER_HEADROOM, USBLINK_ASYNC_TRANSFER_SIZE,
+                                  transferCallback, this, 0);
+    }
+
+    if ((res=USBContext::startEvents())<0)
+    {
+        stopAsync();
+        return res;
+    }
+    m_eventsRunning = true;
+
+    pthread_mutex_lock(&m_mutex);
+    for (i=0; i<USBLINK_ASYNC_TRANSFERS; i++)
+    {
+        if ((res=submitTransfer(i))<0)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            stopAsync();
+            return res;
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    m_flags |= LINK_FLAG_BUFFERED_RECEIVE | LINK_FLAG_ZERO_COPY;
+    return 0;
+}
+
+void USBLink::stopAsync()
+{
+    int i;
+
+    pthread_mutex_lock(&m_mutex);
+    m_stopping = true;
+    // cancel everything in flight and wait for the event thread to deliver the cancellations
+    for (i=0; i<USBLINK_ASYNC_TRANSFERS; i++)
+    {
+        if (m_transferActive[i])
+            libusb_cancel_transfer(m_transfers[i]);
+    }
+    while (m_activeCount && m_eventsRunning)
+        pthread_cond_wait(&m_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+
+    if (m_eventsRunning)
+    {
+        m_eventsRunning = false;
+        USBContext::stopEvents();
+    }
+
+    for (i=0; i<USBLINK_ASYNC_TRANSFERS; i++)
+    {
+        if (m_transfers[i])
+        {
+            libusb_free_transfer(m_transfers[i]);
+            m_transfers[i] = NULL;
+        }
+        delete [] m_transferBufs[i];
+        m_transferBufs[i] = NULL;
+        m_transferActive[i] = false;
+        m_transferLeases[i] = 0;
+    }
+    m_activeCount = 0;
+    m_completedCount = 0;
+    m_mode = USBLINK_MODE_SYNC;
+    m_flags &= ~(LINK_FLAG_BUFFERED_RECEIVE | LINK_FLAG_ZERO_COPY);
+}
+
+// must be called with m_mutex held
+int USBLink::submitTransfer(uint8_t index)
+{
+    int res;
+
+    if ((res=libusb_submit_transfer(m_transfers[index]))<0)
+    {
+        log("libusb_submit_transfer %d", res);
+        m_asyncError = res;
+        return res;
+    }
+    m_transferActive[index] = true;
+    m_transferSeq[index] = m_submitSeq++;
+    m_activeCount++;
+    return 0;
+}
+
+// cancel the transfer that's receiving, so whatever it has so far is handed to receive() --
+// must be called with m_mutex held
+void USBLink::flushActive()
+{
+    int i, oldest = -1;
+
+    // transfers on one endpoint fill in the order they were submitted
+    for (i=0; i<USBLINK_ASYNC_TRANSFERS; i++)
+    {
+        if (m_transferActive[i] && (oldest<0 || m_submitSeq-m_transferSeq[i]>m_submitSeq-m_transferSeq[oldest]))
+            oldest = i;
+    }
+    if (oldest>=0)
+        libusb_cancel_transfer(m_transfers[oldest]);
+}
+
+// called from the event thread (inside libusb_handle_events_timeout_completed())
+void LIBUSB_CALL USBLink::transferCallback(libusb_transfer *transfer)
+{
+    USBLink *link = (USBLink *)transfer->user_data;
+    uint8_t index;
+
+    for (index=0; index<USBLINK_ASYNC_TRANSFERS && link->m_transfers[index]!=transfer; index++);
+    if (index==USBLINK_ASYNC_TRANSFERS)
+        return;
+
+    pthread_mutex_lock(&link->m_mutex);
+    link->m_transferActive[index] = false;
+    link->m_activeCount--;
+
+    if ((transfer->status==LIBUSB_TRANSFER_COMPLETED || transfer->status==LIBUSB_TRANSFER_TIMED_OUT ||
+         transfer->status==LIBUSB_TRANSFER_CANCELLED) && transfer->actual_length>0)
+    {
+        // hand data to receive() -- the transfer is resubmitted once it has been consumed.  A flush
+        // marks the end of what has arrived, same as a short packet.
+        link->m_transferEnded[index] = transfer->status==LIBUSB_TRANSFER_CANCELLED || transfer->actual_length%link->m_maxPacket!=0;
+        link->m_completed[(link->m_completedHead+link->m_completedCount)%USBLINK_ASYNC_TRANSFERS] = index;
+        link->m_completedCount++;
+    }
+    else if ((transfer->status==LIBUSB_TRANSFER_COMPLETED || transfer->status==LIBUSB_TRANSFER_TIMED_OUT ||
+              transfer->status==LIBUSB_TRANSFER_CANCELLED) && !link->m_stopping)
+        link->submitTransfer(index); // flushed or idle, nothing received -- keep it in flight
+    else if (transfer->status!=LIBUSB_TRANSFER_CANCELLED)
+    {
+        log("libusb async transfer status %d", transfer->status);
+        link->m_asyncError = transfer->status==LIBUSB_TRANSFER_NO_DEVICE ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_IO;
+    }
+
+    pthread_cond_broadcast(&link->m_cond);
+    pthread_mutex_unlock(&link->m_mutex);
+}
+
+static void deadlineAfter(struct timespec *deadline, uint32_t ms)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    deadline->tv_sec = now.tv_sec + ms/1000;
+    deadline->tv_nsec = now.tv_usec*1000 + (ms%1000)*1000000;
+    if (deadline->tv_nsec>=1000000000)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+// wait for the first completed transfer -- must be called with m_mutex held
+int USBLink::waitCompleted(uint16_t timeoutMs)
+{
+    bool flushed = false;
+    struct timespec flushAt, deadline;
+
+    if (timeoutMs==0) // 0 means poll (see setPollTimeout())
+        timeoutMs = m_pollTimeout;
+
+    deadlineAfter(&flushAt, timeoutMs<USBLINK_ASYNC_FLUSH_TIMEOUT ? timeoutMs : USBLINK_ASYNC_FLUSH_TIMEOUT);
+    // a short timeout still gets to see what the flush turns up
+    deadlineAfter(&deadline, timeoutMs>USBLINK_ASYNC_FLUSH_TIMEOUT ? timeoutMs : timeoutMs+USBLINK_ASYNC_FLUSH_TIMEOUT);
+
+    while (m_completedCount==0)
+    {
+        if (m_asyncError)
+            return m_asyncError;
+        if (pthread_cond_timedwait(&m_cond, &m_mutex, flushed ? &deadline : &flushAt)==ETIMEDOUT && m_completedCount==0)
+        {
+            if (flushed)
+                return LIBUSB_ERROR_TIMEOUT;
+            // nothing has ended on a short packet -- get back what the receiving transfer has, if anything
+            flushActive();
+            flushed = true;
+        }
+    }
+    return 0;
+}
+
+// consume len bytes from the transfer at the head of the completed queue -- must be called with m_mutex held
+void USBLink::consume(uint32_t len)
+{
+    uint8_t index = m_completed[m_completedHead];
+
+    m_completedOffset += len;
+    if (m_completedOffset==(uint32_t)m_transfers[index]->actual_length)
+    {
+        // transfer has been drained, put it back in flight (unless someone is still holding on to it)
+        m_completedHead = (m_completedHead+1)%USBLINK_ASYNC_TRANSFERS;
+        m_completedCount--;
+        m_completedOffset = 0;
+        m_transferDrained[index] = true;
+        if (m_transferLeases[index]==0 && !m_stopping)
+        {
+            m_transferDrained[index] = false;
+            submitTransfer(index);
+        }
+    }
+}
+
+int USBLink::receiveAsync(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    bool ended;
+    uint8_t index;
+    uint32_t n, recvd, available;
+
+    pthread_mutex_lock(&m_mutex);
+    if ((res=waitCompleted(timeoutMs))<0)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return res;
+    }
+
+    // copy out whatever has already arrived, up to len -- like a bulk read, we may return less than
+    // asked for, and we stop at a short packet, so the start of the next message stays for the next call
+    for (recvd=0; recvd<len && m_completedCount; )
+    {
+        index = m_completed[m_completedHead];
+        available = m_transfers[index]->actual_length - m_completedOffset;
+        n = len-recvd<available ? len-recvd : available;
+        memcpy(data+recvd, m_transfers[index]->buffer+m_completedOffset, n);
+        recvd += n;
+        ended = n==available && m_transferEnded[index];
+        consume(n);
+        if (ended)
+            break;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    return recvd;
+}
+
+void USBLink::setPollTimeout(uint16_t timeoutMs)
+{
+    m_pollTimeout = timeoutMs ? timeoutMs : USBLINK_POLL_TIMEOUT;
+}
+
+int USBLink::waitReceive(uint16_t timeoutMs)
+{
+    int res;
+
+    if (m_mode!=USBLINK_MODE_ASYNC)
+        return 0;
 
+    pthread_mutex_lock(&m_mutex);
+    res = waitCompleted(timeoutMs);
+    pthread_mutex_unlock(&m_mutex);
 
+    return res;
+}
+
+int USBLink::getBuffer(uint8_t **buf, uint32_t *len, uint16_t timeoutMs)
+{
+    int res;
+    uint8_t index;
+
+    if (m_mode!=USBLINK_MODE_ASYNC)
+        return LINK_RESULT_ERROR;
+
+    pthread_mutex_lock(&m_mutex);
+    if ((res=waitCompleted(timeoutMs))<0)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return res;
+    }
+
+    index = m_completed[m_completedHead];
+    // we can only lend it out if all of it is in this transfer.  Note, the bytes in front of
+    // *buf are either the headroom or data that has already been consumed -- both are fair game.
+    if (m_transfers[index]->actual_length-m_completedOffset<*len)
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return LINK_RESULT_ERROR;
+    }
+    *buf = m_transfers[index]->buffer+m_completedOffset;
+    m_transferLeases[index]++;
+    consume(*len);
+    pthread_mutex_unlock(&m_mutex);
+
+    return LINK_RESULT_OK;
+}
+
+void USBLink::releaseBuffer(uint8_t *buf)
+{
+    uint8_t index;
+
+    pthread_mutex_lock(&m_mutex);
+    for (index=0; index<USBLINK_ASYNC_TRANSFERS; index++)
+    {
+        if (m_transferBufs[index] && buf>=m_transfers[index]->buffer && buf<m_transfers[index]->buffer+USBLINK_ASYNC_TRANSFER_SIZE)
+            break;
+    }
+    if (index<USBLINK_ASYNC_TRANSFERS && m_transferLeases[index])
+    {
+        m_transferLeases[index]--;
+        if (m_transferLeases[index]==0 && m_transferDrained[index] && !m_stopping)
+        {
+            m_transferDrained[index] = false;
+            submitTransfer(index);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
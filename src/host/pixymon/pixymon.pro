@@ -52,6 +52,7 @@ HEADERS  += mainwindow.h \
     ../../common/inc/pixytypes.h \
     ../../common/inc/pixydefs.h \
     ../../common/inc/chirp.hpp \
+    ../../common/inc/chirpcrc.h \
     ../../common/inc/link.h \
     ../../common/inc/calc.h \
     ../../common/inc/simplevector.h \